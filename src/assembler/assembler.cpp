@@ -8,8 +8,6 @@
 #include "../instruction_types.h"
 #include "assembler.h"
 
-extern std::map<std::string, Instruction_Data> BLUEPRINTS;
-
 std::vector<int16_t> assemble_program(
         const std::vector<Token> &tokens,
         const std::map<std::string, int16_t> &label_map
@@ -63,8 +61,7 @@ std::vector<int16_t> assemble_program(
         size_t token_idx = 0;
         while (token_idx < tokens.size()) {
                 Token first_token = tokens.at(token_idx);
-                Instruction_Data curr_instruction;
-                curr_instruction = BLUEPRINTS.at(first_token.data);
+                const Instruction_Data &curr_instruction = get_instruction(get_opcode(first_token.data));
                 for (size_t ins_idx = 0; ins_idx < curr_instruction.length; ins_idx++) {
                         Token curr_token = tokens.at(token_idx + ins_idx);
                         int16_t translated = 0;
@@ -8,8 +8,6 @@
 #include "../instruction_types.h"
 #include "helper.h"
 
-extern std::map<std::string, Instruction_Data> BLUEPRINTS;
-
 bool is_valid_atom(const Atom_Type atom_type, const std::string &token) {
         bool first, second;
         int16_t aux_value;
@@ -29,7 +27,7 @@ bool is_valid_atom(const Atom_Type atom_type, const std::string &token) {
                 second = token.front() == '\"';
                 return first && second;
         case MNEMONIC:
-                return BLUEPRINTS.find(token) != BLUEPRINTS.end();
+                return get_opcode(token) != -1;
         case RAM_ADDR:
                 stripped_token = token.substr(2, token.length() - 3); // remove [$]
                 if (!is_valid_i16(stripped_token))
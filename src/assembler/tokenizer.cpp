@@ -1,3 +1,4 @@
+#include <array>
 #include <cctype>
 #include <cstddef>
 #include <cstdint>
@@ -5,12 +6,11 @@
 #include <string>
 #include <vector>
 
+#include "../instruction_types.h"
 #include "../token_types.h"
 #include "helper.h"
 #include "tokenizer.h"
 
-extern std::map<std::string, Instruction_Data> BLUEPRINTS;
-
 std::map<std::string, int16_t> create_label_map(
         const std::vector<Token> &tokens
 ) {
@@ -160,18 +160,19 @@ Debug_Info grammar_check(
                         context.relevant_token = first_token;
                         return context;
                 }
-                if (BLUEPRINTS.find(first_token.data) == BLUEPRINTS.end()) {
+                int16_t opcode = get_opcode(first_token.data);
+                if (opcode == -1) {
                         // mnemonic not recognized
                         context.grammar_retval = UNKNOWN_MNEMONIC_E;
                         context.line_num = first_token.line_num;
                         context.relevant_token = first_token;
                         return context;
                 }
-                if (first_token.data == "EXIT")
+                if (opcode == OP_EXIT)
                         seen_exit = true;
 
-                Instruction_Data curr_instruction = BLUEPRINTS.at(first_token.data);
-                std::vector<Atom_Type> curr_blueprint = curr_instruction.blueprint;
+                const Instruction_Data &curr_instruction = get_instruction(opcode);
+                const std::array<Atom_Type, MAX_INSTRUCTION_LENGTH> &curr_blueprint = curr_instruction.blueprint;
                 // check if there are enough tokens
                 if (token_idx + curr_instruction.length > tokens.size()) {
                         // expected arguments
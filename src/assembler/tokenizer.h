@@ -22,6 +22,22 @@ enum Grammar_Retval {
         UNKNOWN_MNEMONIC_E,
 };
 
+/**
+ * @brief stores error message for grammar errors in user programs
+ * @details element 0 is the same idx as ACCEPTABLE, so no message is needed.
+ * used by handle_grammar_error and the batch runner
+ */
+const std::string GRAMMAR_ERROR_MESSAGES[10] = {
+        "",
+        "Expected Mnemonic",
+        "Invalid Atom",
+        "Missing Arguments",
+        "Missing Exit",
+        "Missing Main",
+        "Unknown Label",
+        "Unknown Mnemonic",
+};
+
 /**
  * @brief holds relevant debug information for erroneous user program
  * @details helper struct for grammar_check
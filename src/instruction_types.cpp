@@ -1,48 +1,23 @@
-#include <cstdint>
-#include <map>
-#include <string>
-#include <vector>
+#include <cstddef>
 
 #include "instruction_types.h"
 
 /**
- * @brief hashmap that defines template of instructions in assembly language
+ * @brief whether every mnemonic hashes back to its own opcode
+ * @details checked at compile time, so a bad entry in INSTRUCTION_LIST
+ * fails the build
  */
-std::map<std::string, Instruction_Data> BLUEPRINTS;
-
-Instruction_Data::Instruction_Data(
-        int16_t given_opcode,
-        std::string given_mnem_name,
-        std::vector<Atom_Type> given_blueprint
-) {
-        length = given_blueprint.size();
-        opcode = given_opcode;
-        mnem_name = given_mnem_name;
-        blueprint = given_blueprint;
-}
-
-Instruction_Data get_instruction(const int16_t &opcode) {
-        // ordered_maps are organized by key in lexographical order,
-        // not by initalization order
-        std::map<std::string, Instruction_Data>::const_iterator it;
-        for (it = BLUEPRINTS.begin(); it != BLUEPRINTS.end(); ++it) {
-                if (it->second.opcode == opcode)
-                        return it->second;
+static constexpr bool is_consistent_table() {
+        for (size_t opcode = 0; opcode < NUM_OPCODES; ++opcode) {
+                const Instruction_Data &ins = INSTRUCTION_TABLE[opcode];
+                if (ins.opcode != (int16_t)opcode || get_opcode(ins.mnem_name) != ins.opcode)
+                        return false;
+                if (ins.length == 0 || ins.length > MAX_INSTRUCTION_LENGTH)
+                        return false;
         }
-        return Instruction_Data();
+        return true;
 }
 
-std::string get_mnem_name(const int16_t &opcode) {
-        // ordered_maps are organized by key in lexographical order,
-        // not by initalization order
-        std::map<std::string, Instruction_Data>::const_iterator it;
-        for (it = BLUEPRINTS.begin(); it != BLUEPRINTS.end(); ++it) {
-                if (it->second.opcode == opcode)
-                        return it->first;
-        }
-        return "";
-}
-
-int16_t get_opcode(const std::string &mnem_name) {
-        return BLUEPRINTS.at(mnem_name).opcode;
-}
+static_assert(is_consistent_table(), "INSTRUCTION_LIST and MNEMONIC_TABLE disagree");
+static_assert(get_opcode("EXIT") == OP_EXIT && get_opcode("exit") == -1,
+        "get_opcode is case sensitive");
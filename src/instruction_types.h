@@ -1,40 +1,211 @@
 #ifndef INSTRUCTION_TYPES_H
 #define INSTRUCTION_TYPES_H 1
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
-#include <string>
 #include <map>
-#include <vector>
+#include <string>
+#include <string_view>
 
 #include "token_types.h"
 
+/**
+ * @brief the instruction set, one X(name, atoms...) per opcode, in opcode order
+ * @details the first atom is always the MNEMONIC, the rest are the arguments.
+ * Expanded into Opcode_Enum and INSTRUCTION_TABLE, so this is the only place
+ * an instruction is described
+ */
+#define INSTRUCTION_LIST(X) \
+        X(NOP,    MNEMONIC) \
+        X(MOV,    MNEMONIC, REGISTER, SOURCE) \
+        X(INC,    MNEMONIC, REGISTER) \
+        X(DEC,    MNEMONIC, REGISTER) \
+        X(ADD,    MNEMONIC, REGISTER, SOURCE) \
+        X(SUB,    MNEMONIC, REGISTER, SOURCE) \
+        X(MUL,    MNEMONIC, REGISTER, SOURCE) \
+        X(DIV,    MNEMONIC, REGISTER, SOURCE) \
+        X(MOD,    MNEMONIC, REGISTER, SOURCE) \
+        X(AND,    MNEMONIC, REGISTER, SOURCE) \
+        X(OR,     MNEMONIC, REGISTER, SOURCE) \
+        X(NOT,    MNEMONIC, REGISTER, SOURCE) \
+        X(XOR,    MNEMONIC, REGISTER, SOURCE) \
+        X(LSH,    MNEMONIC, REGISTER, SOURCE) \
+        X(RSH,    MNEMONIC, REGISTER, SOURCE) \
+        X(CMP,    MNEMONIC, SOURCE,   SOURCE) \
+        X(JMP,    MNEMONIC, LABEL) \
+        X(JEQ,    MNEMONIC, LABEL) \
+        X(JNE,    MNEMONIC, LABEL) \
+        X(JGE,    MNEMONIC, LABEL) \
+        X(JGR,    MNEMONIC, LABEL) \
+        X(JLE,    MNEMONIC, LABEL) \
+        X(JLS,    MNEMONIC, LABEL) \
+        X(CALL,   MNEMONIC, LABEL) \
+        X(RET,    MNEMONIC) \
+        X(PUSH,   MNEMONIC, SOURCE) \
+        X(POP,    MNEMONIC, REGISTER) \
+        X(WRITE,  MNEMONIC, SOURCE,   SOURCE) \
+        X(READ,   MNEMONIC, REGISTER, SOURCE) \
+        X(PRINT,  MNEMONIC, SOURCE) \
+        X(SPRINT, MNEMONIC, LITERAL_STR) \
+        X(CPRINT, MNEMONIC, SOURCE) \
+        X(INPUT,  MNEMONIC) \
+        X(SINPUT, MNEMONIC) \
+        X(RAND,   MNEMONIC) \
+        X(EXIT,   MNEMONIC)
+
+/**
+ * @brief opcodes of the assembly language, in the same order as INSTRUCTION_LIST
+ */
+enum Opcode_Enum {
+        #define X(name, ...) OP_##name,
+        INSTRUCTION_LIST(X)
+        #undef X
+        NUM_OPCODES,
+};
+
+/**
+ * @brief most atoms in one instruction, mnemonic included
+ */
+const size_t MAX_INSTRUCTION_LENGTH = 3;
+
 /**
  * @brief stores all relevant information of an instruction in one place
- * @details helper struct for BLUEPRINTS
+ * @details helper struct for INSTRUCTION_TABLE. blueprint is only valid
+ * up to length
  */
 struct Instruction_Data {
         int16_t opcode;
-        std::string mnem_name;
-        std::vector<Atom_Type> blueprint;
+        std::string_view mnem_name;
+        std::array<Atom_Type, MAX_INSTRUCTION_LENGTH> blueprint;
         size_t length;
-        Instruction_Data() = default;
-        Instruction_Data(int16_t given_opcode, std::string given_mnem_name, std::vector<Atom_Type> given_blueprint);
 };
 
-Instruction_Data get_instruction(const int16_t &opcode);
+/**
+ * @brief number of atoms given to X in INSTRUCTION_LIST
+ * @details helper function of INSTRUCTION_TABLE
+ */
+template <typename... ATOMS>
+constexpr size_t count_atoms(ATOMS...) {
+        return sizeof...(ATOMS);
+}
+
+/**
+ * @brief template of every instruction in the assembly language, indexed by opcode
+ */
+constexpr std::array<Instruction_Data, NUM_OPCODES> INSTRUCTION_TABLE = {{
+        #define X(name, ...) \
+                {OP_##name, #name, {__VA_ARGS__}, count_atoms(__VA_ARGS__)},
+        INSTRUCTION_LIST(X)
+        #undef X
+}};
 
-std::string get_mnem_name(const int16_t &opcode);
+/**
+ * @brief what get_instruction returns for an opcode outside the table
+ * @details length is 1, so walks over the program still move forward
+ */
+constexpr Instruction_Data UNKNOWN_INSTRUCTION = {-1, "", {MNEMONIC}, 1};
+
+/**
+ * @brief hash of a mnemonic, FNV-1a
+ * @details helper function of MNEMONIC_TABLE and get_opcode
+ */
+constexpr uint32_t hash_mnemonic(std::string_view mnem_name) {
+        uint32_t hash = 2166136261u;
+        for (char letter : mnem_name) {
+                hash ^= (uint8_t)letter;
+                hash *= 16777619u;
+        }
+        return hash;
+}
 
-int16_t get_opcode(const std::string &mnem_name);
+/**
+ * @brief number of slots in MNEMONIC_TABLE, a power of 2 well above NUM_OPCODES
+ */
+const size_t MNEMONIC_TABLE_SIZE = 128;
+
+/**
+ * @brief open addressing hash table from mnemonic to opcode, -1 if empty
+ * @details helper function of MNEMONIC_TABLE
+ */
+constexpr std::array<int16_t, MNEMONIC_TABLE_SIZE> create_mnemonic_table() {
+        std::array<int16_t, MNEMONIC_TABLE_SIZE> table = {};
+        for (int16_t &slot : table)
+                slot = -1;
+        for (const Instruction_Data &ins : INSTRUCTION_TABLE) {
+                size_t slot = hash_mnemonic(ins.mnem_name) & (MNEMONIC_TABLE_SIZE - 1);
+                while (table[slot] != -1)
+                        slot = (slot + 1) & (MNEMONIC_TABLE_SIZE - 1);
+                table[slot] = ins.opcode;
+        }
+        return table;
+}
+
+/**
+ * @brief slots of get_opcode, built at compile time
+ */
+constexpr std::array<int16_t, MNEMONIC_TABLE_SIZE> MNEMONIC_TABLE = create_mnemonic_table();
+
+/**
+ * @brief template of the instruction with the given opcode
+ * @details UNKNOWN_INSTRUCTION if opcode isn't one
+ */
+constexpr const Instruction_Data &get_instruction(int16_t opcode) {
+        if (opcode < 0 || opcode >= NUM_OPCODES)
+                return UNKNOWN_INSTRUCTION;
+        return INSTRUCTION_TABLE[opcode];
+}
+
+/**
+ * @brief mnemonic of the given opcode, empty if opcode isn't one
+ */
+constexpr std::string_view get_mnem_name(int16_t opcode) {
+        return get_instruction(opcode).mnem_name;
+}
+
+/**
+ * @brief opcode of the given mnemonic, -1 if it isn't one
+ * @details mnemonics are case sensitive
+ */
+constexpr int16_t get_opcode(std::string_view mnem_name) {
+        size_t slot = hash_mnemonic(mnem_name) & (MNEMONIC_TABLE_SIZE - 1);
+        while (MNEMONIC_TABLE[slot] != -1) {
+                if (INSTRUCTION_TABLE[MNEMONIC_TABLE[slot]].mnem_name == mnem_name)
+                        return MNEMONIC_TABLE[slot];
+                slot = (slot + 1) & (MNEMONIC_TABLE_SIZE - 1);
+        }
+        return -1;
+}
+
+/**
+ * @brief ids of the registers, in the same order as REGISTER_TABLE
+ * @details also the idx of each register in CPU_Handle::registers
+ */
+enum Register_Enum {
+        REG_RZ = 0,
+        REG_RA,
+        REG_RB,
+        REG_RC,
+        REG_RD,
+        REG_RE,
+        REG_RF,
+        REG_RG,
+        REG_RH,
+        REG_RSP,
+        REG_RIP,
+        REG_CMP0,
+        REG_CMP1,
+        NUM_REGISTERS,
+};
 
 /**
  * @brief hashmap for valid callable registers in assembly language
  */
 const std::map<std::string, int16_t> REGISTER_TABLE = {
-        {"RZ",   0}, {"RA",  1}, {"RB",    2}, {"RC",    3},
-        {"RD",   4}, {"RE",  5}, {"RF",    6}, {"RG",    7},
-        {"RH",   8}, {"RSP", 9}, {"RIP",  10}, {"CMP0", 11},
-        {"CMP1", 12}
+        {"RZ",   REG_RZ},  {"RA",  REG_RA},  {"RB",   REG_RB},   {"RC",   REG_RC},
+        {"RD",   REG_RD},  {"RE",  REG_RE},  {"RF",   REG_RF},   {"RG",   REG_RG},
+        {"RH",   REG_RH},  {"RSP", REG_RSP}, {"RIP",  REG_RIP},  {"CMP0", REG_CMP0},
+        {"CMP1", REG_CMP1}
 };
 
 #endif
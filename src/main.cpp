@@ -8,6 +8,8 @@
  */
 
 #include <cstdint>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <random>
 #include <map>
@@ -20,27 +22,14 @@
 #include "token_types.h"
 #include "assembler/assembler.h"
 #include "assembler/tokenizer.h"
+#include "misc/batch_runner.h"
 #include "misc/cmd_line_opts.h"
 #include "misc/file_handling.h"
 #include "simulator/cpu_handle.h"
-
-extern std::map<std::string, Instruction_Data> BLUEPRINTS;
-
-/**
- * @brief stores error message for grammar errors in user programs
- * @details element 0 is the same idx as ACCEPTABLE, so no message is needed.
- * helper variable for handle_grammar_error
- */
-const std::string GRAMMAR_ERROR_MESSAGES[10] = {
-        "",
-        "Expected Mnemonic",
-        "Invalid Atom",
-        "Missing Arguments",
-        "Missing Exit",
-        "Missing Main",
-        "Unknown Label",
-        "Unknown Mnemonic",
-};
+#include "simulator/debug_report.h"
+#include "simulator/profiler.h"
+#include "simulator/trace.h"
+#include "translator/cpp_translator.h"
 
 /**
  * @brief handle for user program grammar errors
@@ -79,11 +68,13 @@ void handle_grammar_error(
 
 /**
  * @brief handle for generating program from user ascii input
- * @details capable of exiting, helper function for main
+ * @details capable of exiting, helper function for main. symbols gets the
+ * name of every label, by its address in the assembled program
  */
 std::vector<int16_t> generate_program(
         char** const argv,
-        const Cmd_Options &life_opts
+        const Cmd_Options &life_opts,
+        std::map<int16_t, std::string> &symbols
 ) {
         // produce random file header for intermediate files, which makes
         //      running multiple tests in a row unlikely to overwrite data
@@ -97,10 +88,15 @@ std::vector<int16_t> generate_program(
 
         // choose input source, and put into string
         std::string source_buffer;
+        bool read_source;
         if (life_opts.input_file_idx == -1)
-                source_buffer = get_source_buffer("", true);
+                read_source = get_source_buffer(source_buffer, "", true);
         else
-                source_buffer = get_source_buffer(argv[life_opts.input_file_idx], false);
+                read_source = get_source_buffer(source_buffer, argv[life_opts.input_file_idx], false);
+        if (!read_source) {
+                std::cerr << "Failed to open input file\n";
+                std::exit(1);
+        }
 
         // tokenize source_buffer, create label_map
         std::vector<Token> tokens = create_tokens(source_buffer); 
@@ -116,8 +112,11 @@ std::vector<int16_t> generate_program(
         }
 
         // generate intermediate file with tokens and labels
-        if (life_opts.intermediate_files)
-                generate_intermediate_file(file_header, filtered_tokens, label_map);
+        if (life_opts.intermediate_files
+                && !generate_intermediate_file(file_header, filtered_tokens, label_map)) {
+                std::cerr << "Failed to open token sink file\n";
+                std::exit(1);
+        }
 
         // exit program if there is a grammar error
         Debug_Info context = grammar_check(filtered_tokens, label_map);
@@ -132,6 +131,10 @@ std::vector<int16_t> generate_program(
 
         // create the assembled program
         std::vector<int16_t> final_program = assemble_program(filtered_tokens, label_map);
+        // label_map doesn't count the header and string data, main's address does
+        const int16_t label_offset = final_program.at(4) - label_map.at("main");
+        for (const auto &label : label_map)
+                symbols.insert({(int16_t)(label.second + label_offset), label.first});
         // if assemble_only flag is on, write binary to file and quit
         if (life_opts.assemble_only) {
                 bool res_temp;
@@ -145,34 +148,206 @@ std::vector<int16_t> generate_program(
         return final_program;
 }
 
-int main(int argc, char **argv) {
-        // holy shit i love the preprocessor
-        #include "instructions.txt"
+/**
+ * @brief prints how often each fused sequence ran, for --fusion-stats
+ * @details helper function for main. goes to stderr to keep program
+ * output clean
+ */
+void print_fusion_stats(const CPU_Handle &cpu_handle) {
+        std::cerr << "\x1b[34mFusion Stats:\x1b[0m\n";
+        for (int i = FUSION_NONE + 1; i < NUM_FUSIONS; ++i) {
+                Fusion_Enum fusion = (Fusion_Enum)i;
+                std::cerr << "  " << std::left << std::setw(18) << FUSION_NAMES[i];
+                std::cerr << cpu_handle.get_fusion_count(fusion) << "\n";
+        }
+}
 
+/**
+ * @brief runs the program, saving a checkpoint every so many instructions
+ * @details capable of exiting, helper function for main
+ */
+Run_Result run_with_checkpoints(CPU_Handle &cpu_handle, const Cmd_Options &life_opts) {
+        uint64_t interval = life_opts.checkpoint_interval;
+        if (interval == 0)
+                interval = DEFAULT_CHECKPOINT_INTERVAL;
+        while (true) {
+                Run_Result result = cpu_handle.run_for(interval);
+                if (!result.paused)
+                        return result;
+                // output up to here belongs to this checkpoint, so it
+                // can't be lost if the run is killed before the next one
+                std::cout.flush();
+                if (!cpu_handle.save_checkpoint(life_opts.checkpoint_path)) {
+                        std::cerr << "Failed to write checkpoint file\n";
+                        std::exit(1);
+                }
+        }
+}
+
+int main(int argc, char **argv) {
         Cmd_Options life_opts;
         life_opts.store_cmd_args(argc, argv);
         bool valid_cmd_arg_combo = life_opts.is_valid_args();
         if (!valid_cmd_arg_combo)
                 return 0;
 
-        // put assembled program here, so assembler module
-        //      doesn't require cpu_handle
-        std::vector<int16_t> final_program = {};
-        if (life_opts.is_binary_input) {
-                std::string file_path = argv[life_opts.input_file_idx];
-                populate_program_from_binary(final_program, file_path);
-        } else {
-                final_program = generate_program(argv, life_opts);
+        // every program in the manifest, instead of one
+        if (life_opts.batch)
+                return run_batch(life_opts);
+
+        // prints a trace, instead of running anything
+        if (life_opts.read_trace) {
+                Trace_Filter filter;
+                parse_trace_filter(life_opts.trace_filter, filter);
+                if (!print_trace(life_opts.read_trace_path, filter, std::cout)) {
+                        std::cerr << "Failed to read trace file\n";
+                        return 1;
+                }
+                return 0;
         }
 
-        // if test only flag is on, don't simulate program
-        if (!life_opts.test_only) {
-                CPU_Handle cpu_handle;
+        CPU_Handle cpu_handle;
+        std::map<int16_t, std::string> symbols; // only known when assembling the source
+        if (life_opts.restore) {
+                // the checkpoint holds the program too
+                if (!cpu_handle.load_checkpoint(life_opts.restore_path)) {
+                        std::cerr << "Failed to read checkpoint file\n";
+                        return 1;
+                }
+        } else {
+                // put assembled program here, so assembler module
+                //      doesn't require cpu_handle
+                std::vector<int16_t> final_program = {};
+                if (life_opts.is_binary_input) {
+                        std::string file_path = argv[life_opts.input_file_idx];
+                        if (!populate_program_from_binary(final_program, file_path)) {
+                                std::cerr << "Failed to open input file\n";
+                                return 1;
+                        }
+                } else {
+                        final_program = generate_program(argv, life_opts, symbols);
+                }
+
+                // translate instead of simulating
+                if (life_opts.emit_cpp) {
+                        std::string translation = translate_program(final_program, life_opts.seeded, life_opts.seed);
+                        if (!write_translation_to_sink(translation, life_opts.emit_cpp_path)) {
+                                std::cerr << "Failed to open C++ output file\n";
+                                std::exit(1);
+                        }
+                        return 0;
+                }
+
+                // if test only flag is on, don't simulate program
+                if (life_opts.test_only)
+                        return 0;
                 cpu_handle.load_program(final_program);
-                if (life_opts.is_debug)
-                        cpu_handle.run_program_debug();
-                else
-                        cpu_handle.run_program();
         }
+
+        // these files have to outlive every run
+        if (life_opts.program_input) {
+                Input_Format format = life_opts.raw_input ? INPUT_RAW : INPUT_TEXT;
+                if (!cpu_handle.map_input(life_opts.program_input_path, format)) {
+                        std::cerr << "Failed to open program input file\n";
+                        return 1;
+                }
+        }
+        std::ofstream raw_print_file;
+        if (life_opts.raw_print) {
+                raw_print_file.open(life_opts.raw_print_path, std::ios::binary);
+                if (raw_print_file.fail()) {
+                        std::cerr << "Failed to open raw print file\n";
+                        return 1;
+                }
+                cpu_handle.set_raw_print_stream(raw_print_file);
+        }
+        if (life_opts.seeded)
+                cpu_handle.seed_rand(life_opts.seed);
+        if (life_opts.has_limits()) {
+                cpu_handle.set_limits(Run_Limits{life_opts.max_instructions,
+                        life_opts.max_millis, life_opts.max_output_bytes,
+                        life_opts.max_input_reads});
+        }
+        std::ofstream record_file;
+        if (life_opts.record) {
+                record_file.open(life_opts.record_path, std::ios::binary);
+                if (record_file.fail()) {
+                        std::cerr << "Failed to open record file\n";
+                        return 1;
+                }
+                cpu_handle.record_io(record_file);
+        }
+        if (life_opts.replay && !cpu_handle.replay_io(life_opts.replay_path)) {
+                std::cerr << "Failed to read replay file\n";
+                return 1;
+        }
+
+        std::ofstream trace_file;
+        if (life_opts.trace) {
+                trace_file.open(life_opts.trace_path, std::ios::binary);
+                if (trace_file.fail()) {
+                        std::cerr << "Failed to open trace file\n";
+                        return 1;
+                }
+        }
+        Trace_Writer trace(trace_file);
+
+        std::ifstream debug_script_file;
+        std::ofstream debug_output_file;
+        if (life_opts.debug_script) {
+                debug_script_file.open(life_opts.debug_script_path);
+                if (debug_script_file.fail()) {
+                        std::cerr << "Failed to open debug script file\n";
+                        return 1;
+                }
+                debug_output_file.open(life_opts.debug_output_path);
+                if (debug_output_file.fail()) {
+                        std::cerr << "Failed to open debug output file\n";
+                        return 1;
+                }
+        }
+        Debug_Report debug_report(debug_output_file);
+
+        Run_Result result;
+        Profile profile;
+        if (life_opts.debug_script)
+                result = cpu_handle.run_program_debug_script(debug_script_file, debug_report, symbols);
+        else if (life_opts.is_debug)
+                result = cpu_handle.run_program_debug(symbols);
+        else if (life_opts.checkpoint)
+                result = run_with_checkpoints(cpu_handle, life_opts);
+        else if (life_opts.profile)
+                result = cpu_handle.run_program_profiled(profile);
+        else if (life_opts.trace)
+                result = cpu_handle.run_program_traced(trace);
+        else if (life_opts.engine == ENGINE_THREADED)
+                result = cpu_handle.run_program_threaded();
+        else if (life_opts.engine == ENGINE_JIT)
+                result = cpu_handle.run_program_jit();
+        else
+                result = cpu_handle.run_program();
+        if (life_opts.debug_script && !debug_report.flush()) {
+                std::cerr << "Failed to write debug output file\n";
+                return 1;
+        }
+        if (life_opts.trace && !trace.flush()) {
+                std::cerr << "Failed to write trace file\n";
+                return 1;
+        }
+        // a program that faulted is worth profiling too
+        if (life_opts.profile && !write_profile_report(life_opts.profile_path, cpu_handle, profile)) {
+                std::cerr << "Failed to write profile file\n";
+                return 1;
+        }
+        if (result.limit_hit != LIMIT_NONE) {
+                print_limit_report(result);
+                return 1 + (int)result.limit_hit;
+        }
+        if (result.faulted) {
+                print_runtime_error(result);
+                return 1;
+        }
+        if (life_opts.fusion_stats && !life_opts.is_debug)
+                print_fusion_stats(cpu_handle);
         return 0;
 }
@@ -0,0 +1,180 @@
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../token_types.h"
+#include "../assembler/assembler.h"
+#include "../assembler/tokenizer.h"
+#include "../simulator/cpu_handle.h"
+#include "batch_runner.h"
+#include "cmd_line_opts.h"
+#include "file_handling.h"
+
+bool read_manifest(const std::string &manifest_path, std::vector<Batch_Job> &jobs) {
+        std::ifstream manifest(manifest_path);
+        if (manifest.fail())
+                return false;
+        std::string line;
+        while (std::getline(manifest, line)) {
+                Batch_Job job;
+                std::stringstream aux_stream(line);
+                if (!(aux_stream >> job.program_path))
+                        continue;
+                aux_stream >> job.input_path;
+                job.output_path = job.program_path + ".out";
+                job.status = "";
+                jobs.push_back(job);
+        }
+        return true;
+}
+
+/**
+ * @brief same steps as generate_program, but reports grammar errors in
+ * job.status instead of exiting
+ * @details helper function of run_batch_job
+ */
+static bool assemble_job(Batch_Job &job, std::vector<int16_t> &program) {
+        std::string source_buffer;
+        if (!get_source_buffer(source_buffer, job.program_path, false)) {
+                job.status = "Failed to open input file";
+                return false;
+        }
+        std::vector<Token> tokens = create_tokens(source_buffer);
+        std::map<std::string, int16_t> label_map = create_label_map(tokens);
+        std::vector<Token> filtered_tokens;
+        for (Token curr_token : tokens) {
+                if (curr_token.type != T_LABEL_DEF)
+                        filtered_tokens.push_back(curr_token);
+        }
+
+        Debug_Info context = grammar_check(filtered_tokens, label_map);
+        if (context.grammar_retval != ACCEPTABLE_E) {
+                job.status = "Grammar Error: " + GRAMMAR_ERROR_MESSAGES[context.grammar_retval];
+                // same token as handle_grammar_error
+                if (context.grammar_retval != MISSING_EXIT_E
+                        && context.grammar_retval != MISSING_MAIN_E)
+                        job.status += " \"" + context.relevant_token.data + "\"";
+                job.status += " (line " + std::to_string(context.line_num) + ")";
+                return false;
+        }
+        program = assemble_program(filtered_tokens, label_map);
+        return true;
+}
+
+void run_batch_job(Batch_Job &job, const Cmd_Options &life_opts) {
+        std::vector<int16_t> program = {};
+        if (life_opts.is_binary_input) {
+                if (!populate_program_from_binary(program, job.program_path)) {
+                        job.status = "Failed to open input file";
+                        return;
+                }
+        } else if (!assemble_job(job, program)) {
+                return;
+        }
+
+        // no input file reads as an empty stdin
+        std::istringstream no_input;
+        std::ifstream input_file;
+        std::istream *input = &no_input;
+        if (!job.input_path.empty()) {
+                input_file.open(job.input_path);
+                if (input_file.fail()) {
+                        job.status = "Failed to open program input file";
+                        return;
+                }
+                input = &input_file;
+        }
+        std::ofstream output_file(job.output_path);
+        if (output_file.fail()) {
+                job.status = "Failed to open program output file";
+                return;
+        }
+
+        CPU_Handle cpu_handle;
+        cpu_handle.load_program(program);
+        cpu_handle.set_streams(*input, output_file);
+        if (life_opts.seeded)
+                cpu_handle.seed_rand(life_opts.seed);
+        if (life_opts.has_limits()) {
+                cpu_handle.set_limits(Run_Limits{life_opts.max_instructions,
+                        life_opts.max_millis, life_opts.max_output_bytes,
+                        life_opts.max_input_reads});
+        }
+        Run_Result result;
+        if (life_opts.engine == ENGINE_THREADED)
+                result = cpu_handle.run_program_threaded();
+        else if (life_opts.engine == ENGINE_JIT)
+                result = cpu_handle.run_program_jit();
+        else
+                result = cpu_handle.run_program();
+
+        if (result.limit_hit != LIMIT_NONE) {
+                job.status = "Limit Reached: " + LIMIT_MESSAGES[result.limit_hit];
+                job.status += " (address " + std::to_string(result.prog_ctr) + ", ";
+                job.status += std::to_string(result.usage.instructions) + " instructions)";
+        } else if (result.faulted) {
+                job.status = "Runtime Error: " + RUNTIME_ERROR_MESSAGES[result.error_code];
+                job.status += " (address " + std::to_string(result.prog_ctr) + ")";
+        } else {
+                job.status = "ok";
+        }
+}
+
+/**
+ * @brief takes jobs off the manifest until there are none left
+ * @details each thread of run_batch runs one of these
+ */
+static void run_batch_worker(
+        std::vector<Batch_Job> &jobs,
+        std::atomic<size_t> &next_job,
+        const Cmd_Options &life_opts
+) {
+        while (true) {
+                size_t job_idx = next_job++;
+                if (job_idx >= jobs.size())
+                        return;
+                // one bad program shouldn't take the rest of the batch down
+                try {
+                        run_batch_job(jobs[job_idx], life_opts);
+                } catch (const std::exception &error) {
+                        jobs[job_idx].status = "Internal Error: " + std::string(error.what());
+                }
+        }
+}
+
+int run_batch(const Cmd_Options &life_opts) {
+        std::vector<Batch_Job> jobs = {};
+        if (!read_manifest(life_opts.batch_manifest_path, jobs)) {
+                std::cerr << "Failed to open manifest file\n";
+                return 1;
+        }
+
+        size_t num_threads = (size_t)life_opts.num_jobs;
+        if (num_threads == 0)
+                num_threads = std::thread::hardware_concurrency();
+        if (num_threads > jobs.size())
+                num_threads = jobs.size();
+        if (num_threads == 0)
+                num_threads = 1;
+
+        std::atomic<size_t> next_job(0);
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < num_threads; ++i) {
+                workers.emplace_back(run_batch_worker, std::ref(jobs),
+                        std::ref(next_job), std::cref(life_opts));
+        }
+        for (std::thread &worker : workers)
+                worker.join();
+
+        for (const Batch_Job &job : jobs)
+                std::cout << job.program_path << ": " << job.status << "\n";
+        return 0;
+}
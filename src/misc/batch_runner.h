@@ -0,0 +1,44 @@
+#ifndef BATCH_RUNNER_H
+#define BATCH_RUNNER_H 1
+
+#include <string>
+#include <vector>
+
+#include "cmd_line_opts.h"
+
+/**
+ * @brief one program listed in a --batch manifest
+ */
+struct Batch_Job {
+        std::string program_path;
+        std::string input_path;  ///< empty if the program gets no input
+        std::string output_path; ///< program_path with ".out" appended
+        std::string status;      ///< filled in by run_batch_job
+};
+
+/**
+ * @brief reads the jobs of a --batch manifest
+ * @details one job per non-empty line: a program path, optionally followed
+ * by an input path. Paths can't hold whitespace. Returns false if the
+ * manifest can't be opened
+ */
+bool read_manifest(const std::string &manifest_path, std::vector<Batch_Job> &jobs);
+
+/**
+ * @brief assembles (or loads, with -b) and runs one job
+ * @details the program reads from its input file and writes to its own
+ * output file, so jobs can run on different threads at the same time.
+ * Nothing is printed, the result is left in job.status. helper function
+ * of run_batch
+ */
+void run_batch_job(Batch_Job &job, const Cmd_Options &life_opts);
+
+/**
+ * @brief runs every job of the manifest on life_opts.num_jobs threads
+ * @details prints one status line per job, in manifest order, once they
+ * are all done. Returns the process exit code: 0, or 1 if the manifest
+ * can't be read
+ */
+int run_batch(const Cmd_Options &life_opts);
+
+#endif
@@ -1,17 +1,79 @@
+#include <cctype>
 #include <iostream>
 #include <string>
 
 #include "cmd_line_opts.h"
+#include "../simulator/trace.h"
 
 Cmd_Options::Cmd_Options() {
         assemble_only         = false;
+        batch                 = false;
+        batch_manifest_path   = "";
+        checkpoint            = false;
+        checkpoint_path       = "";
+        checkpoint_interval   = 0;
+        bad_checkpoint_interval = false;
+        debug_output          = false;
+        debug_output_path     = "";
+        debug_script          = false;
+        debug_script_path     = "";
+        engine                = ENGINE_LOOP;
+        bad_engine            = false;
+        emit_cpp              = false;
+        emit_cpp_path         = "";
         executable_help       = false;
+        fusion_stats          = false;
         input_file_idx        = -1;
         intermediate_files    = false;
         is_binary_input       = false;
         is_debug              = false;
         is_stdin              = false;
+        max_instructions      = 0;
+        max_millis            = 0;
+        max_output_bytes      = 0;
+        max_input_reads       = 0;
+        bad_limit             = "";
+        num_jobs              = 0;
+        bad_jobs              = false;
+        profile               = false;
+        profile_path          = "";
+        program_input         = false;
+        program_input_path    = "";
+        raw_input             = false;
+        double_program_input  = false;
+        raw_print             = false;
+        raw_print_path        = "";
+        read_trace            = false;
+        read_trace_path       = "";
+        record                = false;
+        record_path           = "";
+        replay                = false;
+        replay_path           = "";
+        restore               = false;
+        restore_path          = "";
+        seeded                = false;
+        seed                  = 0;
+        bad_seed              = false;
         test_only             = false;
+        trace                 = false;
+        trace_path            = "";
+        trace_filtered        = false;
+        trace_filter          = "";
+}
+
+/**
+ * @brief parses a count for one of the --max-* flags
+ * @details false unless count is a number from 1 up, of at most 18
+ * digits. helper function of Cmd_Options::store_cmd_args
+ */
+static bool parse_limit(const std::string &count, uint64_t &limit) {
+        bool is_count = !count.empty() && count.length() <= 18;
+        for (char digit : count)
+                is_count = is_count && isdigit(digit);
+        if (!is_count || std::stoull(count) == 0)
+                return false;
+        limit = std::stoull(count);
+        return true;
 }
 
 /* auxiliary function to handle command line arguments
@@ -25,8 +87,134 @@ void Cmd_Options::store_cmd_args(const int argc, char ** const argv) {
                         assemble_only = true;
                 else if (curr_arg == "-b" || curr_arg == "--binary-input") 
                         is_binary_input = true;
+                else if (curr_arg == "--batch") {
+                        // manifest path is the next argument
+                        batch = true;
+                        batch_manifest_path = (i + 1 < argc) ? argv[++i] : "";
+                }
+                else if (curr_arg == "--checkpoint") {
+                        // checkpoint path is the next argument
+                        checkpoint = true;
+                        checkpoint_path = (i + 1 < argc) ? argv[++i] : "";
+                }
+                else if (curr_arg == "--checkpoint-every") {
+                        // instruction count is the next argument
+                        std::string count = (i + 1 < argc) ? argv[++i] : "";
+                        bool is_count = !count.empty() && count.length() <= 18;
+                        for (char digit : count)
+                                is_count = is_count && isdigit(digit);
+                        if (is_count && std::stoull(count) > 0)
+                                checkpoint_interval = std::stoull(count);
+                        else
+                                bad_checkpoint_interval = true;
+                }
+                else if (curr_arg == "--debug-output") {
+                        // report path is the next argument
+                        debug_output = true;
+                        debug_output_path = (i + 1 < argc) ? argv[++i] : "";
+                }
+                else if (curr_arg == "--debug-script") {
+                        // command file is the next argument
+                        debug_script = true;
+                        is_debug = true;
+                        debug_script_path = (i + 1 < argc) ? argv[++i] : "";
+                }
+                else if (curr_arg == "-e" || curr_arg == "--engine") {
+                        // engine name is the next argument
+                        std::string engine_name = (i + 1 < argc) ? argv[++i] : "";
+                        if (engine_name == "loop")
+                                engine = ENGINE_LOOP;
+                        else if (engine_name == "threaded")
+                                engine = ENGINE_THREADED;
+                        else if (engine_name == "jit")
+                                engine = ENGINE_JIT;
+                        else
+                                bad_engine = true;
+                }
+                else if (curr_arg == "--emit-cpp") {
+                        // output path is the next argument
+                        emit_cpp = true;
+                        emit_cpp_path = (i + 1 < argc) ? argv[++i] : "";
+                }
+                else if (curr_arg == "--fusion-stats")
+                        fusion_stats = true;
                 else if (curr_arg == "-h" || curr_arg == "--help") 
                         executable_help = true;
+                else if (curr_arg == "--input" || curr_arg == "--raw-input") {
+                        // program input path is the next argument
+                        double_program_input = program_input;
+                        program_input = true;
+                        raw_input = curr_arg == "--raw-input";
+                        program_input_path = (i + 1 < argc) ? argv[++i] : "";
+                }
+                else if (curr_arg == "-j" || curr_arg == "--jobs") {
+                        // job count is the next argument
+                        std::string count = (i + 1 < argc) ? argv[++i] : "";
+                        bool is_count = !count.empty() && count.length() <= 4;
+                        for (char digit : count)
+                                is_count = is_count && isdigit(digit);
+                        if (is_count && std::stoi(count) > 0)
+                                num_jobs = std::stoi(count);
+                        else
+                                bad_jobs = true;
+                }
+                else if (curr_arg == "--max-instructions" || curr_arg == "--max-time"
+                        || curr_arg == "--max-output" || curr_arg == "--max-input") {
+                        // limit is the next argument
+                        uint64_t *limit = &max_input_reads;
+                        if (curr_arg == "--max-instructions")
+                                limit = &max_instructions;
+                        else if (curr_arg == "--max-time")
+                                limit = &max_millis;
+                        else if (curr_arg == "--max-output")
+                                limit = &max_output_bytes;
+                        std::string count = (i + 1 < argc) ? argv[++i] : "";
+                        if (!parse_limit(count, *limit))
+                                bad_limit = curr_arg;
+                }
+                else if (curr_arg == "--profile") {
+                        // report path is the next argument
+                        profile = true;
+                        profile_path = (i + 1 < argc) ? argv[++i] : "";
+                }
+                else if (curr_arg == "--raw-print") {
+                        // output path is the next argument
+                        raw_print = true;
+                        raw_print_path = (i + 1 < argc) ? argv[++i] : "";
+                }
+                else if (curr_arg == "--read-trace") {
+                        // trace path is the next argument
+                        read_trace = true;
+                        read_trace_path = (i + 1 < argc) ? argv[++i] : "";
+                }
+                else if (curr_arg == "--record") {
+                        // log path is the next argument
+                        record = true;
+                        record_path = (i + 1 < argc) ? argv[++i] : "";
+                }
+                else if (curr_arg == "--replay") {
+                        // log path is the next argument
+                        replay = true;
+                        replay_path = (i + 1 < argc) ? argv[++i] : "";
+                }
+                else if (curr_arg == "--restore") {
+                        // checkpoint path is the next argument
+                        restore = true;
+                        restore_path = (i + 1 < argc) ? argv[++i] : "";
+                }
+                else if (curr_arg == "--seed") {
+                        // seed is the next argument
+                        std::string number = (i + 1 < argc) ? argv[++i] : "";
+                        bool is_number = !number.empty() && number.length() <= 19;
+                        for (char digit : number)
+                                is_number = is_number && isdigit(digit);
+                        if (is_number) {
+                                seeded = true;
+                                seed = std::stoull(number);
+                        } else {
+                                bad_seed = true;
+                        }
+                }
                 else if (curr_arg == "-s" || curr_arg == "--save-temps") 
                         intermediate_files = true;
                 else if (curr_arg == "-S" || curr_arg == "--use-stdin") 
@@ -35,6 +223,16 @@ void Cmd_Options::store_cmd_args(const int argc, char ** const argv) {
                         is_debug = true;
                 else if (curr_arg == "-t" || curr_arg == "--test-only") 
                         test_only = true;
+                else if (curr_arg == "--trace") {
+                        // trace path is the next argument
+                        trace = true;
+                        trace_path = (i + 1 < argc) ? argv[++i] : "";
+                }
+                else if (curr_arg == "--trace-filter") {
+                        // what to match is the next argument
+                        trace_filtered = true;
+                        trace_filter = (i + 1 < argc) ? argv[++i] : "";
+                }
                 else if (curr_arg[0] == '-') 
                         std::cout << "Unrecognized option: " << curr_arg << "\n";
                 else 
@@ -45,9 +243,131 @@ void Cmd_Options::store_cmd_args(const int argc, char ** const argv) {
 bool Cmd_Options::is_valid_args() {
         // combination of flags that are either incompatible or
         // cause an early return
+        Trace_Filter filter_unused;
         if (executable_help) {
                 print_help();
                 return false;
+        } else if (bad_engine) {
+                std::cout << "Flag Error: --engine expects one of: loop, threaded, jit\n";
+                return false;
+        } else if (bad_jobs) {
+                std::cout << "Flag Error: --jobs expects a count from 1 to 9999\n";
+                return false;
+        } else if (debug_script && debug_script_path.empty()) {
+                std::cout << "Flag Error: --debug-script expects a command file\n";
+                return false;
+        } else if (debug_output && debug_output_path.empty()) {
+                std::cout << "Flag Error: --debug-output expects an output file\n";
+                return false;
+        } else if (debug_script != debug_output) {
+                std::cout << "Flag Error: --debug-script and --debug-output need";
+                std::cout << " each other\n";
+                return false;
+        } else if (batch && batch_manifest_path.empty()) {
+                std::cout << "Flag Error: --batch expects a manifest file\n";
+                return false;
+        } else if (batch && (is_debug || is_stdin || assemble_only || emit_cpp || test_only)) {
+                std::cout << "Flag Error: --batch runs every program in the manifest,";
+                std::cout << " and can't be combined with -a, -d, -S, -t or --emit-cpp\n";
+                return false;
+        } else if (program_input && program_input_path.empty()) {
+                std::cout << "Flag Error: --input and --raw-input expect a file\n";
+                return false;
+        } else if (double_program_input) {
+                std::cout << "Flag Error: --input and --raw-input both give the";
+                std::cout << " program's input, pick one\n";
+                return false;
+        } else if (raw_print && raw_print_path.empty()) {
+                std::cout << "Flag Error: --raw-print expects an output file\n";
+                return false;
+        } else if (batch && (program_input || raw_print || record || replay)) {
+                std::cout << "Flag Error: --batch gives every program its own input";
+                std::cout << " and output files, and can't be combined with --input,";
+                std::cout << " --raw-input, --raw-print, --record or --replay\n";
+                return false;
+        } else if (bad_seed) {
+                std::cout << "Flag Error: --seed expects a number from 0 to";
+                std::cout << " 9999999999999999999\n";
+                return false;
+        } else if (record && record_path.empty()) {
+                std::cout << "Flag Error: --record expects an output file\n";
+                return false;
+        } else if (replay && replay_path.empty()) {
+                std::cout << "Flag Error: --replay expects a log file\n";
+                return false;
+        } else if (record && replay) {
+                std::cout << "Flag Error: --record and --replay can't be combined\n";
+                return false;
+        } else if (replay && program_input) {
+                std::cout << "Flag Error: --replay takes the program's input from";
+                std::cout << " the log, and can't be combined with --input or --raw-input\n";
+                return false;
+        } else if (!bad_limit.empty()) {
+                std::cout << "Flag Error: " << bad_limit << " expects a count from 1 up\n";
+                return false;
+        } else if (has_limits() && (is_debug || checkpoint)) {
+                std::cout << "Flag Error: --max-instructions, --max-time, --max-output";
+                std::cout << " and --max-input can't be combined with -d or --checkpoint\n";
+                return false;
+        } else if (profile && profile_path.empty()) {
+                std::cout << "Flag Error: --profile expects an output file\n";
+                return false;
+        } else if (profile && (is_debug || checkpoint || batch || has_limits())) {
+                std::cout << "Flag Error: --profile can't be combined with -d, --batch,";
+                std::cout << " --checkpoint or the --max-* flags\n";
+                return false;
+        } else if (trace && trace_path.empty()) {
+                std::cout << "Flag Error: --trace expects an output file\n";
+                return false;
+        } else if (trace && (is_debug || checkpoint || batch || profile || has_limits())) {
+                std::cout << "Flag Error: --trace can't be combined with -d, --batch,";
+                std::cout << " --checkpoint, --profile or the --max-* flags\n";
+                return false;
+        } else if (read_trace && read_trace_path.empty()) {
+                std::cout << "Flag Error: --read-trace expects a trace file\n";
+                return false;
+        } else if (read_trace && (input_file_idx != -1 || is_stdin || batch || restore || trace)) {
+                std::cout << "Flag Error: --read-trace prints a trace instead of running a";
+                std::cout << " program, and can't be combined with an input file, -S,";
+                std::cout << " --batch, --restore or --trace\n";
+                return false;
+        } else if (trace_filtered && !read_trace) {
+                std::cout << "Flag Error: --trace-filter needs --read-trace\n";
+                return false;
+        } else if (trace_filtered && !parse_trace_filter(trace_filter, filter_unused)) {
+                std::cout << "Flag Error: --trace-filter expects a mnemonic, a register";
+                std::cout << " or a program address\n";
+                return false;
+        } else if (checkpoint && checkpoint_path.empty()) {
+                std::cout << "Flag Error: --checkpoint expects a file\n";
+                return false;
+        } else if (bad_checkpoint_interval) {
+                std::cout << "Flag Error: --checkpoint-every expects a count of instructions\n";
+                return false;
+        } else if (checkpoint_interval != 0 && !checkpoint) {
+                std::cout << "Flag Error: --checkpoint-every needs --checkpoint\n";
+                return false;
+        } else if (checkpoint && (is_debug || assemble_only || batch || emit_cpp || test_only)) {
+                std::cout << "Flag Error: --checkpoint can't be combined with -a, -d, -t,";
+                std::cout << " --batch or --emit-cpp. With -d, use the debugger's";
+                std::cout << " checkpoint command\n";
+                return false;
+        } else if (restore && restore_path.empty()) {
+                std::cout << "Flag Error: --restore expects a checkpoint file\n";
+                return false;
+        } else if (restore && (is_binary_input || is_stdin || assemble_only || batch
+                || emit_cpp || test_only || input_file_idx != -1)) {
+                std::cout << "Flag Error: --restore runs the program saved in the checkpoint,";
+                std::cout << " and can't be combined with an input file, -a, -b, -S, -t,";
+                std::cout << " --batch or --emit-cpp\n";
+                return false;
+        } else if (emit_cpp && emit_cpp_path.empty()) {
+                std::cout << "Flag Error: --emit-cpp expects an output file\n";
+                return false;
+        } else if (emit_cpp && assemble_only) {
+                std::cout << "Flag Error: --emit-cpp and --assemble-only both";
+                std::cout << " write the program out, pick one\n";
+                return false;
         } else if (assemble_only && is_binary_input) {
                 std::cout << "Flag Error: Binary input is redundant, and will";
                 std::cout << "not be regenerated with --assemble-only\n";
@@ -64,7 +384,7 @@ bool Cmd_Options::is_valid_args() {
                 std::cout << "Flag Error: Cannot accept binary file input and";
                 std::cout << "stdin input in the same command call\n";
                 return false;
-        } else if (!is_stdin && input_file_idx == -1) {
+        } else if (!is_stdin && !batch && !restore && !read_trace && input_file_idx == -1) {
                 std::cout << "Flag Warning: Did not provide an input file, ";
                 std::cout << "and --use-stdin is not flagged.\nIf you are a first ";
                 std::cout << "time user, run with -h or --help for usage\n";
@@ -73,6 +393,11 @@ bool Cmd_Options::is_valid_args() {
         return true;
 }
 
+bool Cmd_Options::has_limits() const {
+        return max_instructions != 0 || max_millis != 0
+                || max_output_bytes != 0 || max_input_reads != 0;
+}
+
 // misc: man page style: see cbonsai tool
 void print_help() {
         std::string help_buffer = 
@@ -86,10 +411,91 @@ void print_help() {
         "      assemble ascii source file (or stdin when used with -S) into a binary file, and quit.\n\n"
         "  -b, --binary-input\n"
         "      use a preassembled binary file instead of a ascii source file\n\n"
+        "  --batch \x1b[4mmanifest\x1b[0m\n"
+        "      run every program listed in the manifest, several at once. each line holds\n"
+        "      a program (a binary with -b), optionally followed by a file to use as its\n"
+        "      stdin. a program's output goes to the program's path plus \".out\", and\n"
+        "      one status line per program is printed in manifest order\n\n"
+        "  --checkpoint \x1b[4mfile\x1b[0m\n"
+        "      save the program's state to the file every so many instructions, see\n"
+        "      --checkpoint-every. a killed run can carry on from the last one with\n"
+        "      --restore. runs one instruction at a time, so -e is ignored\n\n"
+        "  --checkpoint-every \x1b[4mcount\x1b[0m\n"
+        "      instructions between checkpoints, 100000000 by default\n\n"
         "  -d, --debug\n"
         "      enable PAL debugger (pdb) when running user program\n\n"
+        "  --debug-output \x1b[4mfile\x1b[0m\n"
+        "      where --debug-script writes what happened, one JSON object a line: every\n"
+        "      stop with the registers and stack, every print, every command that\n"
+        "      failed, and how the session ended\n\n"
+        "  --debug-script \x1b[4mfile\x1b[0m\n"
+        "      run the PAL debugger with the commands in the file, one a line, instead\n"
+        "      of reading them from the terminal. lines starting with # are skipped,\n"
+        "      and running out of commands quits. implies -d, and needs --debug-output\n\n"
+        "  -e, --engine \x1b[4mname\x1b[0m\n"
+        "      choose how the program is simulated: \"loop\" (default), \"threaded\" or \"jit\".\n"
+        "      threaded dispatches each instruction through its own jump, with the\n"
+        "      common register and literal forms of MOV, INC, DEC, ADD, SUB, CMP and\n"
+        "      the jumps run inline, and needs a gcc or clang build. jit compiles the\n"
+        "      program to native code on x86-64 linux, and is the fastest for long\n"
+        "      running programs. ignored with -d\n\n"
+        "  --emit-cpp \x1b[4mfile\x1b[0m\n"
+        "      translate the assembled program (or the binary given with -b) into a\n"
+        "      standalone C++ file, and quit without running it. build the output with\n"
+        "      g++ -O2 for a native executable of the program\n\n"
+        "  --fusion-stats\n"
+        "      after the program exits, print how often each fused instruction\n"
+        "      sequence ran instead of its separate instructions. ignored with -d\n\n"
         "  -h, --help\n"
         "      show this help screen\n\n"
+        "  --input \x1b[4mfile\x1b[0m\n"
+        "      INPUT and SINPUT read lines of the file instead of stdin, same as\n"
+        "      redirecting it, but the file is memory-mapped rather than streamed.\n"
+        "      much faster for programs that read a lot of input\n\n"
+        "  -j, --jobs \x1b[4mcount\x1b[0m\n"
+        "      how many programs --batch runs at once. defaults to one per core\n\n"
+        "  --max-input \x1b[4mcount\x1b[0m\n"
+        "      stop the program when it tries to INPUT or SINPUT more than count times\n\n"
+        "  --max-instructions \x1b[4mcount\x1b[0m\n"
+        "      stop the program once it has run count instructions, checked whenever\n"
+        "      it jumps, calls or returns\n\n"
+        "  --max-output \x1b[4mbytes\x1b[0m\n"
+        "      stop the program once it prints more than bytes bytes. nothing past\n"
+        "      them is printed\n\n"
+        "  --max-time \x1b[4mmilliseconds\x1b[0m\n"
+        "      stop the program once it has run for this long. with any of the\n"
+        "      --max-* flags, the program runs on the loop engine, so -e is ignored.\n"
+        "      a stopped program prints how far it got to stderr, and pal_assembler\n"
+        "      exits with 2 (instructions), 3 (time), 4 (output) or 5 (input)\n\n"
+        "  --profile \x1b[4mfile\x1b[0m\n"
+        "      count how often every instruction runs and every jump is taken, and\n"
+        "      write the hottest instructions, basic blocks and loops to the file\n"
+        "      once the program ends. runs on the loop engine, so -e is ignored\n\n"
+        "  --raw-input \x1b[4mfile\x1b[0m\n"
+        "      like --input, but the file holds little endian 16 bit words. INPUT\n"
+        "      reads one word, and SINPUT reads words up to a 0 word. INPUT past\n"
+        "      the end of the file is a runtime error\n\n"
+        "  --raw-print \x1b[4mfile\x1b[0m\n"
+        "      PRINT writes each value to the file as a little endian 16 bit word,\n"
+        "      instead of in decimal to stdout. CPRINT and SPRINT still go to stdout\n\n"
+        "  --read-trace \x1b[4mfile\x1b[0m\n"
+        "      print a trace written by --trace, one instruction a line with what it\n"
+        "      wrote, instead of running a program\n\n"
+        "  --record \x1b[4mfile\x1b[0m\n"
+        "      log every RAND result and every line (or word, with --raw-input) the\n"
+        "      program reads to the file, so the run can be repeated with --replay\n\n"
+        "  --replay \x1b[4mfile\x1b[0m\n"
+        "      take RAND results and input from a log written by --record, instead\n"
+        "      of drawing them and reading stdin. the program has to read them in\n"
+        "      the same order, or it stops with a runtime error\n\n"
+        "  --restore \x1b[4mfile\x1b[0m\n"
+        "      carry on running the program saved in a checkpoint file, from where it\n"
+        "      was saved, instead of assembling an input file. works with -d, -e and\n"
+        "      --checkpoint. the program reads the rest of its input from stdin\n\n"
+        "  --seed \x1b[4mnumber\x1b[0m\n"
+        "      seed RAND, so it gives the same results on every run, and in the\n"
+        "      translation written by --emit-cpp. otherwise it's seeded from the\n"
+        "      system's entropy source\n\n"
         "  -s, --save-temps\n"
         "      create intermediate ascii files for tokenizer and label table.\n\n"
         "  -S, --use-stdin\n"
@@ -98,6 +504,13 @@ void print_help() {
         "  -t, --test-only\n"
         "      go through the assembler process, but do not simulate the"
               "program.\n    most useful with -s, or to experiment with errors\n\n"
+        "  --trace \x1b[4mfile\x1b[0m\n"
+        "      write a compact binary record of every instruction the program runs,\n"
+        "      with the registers and memory it wrote, to the file. read it back with\n"
+        "      --read-trace. runs on the loop engine, so -e is ignored\n\n"
+        "  --trace-filter \x1b[4mmnemonic|register|address\x1b[0m\n"
+        "      with --read-trace, only print the instructions with that mnemonic, that\n"
+        "      wrote that register, or at that program address\n\n"
         "For a tutorial, read docs/tutorial.md\n"
         "For examples, see examples folder or testing/testing_suite.sh\n\n";
         std::cout << help_buffer;
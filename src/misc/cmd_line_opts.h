@@ -1,26 +1,87 @@
 #ifndef CMD_LINE_OPTS_H
 #define CMD_LINE_OPTS_H 1
 
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <map>
 
+/**
+ * @brief choice of loop that runs the simulated program
+ */
+enum Engine_Enum {
+        ENGINE_LOOP,     ///< next_instruction in a loop, default
+        ENGINE_THREADED, ///< direct threaded dispatch, gcc and clang only
+        ENGINE_JIT,      ///< native code blocks, x86-64 linux only
+};
+
+/**
+ * @brief instructions between checkpoints, if --checkpoint-every isn't given
+ */
+const uint64_t DEFAULT_CHECKPOINT_INTERVAL = 100000000;
+
 /**
  * @brief container for cmd line inputs and flags
  */
 struct Cmd_Options {
         bool assemble_only;      ///< -c
+        bool batch;              ///< --batch
+        std::string batch_manifest_path; ///< file given to --batch
+        bool checkpoint;         ///< --checkpoint
+        std::string checkpoint_path; ///< file given to --checkpoint
+        uint64_t checkpoint_interval; ///< --checkpoint-every, 0 if not given
+        bool bad_checkpoint_interval; ///< --checkpoint-every given a bad count
+        bool debug_output;       ///< --debug-output
+        std::string debug_output_path; ///< file given to --debug-output
+        bool debug_script;       ///< --debug-script, sets is_debug too
+        std::string debug_script_path; ///< file given to --debug-script
+        Engine_Enum engine;      ///< -e
+        bool bad_engine;         ///< -e given an unknown name
+        bool emit_cpp;           ///< --emit-cpp
+        std::string emit_cpp_path; ///< file given to --emit-cpp
         bool executable_help;    ///< -h
+        bool fusion_stats;       ///< --fusion-stats
         int  input_file_idx;     ///< init to -1
         bool intermediate_files; ///< -s
         bool is_binary_input;    ///< -b
         bool is_debug;           ///< -d
         bool is_stdin;           ///< -S
+        uint64_t max_instructions; ///< --max-instructions, 0 if not given
+        uint64_t max_millis;     ///< --max-time, 0 if not given
+        uint64_t max_output_bytes; ///< --max-output, 0 if not given
+        uint64_t max_input_reads; ///< --max-input, 0 if not given
+        std::string bad_limit;   ///< a --max-* flag given a bad count, if any
+        int  num_jobs;           ///< -j, 0 for one per core
+        bool bad_jobs;           ///< -j given a bad count
+        bool profile;            ///< --profile
+        std::string profile_path; ///< file given to --profile
+        bool program_input;      ///< --input or --raw-input
+        std::string program_input_path; ///< file given to --input or --raw-input
+        bool raw_input;          ///< --raw-input
+        bool double_program_input; ///< --input or --raw-input given twice
+        bool raw_print;          ///< --raw-print
+        std::string raw_print_path; ///< file given to --raw-print
+        bool read_trace;         ///< --read-trace
+        std::string read_trace_path; ///< file given to --read-trace
+        bool record;             ///< --record
+        std::string record_path; ///< file given to --record
+        bool replay;             ///< --replay
+        std::string replay_path; ///< file given to --replay
+        bool restore;            ///< --restore
+        std::string restore_path; ///< file given to --restore
+        bool seeded;             ///< --seed
+        uint64_t seed;           ///< --seed
+        bool bad_seed;           ///< --seed given a bad number
         bool test_only;          ///< -t
+        bool trace;              ///< --trace
+        std::string trace_path;  ///< file given to --trace
+        bool trace_filtered;     ///< --trace-filter
+        std::string trace_filter; ///< what --trace-filter was given
 
         Cmd_Options();
         void store_cmd_args(const int argc, char ** const argv); ///< store flags
         bool is_valid_args(); ///< ensures combination of args are valid
+        bool has_limits() const; ///< whether any --max-* flag was given
 };
 
 
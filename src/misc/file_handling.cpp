@@ -1,5 +1,4 @@
 #include <cstdint>
-#include <cstdlib>
 #include <vector>
 #include <fstream>
 #include <iomanip>
@@ -10,16 +9,14 @@
 #include "../token_types.h"
 #include "file_handling.h"
 
-void generate_intermediate_file(
+bool generate_intermediate_file(
         const std::string &file_header,
         const std::vector<Token> &tokens,
         const std::map<std::string, int16_t> &label_table
 ) {
         std::ofstream sink_file("intermediate_" + file_header + ".txt");
-        if (sink_file.fail()) {
-                std::cerr << "Failed to open token sink file\n";
-                std::exit(1);
-        }
+        if (sink_file.fail())
+                return false;
         // print tokens and their types
         for (const Token &i: tokens) {
                 sink_file << std::left << std::setw(20);
@@ -59,13 +56,15 @@ void generate_intermediate_file(
                 sink_file << (it->second) << "\n";
         }
         sink_file.close();
+        return true;
 }
 
-std::string get_source_buffer(
+bool get_source_buffer(
+        std::string &source_buffer,
         const std::string &source_path,
         const bool &use_stdin
 ) {
-        std::string source_buffer = "";
+        source_buffer = "";
         if (use_stdin) {
                 std::string aux_string = "";
                 do {
@@ -74,10 +73,8 @@ std::string get_source_buffer(
                 } while (aux_string != "");
         } else {
                 std::ifstream source_file(source_path);
-                if (source_file.fail()) {
-                        std::cerr << "Failed to open input file\n";
-                        std::exit(1);
-                }
+                if (source_file.fail())
+                        return false;
                 source_file.seekg(0, std::ios_base::end);
                 size_t file_size = source_file.tellg();
                 source_file.seekg(0, std::ios_base::beg);
@@ -86,18 +83,16 @@ std::string get_source_buffer(
                 source_file.close();
 
         }
-        return source_buffer;
+        return true;
 }
 
-void populate_program_from_binary(
+bool populate_program_from_binary(
         std::vector<int16_t> &program,
         const std::string &file_path
 ) {
         std::ifstream source_bin(file_path, std::ios::binary);
-        if (source_bin.fail()) {
-                std::cerr << "Failed to open input file\n";
-                std::exit(1);
-        }
+        if (source_bin.fail())
+                return false;
         // move ptr to end of file, read ptr pos, move ptr to start of file
         source_bin.seekg(0, std::ios_base::end);
         size_t file_size = source_bin.tellg();
@@ -108,6 +103,7 @@ void populate_program_from_binary(
                 int16_t final = (upper << 8) | lower;
                 program.push_back(final);
         }
+        return true;
 }
 
 bool write_program_to_sink(
@@ -123,3 +119,14 @@ bool write_program_to_sink(
                 sink_file.write((char*) &i, sizeof(int16_t));
         return true;
 }
+
+bool write_translation_to_sink(
+        const std::string &translation,
+        const std::string &file_path
+) {
+        std::ofstream sink_file(file_path);
+        if (sink_file.fail())
+                return false;
+        sink_file << translation;
+        return true;
+}
@@ -11,26 +11,29 @@
 
 /**
  * @brief generates file of program's label_table and filtered_tokens
+ * @details returns false if the file can't be opened
  */
-void generate_intermediate_file(
+bool generate_intermediate_file(
         const std::string &file_header,
         const std::vector<Token> &tokens,
         const std::map<std::string, int16_t> &label_table
 );
 
 /**
- * @brief gets user program, either from file or stdin
- * @details may exit if source_path fails
+ * @brief gets user program, either from file or stdin, into source_buffer
+ * @details returns false if source_path can't be opened
  */
-std::string get_source_buffer(
+bool get_source_buffer(
+        std::string &source_buffer,
         const std::string &source_path,
         const bool &use_stdin
 );
 
 /**
  * @brief populates final program from input if -b flag is given
+ * @details returns false if file_path can't be opened
  */
-void populate_program_from_binary(
+bool populate_program_from_binary(
         std::vector<int16_t> &program,
         const std::string &filepath
 );
@@ -43,4 +46,12 @@ bool write_program_to_sink(
         const std::string &header
 );
 
+/**
+ * @brief writes the C++ translation of a program to file_path
+ */
+bool write_translation_to_sink(
+        const std::string &translation,
+        const std::string &file_path
+);
+
 #endif
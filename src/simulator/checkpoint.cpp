@@ -0,0 +1,226 @@
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../common_values.h"
+#include "../instruction_types.h"
+#include "cpu_handle.h"
+
+// checkpoint files for CPU_Handle::save_checkpoint and load_checkpoint
+// every value is a little endian int16_t word, same as a .bin file:
+//     magic "PCKT", then the layout version
+//     prog_size, then the program itself
+//     every register, in Register_Enum order (RIP is prog_ctr)
+//     the RAND generator's state, low word first (not in version 1)
+//     call_stack_ptr, then the call stack up to it
+//     one flag per page of ram, then the 256 words of every flagged page
+// pages that are all zero aren't flagged, so they take up one word
+
+static const int16_t CHECKPOINT_MAGIC[4] = {'P', 'C', 'K', 'T'};
+static const int16_t CHECKPOINT_VERSION = 2;
+
+/**
+ * @brief appends word to the file
+ * @details helper function of CPU_Handle::save_checkpoint
+ */
+static void write_word(std::ofstream &sink_file, const int16_t word) {
+        const char bytes[2] = {(char)(word & 255), (char)((word >> 8) & 255)};
+        sink_file.write(bytes, 2);
+}
+
+/**
+ * @brief next word of a checkpoint, false if there are none left
+ * @details helper function of CPU_Handle::load_checkpoint
+ */
+static bool read_word(const std::vector<int16_t> &words, size_t &word_idx, int16_t &word) {
+        if (word_idx >= words.size())
+                return false;
+        word = words[word_idx++];
+        return true;
+}
+
+bool CPU_Handle::save_checkpoint(const std::string &file_path) const {
+        // written next to the old checkpoint, which is only replaced once
+        // this one is complete
+        std::string temp_path = file_path + ".tmp";
+        std::ofstream sink_file(temp_path, std::ios::binary);
+        if (sink_file.fail())
+                return false;
+
+        for (int16_t word : CHECKPOINT_MAGIC)
+                write_word(sink_file, word);
+        write_word(sink_file, CHECKPOINT_VERSION);
+        write_word(sink_file, prog_size);
+        for (int16_t i = 0; i < prog_size; ++i)
+                write_word(sink_file, program_data[i]);
+        for (int i = 0; i < NUM_REGISTERS; ++i)
+                write_word(sink_file, registers[i]);
+        for (uint64_t state_word : prng.state) {
+                for (int shift = 0; shift < 64; shift += 16)
+                        write_word(sink_file, (int16_t)(state_word >> shift));
+        }
+        write_word(sink_file, call_stack_ptr);
+        for (int16_t i = 0; i < call_stack_ptr; ++i)
+                write_word(sink_file, read_call_stack(i));
+
+        bool is_used[NUM_RAM_PAGES];
+        for (int page = 0; page < NUM_RAM_PAGES; ++page) {
+                is_used[page] = false;
+                for (int i = 0; i < MEMORY_PAGE_SIZE; ++i)
+                        is_used[page] = is_used[page] || read_ram(page * MEMORY_PAGE_SIZE + i) != 0;
+                write_word(sink_file, (int16_t)is_used[page]);
+        }
+        for (int page = 0; page < NUM_RAM_PAGES; ++page) {
+                if (!is_used[page])
+                        continue;
+                for (int i = 0; i < MEMORY_PAGE_SIZE; ++i)
+                        write_word(sink_file, read_ram(page * MEMORY_PAGE_SIZE + i));
+        }
+
+        sink_file.close();
+        if (sink_file.fail())
+                return false;
+#ifdef _WIN32
+        // rename doesn't replace an existing file on windows
+        std::remove(file_path.c_str());
+#endif
+        return std::rename(temp_path.c_str(), file_path.c_str()) == 0;
+}
+
+/**
+ * @brief whether the saved prog_ctr and call stack are places the program can be
+ * @details prog_ctr has to be 0 (not started yet) or the start of an
+ * instruction, found by walking the instruction stream after the string
+ * table, and every return address has to be the instruction right after a
+ * CALL. Otherwise the engines would index past the decoded program. helper
+ * function of CPU_Handle::load_checkpoint
+ */
+static bool is_valid_resume(
+        const std::vector<int16_t> &saved_program,
+        const int16_t saved_rip,
+        const std::vector<int16_t> &saved_call_stack
+) {
+        const int16_t saved_size = (int16_t)saved_program.size();
+        std::vector<uint8_t> is_start(saved_size, 0);
+        std::vector<uint8_t> is_after_call(saved_size, 0);
+        int16_t address = 5; // SA, NT, IA, GO, main
+        while (address < saved_size && saved_program[address - 1] != (int16_t)0xffff)
+                address++;
+        while (address < saved_size) {
+                const Instruction_Data &instruction = get_instruction(saved_program[address]);
+                if (address + (int)instruction.length > saved_size)
+                        break;
+                is_start[address] = 1;
+                address += (int16_t)instruction.length;
+                if (instruction.opcode == OP_CALL && address < saved_size)
+                        is_after_call[address] = 1;
+        }
+
+        if (saved_rip != 0 && !is_start[saved_rip])
+                return false;
+        for (int16_t return_address : saved_call_stack) {
+                if (return_address < 0 || return_address >= saved_size || !is_after_call[return_address])
+                        return false;
+        }
+        return true;
+}
+
+bool CPU_Handle::load_checkpoint(const std::string &file_path) {
+        std::ifstream source_file(file_path, std::ios::binary);
+        if (source_file.fail())
+                return false;
+        std::vector<int16_t> words;
+        int lower = 0;
+        while ((lower = source_file.get()) != EOF) {
+                int upper = source_file.get();
+                if (upper == EOF)
+                        return false;
+                words.push_back((int16_t)((upper << 8) | lower));
+        }
+
+        // read everything before touching this handle
+        size_t word_idx = 0;
+        int16_t word = 0;
+        for (int16_t magic_word : CHECKPOINT_MAGIC) {
+                if (!read_word(words, word_idx, word) || word != magic_word)
+                        return false;
+        }
+        // version 1 checkpoints load too, keeping the current RAND state
+        int16_t version = 0;
+        if (!read_word(words, word_idx, version) || version < 1 || version > CHECKPOINT_VERSION)
+                return false;
+        int16_t saved_size = 0;
+        if (!read_word(words, word_idx, saved_size) || saved_size < 6)
+                return false;
+        std::vector<int16_t> saved_program(saved_size);
+        for (int16_t &saved_word : saved_program) {
+                if (!read_word(words, word_idx, saved_word))
+                        return false;
+        }
+        int16_t saved_registers[NUM_REGISTERS];
+        for (int16_t &saved_register : saved_registers) {
+                if (!read_word(words, word_idx, saved_register))
+                        return false;
+        }
+        Prng saved_prng = prng;
+        if (version >= 2) {
+                for (uint64_t &state_word : saved_prng.state) {
+                        state_word = 0;
+                        for (int shift = 0; shift < 64; shift += 16) {
+                                if (!read_word(words, word_idx, word))
+                                        return false;
+                                state_word |= (uint64_t)(uint16_t)word << shift;
+                        }
+                }
+        }
+        const int16_t saved_rsp = saved_registers[REG_RSP];
+        const int16_t saved_rip = saved_registers[REG_RIP];
+        if (saved_rsp < 0 || saved_rsp > STACK_SIZE)
+                return false;
+        if (saved_rip < 0 || saved_rip >= saved_size)
+                return false;
+        int16_t saved_call_stack_ptr = 0;
+        if (!read_word(words, word_idx, saved_call_stack_ptr))
+                return false;
+        if (saved_call_stack_ptr < 0 || saved_call_stack_ptr > CALL_STACK_SIZE)
+                return false;
+        std::vector<int16_t> saved_call_stack(saved_call_stack_ptr);
+        for (int16_t &saved_return : saved_call_stack) {
+                if (!read_word(words, word_idx, saved_return))
+                        return false;
+        }
+        int16_t is_used[NUM_RAM_PAGES];
+        for (int16_t &flag : is_used) {
+                if (!read_word(words, word_idx, flag) || (flag != 0 && flag != 1))
+                        return false;
+        }
+        std::vector<int16_t> saved_ram(RAM_SIZE, 0);
+        for (int page = 0; page < NUM_RAM_PAGES; ++page) {
+                if (!is_used[page])
+                        continue;
+                for (int i = 0; i < MEMORY_PAGE_SIZE; ++i) {
+                        if (!read_word(words, word_idx, saved_ram[page * MEMORY_PAGE_SIZE + i]))
+                                return false;
+                }
+        }
+        if (word_idx != words.size())
+                return false;
+        if (!is_valid_resume(saved_program, saved_rip, saved_call_stack))
+                return false;
+
+        load_program(saved_program);
+        // the verifier only followed the program from main, not from
+        // wherever this checkpoint left it, so the checked loop runs
+        verified = false;
+        for (int i = 0; i < NUM_REGISTERS; ++i)
+                registers[i] = saved_registers[i];
+        prng = saved_prng;
+        call_stack_ptr = saved_call_stack_ptr;
+        for (int16_t i = 0; i < saved_call_stack_ptr; ++i)
+                write_call_stack(i, saved_call_stack[i]);
+        for (int16_t address = 0; address < RAM_SIZE; ++address)
+                write_ram(address, saved_ram[address]);
+        return true;
+}
@@ -4,8 +4,12 @@
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <random>
 #include <string>
+#include <string_view>
 #include <sstream>
+#include <utility>
 #include <vector>
 
 #ifdef _WIN32
@@ -18,89 +22,142 @@
 #include "../common_values.h"
 #include "../instruction_types.h"
 #include "cpu_handle.h"
+#include "debug_breakpoints.h"
+#include "debug_history.h"
+#include "debug_report.h"
+#include "disassembly.h"
 #include "pal_debugger.h"
 #include "instructions.h"
+#include "verifier.h"
+
+// what every page of a new CPU_Handle reads from, until it's written
+static const int16_t ZERO_PAGE[MEMORY_PAGE_SIZE] = {};
+
+/**
+ * @brief where page starts in memory
+ * @details helper function of CPU_Handle::own_page
+ */
+static int16_t *page_start(CPU_Memory *memory, const int page) {
+        if (page < NUM_RAM_PAGES)
+                return memory->program_mem + page * MEMORY_PAGE_SIZE;
+        return memory->call_stack + (page - NUM_RAM_PAGES) * MEMORY_PAGE_SIZE;
+}
+
+Memory_Snapshot::Memory_Snapshot(
+        CPU_Memory *given_memory,
+        std::shared_ptr<const Memory_Snapshot> given_parent
+) {
+        memory = given_memory;
+        parent = given_parent;
+}
 
-extern std::map<std::string, Instruction_Data> BLUEPRINTS;
+Memory_Snapshot::~Memory_Snapshot() {
+        delete memory;
+        memory = nullptr;
+}
 
 CPU_Handle::CPU_Handle() {
-        reg_a = 0;
-        reg_b = 0;
-        reg_c = 0;
-        reg_d = 0;
-        reg_e = 0;
-        reg_f = 0;
-        reg_g = 0;
-        reg_h = 0;
-        reg_cmp_a = 0;
-        reg_cmp_b = 0;
-        prog_ctr  = 0;
+        for (int i = 0; i < NUM_REGISTERS; ++i)
+                registers[i] = 0;
         prog_size = 0;
-        stack_ptr = 0;
         call_stack_ptr = 0;
-        // i know int16_t should always be 2 bytes by definition, but whatever
-        memset(call_stack, 0, sizeof(int16_t) * CALL_STACK_SIZE);
-        memset(program_mem, 0, sizeof(int16_t) * STACK_SIZE);
+        for (int i = 0; i < NUM_FUSIONS; ++i)
+                fusion_counts[i] = 0;
+        // not initialized, all of ram, stack and call stack read as 0
+        // from ZERO_PAGE until their page is written
+        memory = new CPU_Memory;
+        for (int i = 0; i < NUM_MEMORY_PAGES; ++i)
+                memory_pages[i] = ZERO_PAGE;
+        owned_pages = 0;
+        decoded_program = nullptr;
         program_data = nullptr;
+        verified = false;
+        limits = Run_Limits{0, 0, 0, 0};
+        usage = Run_Usage{0, 0, 0, 0};
+        enforcing_limits = false;
+        write_log = nullptr;
+        std::random_device rd;
+        prng.seed(((uint64_t)rd() << 32) | (uint64_t)rd());
 }
 
 CPU_Handle::~CPU_Handle() {
-        if (program_data)
-                delete[] program_data;
-        program_data = nullptr;
         prog_size = 0;
+        delete memory;
+        memory = nullptr;
+}
+
+CPU_Handle::CPU_Handle(CPU_Handle &&other) noexcept
+        : memory(nullptr),
+          owned_pages(0),
+          snapshot(),
+          loaded_program()
+{
+        *this = std::move(other);
+}
+
+CPU_Handle &CPU_Handle::operator=(CPU_Handle &&other) noexcept {
+        if (this == &other)
+                return *this;
+        for (int i = 0; i < NUM_REGISTERS; ++i)
+                registers[i] = other.registers[i];
+        call_stack_ptr = other.call_stack_ptr;
+        prog_size = other.prog_size;
+        decoded_program = other.decoded_program;
+        program_data = other.program_data;
+        verified = other.verified;
+        input = other.input;
+        output = std::move(other.output);
+        raw_print_output = std::move(other.raw_print_output);
+        prng = other.prng;
+        io_log = other.io_log;
+        limits = other.limits;
+        usage = other.usage;
+        enforcing_limits = other.enforcing_limits;
+        limit_start = other.limit_start;
+        write_log = other.write_log;
+        for (int i = 0; i < NUM_FUSIONS; ++i)
+                fusion_counts[i] = other.fusion_counts[i];
+        loaded_program = other.loaded_program;
+        // swap, so other frees whatever this held before. The pages move
+        // with the memory they point into
+        std::swap(memory, other.memory);
+        std::swap(memory_pages, other.memory_pages);
+        std::swap(owned_pages, other.owned_pages);
+        std::swap(snapshot, other.snapshot);
+        return *this;
 }
 
-int16_t CPU_Handle::dereference_value(const int16_t given_value) {
-        int16_t intended_address = 0;
-        int16_t intended_value   = 0;
-        int16_t addr_bits = (given_value >> 12) & 7;
-        if ((given_value >> 14) == 1 || given_value < 0) {
-                // literal value
-                // set addr bits off for non-negative numbers
-                intended_value = given_value;
-                if (intended_value >= 0)
-                        intended_value ^= (int16_t)(4 << 12);
-        } else if (addr_bits == 1) {
-                // stack offset
-                intended_address = given_value;
-                intended_address ^= (int16_t)(1 << 12);
-                if (intended_address > stack_ptr || stack_ptr <= 0) {
+int16_t CPU_Handle::dereference_value(const Decoded_Operand &operand) {
+        int16_t intended_value = 0;
+        switch (operand.kind) {
+        case OPERAND_LITERAL:
+        case OPERAND_STR_ADDR:
+        case OPERAND_LABEL:
+                intended_value = operand.value;
+                break;
+        case OPERAND_STACK_OFFSET: {
+                const int16_t stack_ptr = registers[REG_RSP];
+                if (operand.value > stack_ptr || stack_ptr <= 0) {
                         handle_runtime_error(INVALID_STACK_OFFSET);
                 }
-                intended_value = program_mem[STACK_START + stack_ptr - intended_address - 1];
-        } else if (addr_bits == 2) {
-                // ram address
-                intended_address = given_value;
-                intended_address ^= (int16_t)(2 << 12);
-                if (intended_address < 0 || intended_address >= STACK_START) {
-                        std::cout << "ram hotfix\n";
+                intended_value = read_ram(STACK_START + stack_ptr - operand.value - 1);
+                break;
+        }
+        case OPERAND_RAM_ADDR:
+                if (operand.value < 0 || operand.value >= STACK_START) {
+                        const char warning[] = "ram hotfix\n";
+                        output.put_string(warning, sizeof(warning) - 1);
                         handle_runtime_error(INVALID_STACK_OFFSET);
                 }
-                intended_value = program_mem[intended_address];
-        } else if (addr_bits == 3) {
-                // string literal
-                intended_value = given_value;
-                intended_value ^= (int16_t)(3 << 12);
-        } else {
-                // register idx
-                switch (given_value) {
-                case  0: intended_value = 0;         break; // zero reg
-                case  1: intended_value = reg_a;     break;
-                case  2: intended_value = reg_b;     break;
-                case  3: intended_value = reg_c;     break;
-                case  4: intended_value = reg_d;     break;
-                case  5: intended_value = reg_e;     break;
-                case  6: intended_value = reg_f;     break;
-                case  7: intended_value = reg_g;     break;
-                case  8: intended_value = reg_h;     break;
-                case  9: intended_value = stack_ptr; break;
-                case 10: intended_value = prog_ctr;  break;
-                case 11: intended_value = reg_cmp_a; break;
-                case 12: intended_value = reg_cmp_b; break;
-                default:
-                        handle_runtime_error(UNKNOWN_REGISTER);
-                }
+                intended_value = read_ram(operand.value);
+                break;
+        case OPERAND_REGISTER:
+                intended_value = read_register(operand.value);
+                break;
+        case OPERAND_BAD_REGISTER:
+        case OPERAND_NONE:
+                handle_runtime_error(UNKNOWN_REGISTER);
+                break;
         }
         return intended_value;
 }
@@ -118,173 +175,433 @@ int16_t CPU_Handle::get_prog_size() const {
         return prog_size;
 }
 
+int16_t CPU_Handle::get_prog_ctr() const {
+        return registers[REG_RIP];
+}
+
+const Decoded_Instruction &CPU_Handle::current_instruction() const {
+        return decoded_program[registers[REG_RIP]];
+}
+
+const Decoded_Instruction &CPU_Handle::decoded_instruction(const int16_t address) const {
+        return decoded_program[address];
+}
+
+void CPU_Handle::count_fusion(const Fusion_Enum fusion) {
+        fusion_counts[fusion]++;
+}
+
+void CPU_Handle::count_landing_pop() {
+        fusion_counts[FUSION_RET_POP]++;
+        usage.instructions++;
+}
+
+uint64_t CPU_Handle::get_fusion_count(const Fusion_Enum fusion) const {
+        return fusion_counts[fusion];
+}
+
 void CPU_Handle::load_program(const std::vector<int16_t> given_program) {
-        if (!program_data) {
-                program_data = new int16_t[given_program.size()];
-                if (!program_data) {
-                        std::cerr << "program_data alloc failed\n";
-                        std::exit(1);
+        std::shared_ptr<Loaded_Program> loading = std::make_shared<Loaded_Program>();
+        loading->program_data = given_program;
+        prog_size = (int16_t)given_program.size();
+        loading->decoded_program = decode_program(loading->program_data.data(), prog_size);
+        loading->verified = verify_program(
+                loading->program_data.data(), prog_size, loading->decoded_program);
+        specialise_program(loading->decoded_program);
+        decode_strings(loading->program_data.data(), prog_size, loading->decoded_program,
+                loading->string_bytes, loading->string_spans);
+        fuse_program(loading->decoded_program);
+
+        program_data = loading->program_data.data();
+        decoded_program = loading->decoded_program.data();
+        verified = loading->verified;
+        loaded_program = loading;
+}
+
+void CPU_Handle::set_streams(std::istream &given_in, std::ostream &given_out) {
+        input.set_stream(given_in);
+        output.set_stream(given_out);
+}
+
+bool CPU_Handle::map_input(const std::string &file_path, const Input_Format format) {
+        return input.map_file(file_path, format);
+}
+
+void CPU_Handle::set_raw_print_stream(std::ostream &given_stream) {
+        if (raw_print_output)
+                raw_print_output->flush();
+        raw_print_output = std::make_unique<Output_Sink>();
+        raw_print_output->set_stream(given_stream);
+}
+
+void CPU_Handle::seed_rand(const uint64_t seed) {
+        prng.seed(seed);
+}
+
+void CPU_Handle::set_limits(const Run_Limits &given_limits) {
+        limits = given_limits;
+        output.set_byte_limit((limits.max_output_bytes == 0) ? UINT64_MAX : limits.max_output_bytes);
+}
+
+void CPU_Handle::record_io(std::ostream &given_stream) {
+        io_log.record_to(given_stream, input.get_format());
+}
+
+bool CPU_Handle::replay_io(const std::string &file_path) {
+        return io_log.replay_from(file_path);
+}
+
+Input_Format CPU_Handle::input_format() const {
+        if (io_log.get_mode() == IO_LOG_REPLAY)
+                return io_log.get_format();
+        return input.get_format();
+}
+
+std::string_view CPU_Handle::read_input_line() {
+        if (io_log.get_mode() == IO_LOG_REPLAY) {
+                const Io_Event *event = io_log.take_event('I');
+                if (event == nullptr) {
+                        handle_runtime_error(REPLAY_ERROR);
                 }
+                return event->line;
         }
-        int16_t given_size = (int16_t)given_program.size();
-        for (int16_t i = 0; i < given_size; ++i) {
-                program_data[i] = given_program[i];
+        // so a prompt printed just before shows up
+        if (!input.is_mapped())
+                output.flush();
+        std::string_view line = input.next_line();
+        if (io_log.get_mode() == IO_LOG_RECORD)
+                io_log.put_line(line);
+        return line;
+}
+
+bool CPU_Handle::read_input_word(int16_t &word) {
+        if (io_log.get_mode() == IO_LOG_REPLAY) {
+                const Io_Event *event = io_log.take_event('W');
+                if (event == nullptr) {
+                        handle_runtime_error(REPLAY_ERROR);
+                }
+                word = event->value;
+                return event->found;
         }
-        prog_size = given_size;
+        bool found = input.next_word(word);
+        if (io_log.get_mode() == IO_LOG_RECORD)
+                io_log.put_word(found, word);
+        return found;
+}
+
+int16_t CPU_Handle::next_rand() {
+        if (io_log.get_mode() == IO_LOG_REPLAY) {
+                const Io_Event *event = io_log.take_event('R');
+                if (event == nullptr) {
+                        handle_runtime_error(REPLAY_ERROR);
+                }
+                return event->value;
+        }
+        int16_t value = prng.next_in_range(-100, 100);
+        if (io_log.get_mode() == IO_LOG_RECORD)
+                io_log.put_rand(value);
+        return value;
+}
+
+void CPU_Handle::own_page(const int page) {
+        int16_t *dest = page_start(memory, page);
+        std::memcpy(dest, memory_pages[page], MEMORY_PAGE_SIZE * sizeof(int16_t));
+        memory_pages[page] = dest;
+        owned_pages |= (uint64_t)1 << page;
+}
+
+void CPU_Handle::own_all_pages() {
+        for (int page = 0; page < NUM_MEMORY_PAGES; ++page) {
+                if (!((owned_pages >> page) & 1))
+                        own_page(page);
+        }
+        // nothing is read from older snapshots anymore
+        snapshot.reset();
+}
+
+CPU_Handle CPU_Handle::fork() {
+        // freeze the pages this handle owns, unless nothing was written
+        // since the last fork. Pages already point into memory, so only
+        // who frees it changes
+        if (owned_pages != 0) {
+                snapshot = std::make_shared<const Memory_Snapshot>(memory, snapshot);
+                memory = new CPU_Memory;
+                owned_pages = 0;
+        }
+
+        CPU_Handle child;
+        for (int i = 0; i < NUM_REGISTERS; ++i)
+                child.registers[i] = registers[i];
+        child.call_stack_ptr = call_stack_ptr;
+        child.prog_size = prog_size;
+        for (int i = 0; i < NUM_MEMORY_PAGES; ++i)
+                child.memory_pages[i] = memory_pages[i];
+        child.snapshot = snapshot;
+        child.decoded_program = decoded_program;
+        child.program_data = program_data;
+        child.verified = verified;
+        child.loaded_program = loaded_program;
+        // anything printed so far goes out before the child prints
+        output.flush();
+        child.input = input;
+        child.prng = prng;
+        child.io_log = io_log;
+        child.set_limits(limits);
+        child.usage = usage;
+        child.output.set_stream(output.get_stream());
+        if (raw_print_output) {
+                raw_print_output->flush();
+                child.set_raw_print_stream(raw_print_output->get_stream());
+        }
+        for (int i = 0; i < NUM_FUSIONS; ++i)
+                child.fusion_counts[i] = fusion_counts[i];
+        return child;
 }
 
 void CPU_Handle::next_instruction(bool &hit_exit, bool continue_cond) {
+        int16_t &prog_ctr = registers[REG_RIP];
         // if program just started
         if (prog_ctr == 0)
                 prog_ctr = get_program_data(4);
 
-        int16_t opcode = get_program_data(prog_ctr);
-        if (opcode < 0 || opcode >= (int16_t)BLUEPRINTS.size()) {
+        if (prog_ctr < 0 || prog_ctr >= prog_size) {
                 handle_runtime_error(UNKNOWN_OPCODE);
         }
-        std::string mnem_name = get_mnem_name(opcode);
 
-        // process instruction here
-        // not using switch with opcode in case more instructions are added later
-        // since mnem name is just a hashmap lookup
         // each instruction handles progressing prog_ctr, since
         // branch instructions, call, and ret don't follow usual rule
-        if (mnem_name == "NOP") {
-                ins_nop(*this);
-        } else if (mnem_name == "MOV") {
-                ins_mov(*this);
-        } else if (mnem_name == "INC") {
-                ins_inc(*this);
-        } else if (mnem_name == "DEC") {
-                ins_dec(*this);
-        } else if (mnem_name == "ADD") {
-                ins_add(*this);
-        } else if (mnem_name == "SUB") {
-                ins_sub(*this);
-        } else if (mnem_name == "MUL") {
-                ins_mul(*this);
-        } else if (mnem_name == "DIV") {
-                ins_div(*this);
-        } else if (mnem_name == "MOD") {
-                ins_mod(*this);
-        } else if (mnem_name == "AND") {
-                ins_and(*this);
-        } else if (mnem_name == "OR") {
-                ins_or(*this);
-        } else if (mnem_name == "NOT") {
-                ins_not(*this);
-        } else if (mnem_name == "XOR") {
-                ins_xor(*this);
-        } else if (mnem_name == "LSH") {
-                ins_lsh(*this);
-        } else if (mnem_name == "RSH") {
-                ins_rsh(*this);
-        } else if (mnem_name == "CMP") {
-                ins_cmp(*this);
-        } else if (mnem_name == "JMP") {
-                ins_jmp(*this);
-        } else if (mnem_name == "JEQ") {
-                ins_jeq(*this);
-        } else if (mnem_name == "JNE") {
-                ins_jne(*this);
-        } else if (mnem_name == "JGE") {
-                ins_jge(*this);
-        } else if (mnem_name == "JGR") {
-                ins_jgr(*this);
-        } else if (mnem_name == "JLE") {
-                ins_jle(*this);
-        } else if (mnem_name == "JLS") {
-                ins_jls(*this);
-        } else if (mnem_name == "CALL") {
-                ins_call(*this);
-        } else if (mnem_name == "RET") {
-                ins_ret(*this);
-        } else if (mnem_name == "PUSH") {
-                ins_push(*this);
-        } else if (mnem_name == "POP") {
-                ins_pop(*this);
-        } else if (mnem_name == "WRITE") {
-                ins_write(*this);
-        } else if (mnem_name == "READ") {
-                ins_read(*this);
-        } else if (mnem_name == "PRINT") {
-                ins_print(*this);
-                if (!continue_cond)
-                        std::cout << "\n";
-        } else if (mnem_name == "SPRINT") {
-                ins_sprint(*this);
-                if (!continue_cond)
-                        std::cout << "\n";
-        } else if (mnem_name == "CPRINT") {
-                ins_cprint(*this);
+        const Decoded_Instruction &ins = decoded_program[prog_ctr];
+        ins.base_handler(*this, ins);
+
+        switch (ins.opcode) {
+        case OP_PRINT:
+        case OP_SPRINT:
+        case OP_CPRINT:
                 if (!continue_cond)
-                        std::cout << "\n";
-        } else if (mnem_name == "INPUT") {
-                ins_input(*this);
-        } else if (mnem_name == "SINPUT") {
-                ins_sinput(*this);
-        } else if (mnem_name == "RAND") {
-                ins_rand(*this);
-        } else if (mnem_name == "EXIT") {
-                ins_exit(*this);
+                        output.put_char('\n');
+                break;
+        case OP_EXIT:
                 hit_exit = true;
+                break;
+        default:
+                break;
         }
+        // the debugger's prompt comes after the program's output
+        output.flush();
 }
 
-void CPU_Handle::run_program() {
-        bool hit_exit = false;
-        prog_ctr = get_program_data(4);
+Run_Result CPU_Handle::get_run_result(const Runtime_Error_Enum error_code) {
+        output.flush();
+        if (raw_print_output)
+                raw_print_output->flush();
+        Run_Result result;
+        result.faulted = error_code != NO_RUNTIME_ERROR;
+        result.paused = false;
+        result.error_code = error_code;
+        result.limit_hit = LIMIT_NONE;
+        result.prog_ctr = registers[REG_RIP];
+        for (int i = 0; i < NUM_REGISTERS; ++i)
+                result.registers[i] = registers[i];
+        result.usage = usage;
+        result.usage.output_bytes = output.bytes_written();
+        return result;
+}
 
-        while (!hit_exit) {
-                next_instruction(hit_exit, true);
+Run_Result CPU_Handle::run_program() {
+        if (has_limits())
+                return run_program_limited();
+        try {
+                if (verified)
+                        run_decoded<false, false>();
+                else
+                        run_decoded<true, false>();
+        } catch (const Runtime_Fault &fault) {
+                return get_run_result(fault.error_code);
+        }
+        return get_run_result(NO_RUNTIME_ERROR);
+}
+
+Run_Result CPU_Handle::run_program_limited() {
+        // so elapsed_millis carries on from earlier runs
+        limit_start = std::chrono::steady_clock::now() - std::chrono::milliseconds(usage.millis);
+        enforcing_limits = true;
+        Runtime_Error_Enum error_code = NO_RUNTIME_ERROR;
+        Limit_Enum limit_hit = LIMIT_NONE;
+        try {
+                if (verified)
+                        run_decoded<false, true>();
+                else
+                        run_decoded<true, true>();
+        } catch (const Runtime_Fault &fault) {
+                error_code = fault.error_code;
+        } catch (const Limit_Stop &stop) {
+                limit_hit = stop.limit;
+        }
+        enforcing_limits = false;
+        usage.millis = elapsed_millis();
+        Run_Result result = get_run_result(error_code);
+        result.limit_hit = limit_hit;
+        return result;
+}
+
+bool CPU_Handle::has_limits() const {
+        return limits.max_instructions != 0 || limits.max_millis != 0
+                || limits.max_output_bytes != 0 || limits.max_input_reads != 0;
+}
+
+uint64_t CPU_Handle::check_limits() {
+        if (limits.max_instructions != 0 && usage.instructions >= limits.max_instructions)
+                throw Limit_Stop{LIMIT_INSTRUCTIONS};
+        if (limits.max_millis != 0 && elapsed_millis() >= limits.max_millis)
+                throw Limit_Stop{LIMIT_TIME};
+        if (limits.max_output_bytes != 0 && output.bytes_written() > limits.max_output_bytes)
+                throw Limit_Stop{LIMIT_OUTPUT};
+        uint64_t next_check = usage.instructions + LIMIT_CHECK_INTERVAL;
+        if (limits.max_instructions != 0 && next_check > limits.max_instructions)
+                next_check = limits.max_instructions;
+        return next_check;
+}
+
+uint64_t CPU_Handle::elapsed_millis() const {
+        std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - limit_start;
+        return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+}
+
+void CPU_Handle::count_input() {
+        if (enforcing_limits && limits.max_input_reads != 0
+                && usage.input_reads >= limits.max_input_reads)
+                throw Limit_Stop{LIMIT_INPUT};
+        usage.input_reads++;
+}
+
+template <bool CHECKED, bool LIMITED>
+void CPU_Handle::run_decoded() {
+        int16_t &prog_ctr = registers[REG_RIP];
+        // 0 is never an instruction, so the program hasn't started yet
+        if (prog_ctr == 0)
+                prog_ctr = get_program_data(4);
+
+        // same as calling next_instruction in a loop, but through the
+        // fused handlers picked by fuse_program
+        uint64_t next_check = 0;
+        while (true) {
+                if (CHECKED && (prog_ctr < 0 || prog_ctr >= prog_size)) {
+                        handle_runtime_error(UNKNOWN_OPCODE);
+                }
+                const Decoded_Instruction &ins = decoded_program[prog_ctr];
+                ins.handler(*this, ins);
+                if constexpr (LIMITED) {
+                        usage.instructions += FUSION_LENGTHS[ins.fusion];
+                        if (prog_ctr != ins.next_pc && usage.instructions >= next_check)
+                                next_check = check_limits();
+                }
+                if (ins.opcode == OP_EXIT)
+                        break;
+        }
+}
+
+Run_Result CPU_Handle::run_until_input() {
+        return run_stepping(UINT64_MAX, true);
+}
+
+Run_Result CPU_Handle::run_for(const uint64_t num_instructions) {
+        return run_stepping(num_instructions, false);
+}
+
+Run_Result CPU_Handle::run_stepping(uint64_t steps_left, const bool stop_at_input) {
+        int16_t &prog_ctr = registers[REG_RIP];
+        try {
+                // an INPUT it already paused at is let through
+                bool first = prog_ctr != 0;
+                if (prog_ctr == 0)
+                        prog_ctr = get_program_data(4);
+                while (true) {
+                        if (prog_ctr < 0 || prog_ctr >= prog_size) {
+                                handle_runtime_error(UNKNOWN_OPCODE);
+                        }
+                        const Decoded_Instruction &ins = decoded_program[prog_ctr];
+                        bool is_input = ins.opcode == OP_INPUT || ins.opcode == OP_SINPUT;
+                        if (steps_left == 0 || (stop_at_input && !first && is_input)) {
+                                Run_Result result = get_run_result(NO_RUNTIME_ERROR);
+                                result.paused = true;
+                                return result;
+                        }
+                        first = false;
+                        // one instruction at a time, so not the fused handler
+                        ins.base_handler(*this, ins);
+                        steps_left--;
+                        if (ins.opcode == OP_EXIT)
+                                break;
+                }
+        } catch (const Runtime_Fault &fault) {
+                return get_run_result(fault.error_code);
         }
+        return get_run_result(NO_RUNTIME_ERROR);
 }
 
-void CPU_Handle::run_program_debug() {
+Run_Result CPU_Handle::run_program_debug(const std::map<int16_t, std::string> &symbols) {
+        try {
+                run_debugger(nullptr, nullptr, symbols);
+        } catch (const Runtime_Fault &fault) {
+                return get_run_result(fault.error_code);
+        }
+        return get_run_result(NO_RUNTIME_ERROR);
+}
+
+void CPU_Handle::run_debugger(std::istream *script, Debug_Report *report, const std::map<int16_t, std::string> &symbols) {
+        int16_t &prog_ctr = registers[REG_RIP];
         int16_t num_instructions_left = 0;
         bool hit_exit = false;
         bool continue_cond = false; // to ensure running after continue cmd
         bool jump_breakpoint = false; // for running after hitting breakpoint
-        std::vector<int16_t> breakpoints = {};
-        std::vector<int16_t> mnemonic_addrs = {}; // to verify breakpoints are valid
-
-        // to ensure all breakpoints are valid addresses
-        int16_t temp_idx = 5; // SA, NT, IA, GO, main
-        while ((get_program_data(temp_idx - 1) != (int16_t)0xffff) && (temp_idx < prog_size))
-                temp_idx++;
-        while (temp_idx < prog_size) {
-                mnemonic_addrs.push_back(temp_idx);
-                int16_t opcode = get_program_data(temp_idx);
-                temp_idx += (int16_t)BLUEPRINTS.at(get_mnem_name(opcode)).length;
-        }
+        Debug_Breakpoints breakpoints; // and watchpoints
+        Debug_History history; // for reverse-next and reverse-continue
+        bool recording = false; // whether continue is logged in history too
 
-        std::cout << "PAL Debugger (PalDB)\n";
-        std::cout << "For help, type \"help\"\n\n";
+        // once for the session, and breakpoints go where instructions start
+        const Disassembly disassembly(*this, symbols);
+        breakpoints.set_program(prog_size, disassembly.get_addresses());
 
-        prog_ctr = get_program_data(4);
+        if (prog_ctr == 0)
+                prog_ctr = get_program_data(4);
 
+        // a script needs no terminal, and nobody to greet
+        bool is_piped_input = false;
+        size_t script_line_num = 0;
+        std::ifstream terminal;
+        if (script == nullptr) {
+                std::cout << "PAL Debugger (PalDB)\n";
+                std::cout << "For help, type \"help\"\n\n";
 #ifdef _WIN32
-        bool is_piped_input = !_isatty(_fileno(stdin));
-        std::ifstream terminal("CONIN$");
+                is_piped_input = !_isatty(_fileno(stdin));
+                terminal.open("CONIN$");
 #else
-        bool is_piped_input = !isatty(STDIN_FILENO);
-        std::ifstream terminal("/dev/tty");
+                is_piped_input = !isatty(STDIN_FILENO);
+                terminal.open("/dev/tty");
 #endif
-        if (terminal.fail()) {
-                std::cerr << "Failed to open terminal device\n";
-                std::exit(1);
+                if (terminal.fail()) {
+                        std::cerr << "Failed to open terminal device\n";
+                        std::exit(1);
+                }
         }
 
-
         // pause when no more instructions
         while (!hit_exit) {
-                std::cout << "(PalDB) > ";
-                std::cout.flush();
                 std::string command = "";
-                if (is_piped_input) {
-                        std::getline(terminal, command);
+                if (script != nullptr) {
+                        if (!std::getline(*script, command)) {
+                                report->put_end(*this, "script_end", NO_RUNTIME_ERROR);
+                                return;
+                        }
+                        report->start_command(++script_line_num, command);
                 } else {
-                        std::getline(std::cin, command);
+                        std::cout << "(PalDB) > ";
+                        std::cout.flush();
+                        if (is_piped_input) {
+                                std::getline(terminal, command);
+                        } else {
+                                std::getline(std::cin, command);
+                        }
                 }
 
                 // tokenize command
@@ -294,22 +611,29 @@ void CPU_Handle::run_program_debug() {
                 while (aux_stream >> aux_string) {
                         cmd_tokens.push_back(aux_string);
                 }
-                // ignore, if no commands
-                if (cmd_tokens.size() == 0)
+                // ignore, if no commands, or a comment in a script
+                if (cmd_tokens.size() == 0 || (script != nullptr && cmd_tokens.front()[0] == '#'))
                         continue;
 
                 // begin parsing
                 if (cmd_tokens.front()[0] == 'b') {
-                        pdb_handle_break(cmd_tokens, breakpoints, mnemonic_addrs);
+                        if (!pdb_handle_break(cmd_tokens, breakpoints) && report != nullptr)
+                                report->put_error("expected an instruction address, and maybe a condition like: if RA > 50");
+                        continue;
+                } else if (cmd_tokens.front() == "checkpoint") {
+                        if (!pdb_handle_checkpoint(cmd_tokens, *this) && report != nullptr)
+                                report->put_error("expected a file the checkpoint could be written to");
                         continue;
                 } else if (cmd_tokens.front() == "clear") {
-                        system("clear");
+                        if (script == nullptr)
+                                system("clear");
                         continue;
                 } else if (cmd_tokens.front() == "continue") {
                         continue_cond = true;
                 } else if (cmd_tokens.front() == "delete") {
                         // delete
-                        pdb_handle_delete(cmd_tokens, breakpoints);
+                        if (!pdb_handle_delete(cmd_tokens, breakpoints) && report != nullptr)
+                                report->put_error("expected the address of a breakpoint");
                         continue;
                 } else if (cmd_tokens.front()[0] == 'h') {
                         // help
@@ -317,26 +641,25 @@ void CPU_Handle::run_program_debug() {
                         continue;
                 } else if (cmd_tokens.front() == "disassemble") {
                         // interpret
-                        pdb_handle_disassemble(*this);
+                        if (!pdb_handle_disassemble(cmd_tokens, *this, disassembly) && report != nullptr)
+                                report->put_error("expected program addresses, as in disassemble 200 260");
                         continue;
                 } else if (cmd_tokens.front()[0] == 'l') {
                         // next instruction to run
-                        int16_t opcode = get_program_data(prog_ctr);
-                        int16_t ins_len = (int16_t)BLUEPRINTS.at(get_mnem_name(opcode)).length;
-                        std::vector<int16_t> instruction = {};
-                        for (int16_t i = 0; i < ins_len; ++i) {
-                                int16_t curr_element = get_program_data(prog_ctr + i);
-                                instruction.push_back(curr_element);
-                        }
-                        disassemble_print_instruction(instruction, prog_ctr);
+                        std::cout << disassembly.get_line(prog_ctr) << "\n";
                         continue;
                 } else if (cmd_tokens.front()[0] == 'n') {
                         // next
                         if (cmd_tokens.size() == 2) {
                                 // allow 1+ steps
-                                int16_t num_steps = (int16_t)std::stoi(cmd_tokens.at(1));
-                                num_steps = (num_steps >= 1) ? num_steps : 1;
-                                num_instructions_left = num_steps;
+                                int num_steps = 1;
+                                if (!parse_debug_number(cmd_tokens.at(1), num_steps)) {
+                                        std::cout << "expected a count, as in next 3\n";
+                                        if (report != nullptr)
+                                                report->put_error("expected a count, as in next 3");
+                                        continue;
+                                }
+                                num_instructions_left = (int16_t)((num_steps >= 1) ? num_steps : 1);
                         } else {
                                 num_instructions_left = 1;
                         }
@@ -345,38 +668,93 @@ void CPU_Handle::run_program_debug() {
                 } else if (cmd_tokens.front()[0] == 'p') {
                         // print
                         pdb_handle_print(cmd_tokens, *this);
+                        if (report != nullptr && cmd_tokens.size() == 2)
+                                report->put_value(*this, cmd_tokens.at(1));
+                        else if (report != nullptr)
+                                report->put_error("no arguments provided");
                         continue;
                 } else if (cmd_tokens.front()[0] == 'q') {
                         // quit
+                        if (report != nullptr)
+                                report->put_end(*this, "quit", NO_RUNTIME_ERROR);
                         return;
+                } else if (cmd_tokens.front() == "reverse-next"
+                        || cmd_tokens.front() == "reverse-continue") {
+                        if (!pdb_handle_reverse(cmd_tokens, *this, history, breakpoints, disassembly)) {
+                                if (report != nullptr)
+                                        report->put_error("expected a count, and an earlier instruction to go back to");
+                                continue;
+                        }
+                        // don't stop again where it stopped going backwards
+                        jump_breakpoint = true;
+                        if (report != nullptr)
+                                report->put_stop(*this, "reverse", -1);
+                        continue;
+                } else if (cmd_tokens.front() == "record") {
+                        recording = cmd_tokens.size() == 1 || cmd_tokens.at(1) != "stop";
+                        if (!recording)
+                                history = Debug_History();
+                        std::cout << (recording ? "recording continue\n" : "history forgotten\n");
+                        continue;
+                } else if (cmd_tokens.front() == "watch" || cmd_tokens.front() == "unwatch") {
+                        if (!pdb_handle_watch(cmd_tokens, *this, breakpoints) && report != nullptr)
+                                report->put_error(cmd_tokens.front() == "watch"
+                                        ? "expected a ram address like [$5], or a stack offset like %0"
+                                        : "expected a watched ram address, or a stack offset pointing at one");
+                        continue;
                 } else {
                         std::cout << "unrecognized command\n";
+                        if (report != nullptr)
+                                report->put_error("unrecognized command");
                         continue;
                 }
 
                 bool previously_ran = false;
+                int16_t watch_hit = -1; // address of the watchpoint that stopped it
+                const char *stop_reason = "step"; // for the report
                 while (num_instructions_left > 0 || continue_cond) {
                         // run instructions
 
                         // handle breakpoints
                         if (jump_breakpoint) {
                                 jump_breakpoint = false;
-                        } else {
-                                for (int16_t address : breakpoints) {
-                                        if (prog_ctr == address) {
-                                                continue_cond = false;
-                                                num_instructions_left = 0;
-                                                jump_breakpoint = true;
-                                                break;
-                                        }
-                                }
+                        } else if (breakpoints.should_break(*this, prog_ctr)) {
+                                continue_cond = false;
+                                num_instructions_left = 0;
+                                jump_breakpoint = true;
+                                stop_reason = "breakpoint";
                         }
 
                         // instead of goto
                         if (!continue_cond && num_instructions_left == 0)
                                 break;
 
-                        next_instruction(hit_exit, continue_cond);
+                        // full speed, unless it has to be logged. Nothing
+                        // before it can be undone once it's run unlogged
+                        if (continue_cond && !recording && !history.can_redo()) {
+                                history = Debug_History();
+                                Debug_Stop_Enum stop = run_to_breakpoint(breakpoints, true);
+                                hit_exit = stop == DEBUG_STOP_EXIT;
+                                jump_breakpoint = stop == DEBUG_STOP_BREAKPOINT;
+                                if (jump_breakpoint)
+                                        stop_reason = "breakpoint";
+                                if (stop == DEBUG_STOP_WATCHPOINT)
+                                        watch_hit = breakpoints.get_watch_hit();
+                                continue_cond = false;
+                                previously_ran = true;
+                                break;
+                        }
+
+                        // undone steps are redone, not run again
+                        if (history.can_redo())
+                                history.redo(*this);
+                        else
+                                history.run_step(*this, hit_exit, continue_cond);
+                        if (breakpoints.has_watches() && breakpoints.find_watched(history.get_memory_writes())) {
+                                watch_hit = breakpoints.get_watch_hit();
+                                continue_cond = false;
+                                num_instructions_left = 0;
+                        }
                         previously_ran = true;
                         // don't track num_instructions_left after continue cmd
                         if (!continue_cond)
@@ -384,26 +762,41 @@ void CPU_Handle::run_program_debug() {
                         if (hit_exit)
                                 break;
                 }
+                if (watch_hit != -1) {
+                        std::cout << "watchpoint [$" << watch_hit << "] = ";
+                        std::cout << read_ram(watch_hit) << "\n";
+                        stop_reason = "watchpoint";
+                }
+                if (report != nullptr && !hit_exit && previously_ran)
+                        report->put_stop(*this, stop_reason, watch_hit);
                 // prevent extraneous print when starting debugger
                 if (!hit_exit && previously_ran) {
                         // print next instruction to run
-                        int16_t opcode = get_program_data(prog_ctr);
-                        int16_t ins_len = (int16_t)BLUEPRINTS.at(get_mnem_name(opcode)).length;
-                        std::vector<int16_t> instruction = {};
-                        for (int16_t i = 0; i < ins_len; ++i) {
-                                int16_t curr_element = get_program_data(prog_ctr + i);
-                                instruction.push_back(curr_element);
-                        }
-                        disassemble_print_instruction(instruction, prog_ctr);
+                        std::cout << disassembly.get_line(prog_ctr) << "\n";
                         previously_ran = false;
                 }
         }
+        if (report != nullptr)
+                report->put_end(*this, "exit", NO_RUNTIME_ERROR);
         terminal.close();
 }
 
 
 void handle_runtime_error(Runtime_Error_Enum error_code) {
+        throw Runtime_Fault{error_code};
+}
+
+void print_runtime_error(const Run_Result &result) {
         std::cerr << "\x1b[34mRuntime Error:\x1b[0m ";
-        std::cerr << RUNTIME_ERROR_MESSAGES[error_code] << "\n";
-        std::exit(1);
+        std::cerr << RUNTIME_ERROR_MESSAGES[result.error_code] << "\n";
+}
+
+void print_limit_report(const Run_Result &result) {
+        std::cerr << "\x1b[34mLimit Reached:\x1b[0m ";
+        std::cerr << LIMIT_MESSAGES[result.limit_hit] << "\n";
+        std::cerr << "  stopped at address " << result.prog_ctr << " after ";
+        std::cerr << result.usage.instructions << " instructions, ";
+        std::cerr << result.usage.millis << " ms, ";
+        std::cerr << result.usage.output_bytes << " bytes of output and ";
+        std::cerr << result.usage.input_reads << " reads of input\n";
 }
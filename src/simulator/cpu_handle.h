@@ -1,12 +1,26 @@
 #ifndef CPU_HANDLE_H
 #define CPU_HANDLE_H 1
 
+#include <chrono>
 #include <cstdint>
+#include <iostream>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "../common_values.h"
+#include "decoder.h"
+#include "input_source.h"
+#include "io_log.h"
+#include "output_sink.h"
+#include "prng.h"
+
+struct Profile;
+class Trace_Writer;
+class Debug_Breakpoints;
+class Debug_Report;
+enum Debug_Stop_Enum : uint8_t;
 
 enum Runtime_Error_Enum {
         STACK_OVERFLOW = 0,
@@ -21,9 +35,11 @@ enum Runtime_Error_Enum {
         ASCII_ERROR,
         INPUT_ERROR,
         UNKNOWN_OPCODE,
+        REPLAY_ERROR,
+        NO_RUNTIME_ERROR, ///< the program reached EXIT, has no message
 };
 
-const std::string RUNTIME_ERROR_MESSAGES[12] = {
+const std::string RUNTIME_ERROR_MESSAGES[13] = {
         "stack overflow",
         "stack underflow",
         "attempted to write a bad stack ptr value",
@@ -36,6 +52,88 @@ const std::string RUNTIME_ERROR_MESSAGES[12] = {
         "attempted to print invalid ascii character",
         "attempted to input invalid int16_t",
         "invalid opcode (suspicious address)",
+        "replayed input doesn't match what the program reads",
+};
+
+/**
+ * @brief thrown by handle_runtime_error
+ * @details caught by the run_program* methods, which turn it into a
+ * Run_Result, so a fault never ends the process
+ */
+struct Runtime_Fault {
+        Runtime_Error_Enum error_code;
+};
+
+/**
+ * @brief which limit of Run_Limits ended a run, if any
+ */
+enum Limit_Enum {
+        LIMIT_NONE = 0,
+        LIMIT_INSTRUCTIONS, ///< ran max_instructions instructions
+        LIMIT_TIME,         ///< ran for max_millis milliseconds
+        LIMIT_OUTPUT,       ///< printed more than max_output_bytes bytes
+        LIMIT_INPUT,        ///< read input more than max_input_reads times
+};
+
+const std::string LIMIT_MESSAGES[5] = {
+        "",
+        "instruction limit",
+        "time limit",
+        "output limit",
+        "input limit",
+};
+
+/**
+ * @brief quotas for running untrusted programs, see CPU_Handle::set_limits
+ * @details 0 means no limit
+ */
+struct Run_Limits {
+        uint64_t max_instructions;
+        uint64_t max_millis;
+        uint64_t max_output_bytes;
+        uint64_t max_input_reads; ///< INPUTs and SINPUTs
+};
+
+/**
+ * @brief instructions between checks of the time and output limits
+ */
+const uint64_t LIMIT_CHECK_INTERVAL = 1 << 16;
+
+/**
+ * @brief how far the program got, measured against Run_Limits
+ * @details adds up over every run of a CPU_Handle. instructions and
+ * millis are only counted while limits are set
+ */
+struct Run_Usage {
+        uint64_t instructions;
+        uint64_t millis;
+        uint64_t output_bytes;
+        uint64_t input_reads;
+};
+
+/**
+ * @brief thrown when a limit of Run_Limits is reached
+ * @details caught by run_program, the same way as Runtime_Fault
+ */
+struct Limit_Stop {
+        Limit_Enum limit;
+};
+
+/**
+ * @brief how a run of the program ended
+ * @details returned by the run_program* methods. prog_ctr is the address of
+ * the instruction that faulted, or the one after the EXIT that ended the
+ * program, or the INPUT the run paused at. registers is the register
+ * state at that point, indexed by Register_Enum
+ */
+struct Run_Result {
+        bool faulted;
+        bool paused; ///< stopped early, see run_until_input and run_for
+        Runtime_Error_Enum error_code; ///< NO_RUNTIME_ERROR if not faulted
+        Limit_Enum limit_hit; ///< LIMIT_NONE unless a limit ended the run
+        int16_t prog_ctr;
+        int16_t registers[NUM_REGISTERS];
+        Run_Usage usage;
 };
 
 /**
@@ -49,85 +147,232 @@ enum Program_State_Enum {
         READING_MNEMONIC,
 };
 
+/**
+ * @brief which memory of a CPU_Handle a Memory_Write went to
+ */
+enum Memory_Space : uint8_t {
+        SPACE_RAM = 0,    ///< ram and stack, address is into program_mem
+        SPACE_CALL_STACK, ///< address is into call_stack
+};
+
+/**
+ * @brief one word written by write_ram or write_call_stack
+ * @details logged while CPU_Handle::write_log is set
+ */
+struct Memory_Write {
+        Memory_Space space;
+        int16_t address;
+        int16_t old_value; ///< the word before the write
+        int16_t value;     ///< the word written
+};
+
+/**
+ * @brief memory of a CPU_Handle that's too big to keep next to its registers
+ * @details allocated on its own, so a CPU_Handle stays small to construct
+ * and move. Each array starts on a cache line
+ */
+struct CPU_Memory {
+        alignas(64) int16_t program_mem[RAM_SIZE]; /** holds ram and stack memory */
+        alignas(64) int16_t call_stack[CALL_STACK_SIZE]; /** holds returns for call stack */
+};
+
+/**
+ * @brief log2 of the words in one copy-on-write page of CPU_Memory
+ */
+const int MEMORY_PAGE_SHIFT = 8;
+const int MEMORY_PAGE_SIZE = 1 << MEMORY_PAGE_SHIFT;
+const int NUM_RAM_PAGES = RAM_SIZE / MEMORY_PAGE_SIZE;
+/** ram pages, then call stack pages. Has to fit in CPU_Handle::owned_pages */
+const int NUM_MEMORY_PAGES = NUM_RAM_PAGES + CALL_STACK_SIZE / MEMORY_PAGE_SIZE;
+
+/**
+ * @brief memory of a CPU_Handle frozen by CPU_Handle::fork
+ * @details only the pages the handle owned when it forked are read out of
+ * memory, the rest are still read from older snapshots, which parent keeps
+ * alive. Never written again, so forks on different threads can share it
+ */
+struct Memory_Snapshot {
+        CPU_Memory *memory;
+        std::shared_ptr<const Memory_Snapshot> parent;
+        Memory_Snapshot(CPU_Memory *given_memory, std::shared_ptr<const Memory_Snapshot> given_parent);
+        ~Memory_Snapshot();
+        Memory_Snapshot(const Memory_Snapshot &other) = delete;
+        Memory_Snapshot &operator=(const Memory_Snapshot &other) = delete;
+};
+
+/**
+ * @brief what load_program makes of a program
+ * @details never changes once loaded, so every fork of a CPU_Handle
+ * shares one
+ */
+struct Loaded_Program {
+        std::vector<int16_t> program_data; /** assembled program */
+        std::vector<Decoded_Instruction> decoded_program; /** one per address */
+        bool verified; /** whether verify_program passed, see run_program */
+        std::string string_bytes; /** every decoded SPRINT string, back to back */
+        std::vector<String_Span> string_spans; /** by string address, see decode_strings */
+};
+
 /**
  * @brief Container class for memory during program simulation
+ * @details the members every instruction touches come first, and share
+ * one cache line
  */
 class CPU_Handle {
-        // general purpose registers
-        int16_t reg_a; /** general purpose register */
-        int16_t reg_b; /** general purpose register */
-        int16_t reg_c; /** general purpose register */
-        int16_t reg_d; /** general purpose register */
-        int16_t reg_e; /** general purpose register */
-        int16_t reg_f; /** general purpose register */
-        int16_t reg_g; /** general purpose register */
-        int16_t reg_h; /** general purpose register */
-        int16_t reg_cmp_a; /** comparison register, inaccessable */
-        int16_t reg_cmp_b; /** comparison register, inaccessable */
-        int16_t prog_ctr; /** program counter / instruction pointer */
-        int16_t stack_ptr; /** stack counter / pointer */
+        /** RZ through CMP1, indexed by Register_Enum. RIP is the program
+         * counter, RSP the stack pointer, and RZ is never written */
+        alignas(64) int16_t registers[NUM_REGISTERS];
         int16_t call_stack_ptr;
-        int16_t call_stack[CALL_STACK_SIZE]; /** holds returns for call stack */
-        int16_t program_mem[RAM_SIZE]; /** holds ram and stack memory */
-        int16_t *program_data; /** assembled program */
         int16_t prog_size; /** size of program data */
+        CPU_Memory *memory; /** pages of ram, stack and call stack this handle owns */
+        const int16_t *memory_pages[NUM_MEMORY_PAGES]; /** where each page is read from */
+        uint64_t owned_pages; /** bit per page, set once it's copied into memory */
+        std::shared_ptr<const Memory_Snapshot> snapshot; /** holds the pages not owned */
+        const Decoded_Instruction *decoded_program; /** of loaded_program */
+        const int16_t *program_data; /** of loaded_program */
+        bool verified; /** of loaded_program */
+        std::shared_ptr<const Loaded_Program> loaded_program;
+        Input_Source input; /** read by INPUT and SINPUT */
+        Output_Sink output; /** buffers what the print instructions and warnings write */
+        std::unique_ptr<Output_Sink> raw_print_output; /** null unless set_raw_print_stream */
+        Prng prng; /** draws RAND results */
+        Io_Log io_log; /** RAND results and input, if recording or replaying */
+        Run_Limits limits; /** all 0 unless set_limits */
+        Run_Usage usage; /** counted against limits */
+        bool enforcing_limits; /** only while run_program_limited runs */
+        std::chrono::steady_clock::time_point limit_start; /** when the running program started, see elapsed_millis */
+        uint64_t fusion_counts[NUM_FUSIONS]; /** times each fused sequence ran */
+        std::vector<Memory_Write> *write_log; /** null unless a run logs every memory write */
+
+        template <bool CHECKED, bool LIMITED>
+        void run_decoded();
+        template <bool CHECKED>
+        void run_threaded();
+        void run_jit();
+        void run_debugger(std::istream *script, Debug_Report *report, const std::map<int16_t, std::string> &symbols);
+        Debug_Stop_Enum run_to_breakpoint(Debug_Breakpoints &breakpoints, const bool skip_first);
+        Run_Result get_run_result(const Runtime_Error_Enum error_code);
+        Run_Result run_stepping(uint64_t steps_left, const bool stop_at_input);
+        Run_Result run_program_limited();
+        bool has_limits() const;
+        uint64_t check_limits();
+        uint64_t elapsed_millis() const;
+        void count_input();
+        void own_page(const int page);
+        void own_all_pages();
+        Input_Format input_format() const;
+        std::string_view read_input_line();
+        bool read_input_word(int16_t &word);
+        int16_t next_rand();
 public:
         CPU_Handle();
         ~CPU_Handle();
-        int16_t dereference_value(const int16_t given_value);
+        CPU_Handle(CPU_Handle &&other) noexcept;
+        CPU_Handle &operator=(CPU_Handle &&other) noexcept;
+        CPU_Handle(const CPU_Handle &other) = delete;
+        CPU_Handle &operator=(const CPU_Handle &other) = delete;
+        int16_t dereference_value(const Decoded_Operand &operand);
+        template <Operand_Kind KIND>
+        int16_t load_operand(const Decoded_Operand &operand);
+        int16_t read_register(const int16_t idx) const;
+        int16_t read_ram(const int16_t address) const;
+        void write_ram(const int16_t address, const int16_t value);
+        int16_t read_call_stack(const int16_t idx) const;
+        void write_call_stack(const int16_t idx, const int16_t value);
         int16_t get_program_data(const int16_t idx) const;
         int16_t get_prog_size() const;
+        int16_t get_prog_ctr() const;
+        const Decoded_Instruction &current_instruction() const;
+        const Decoded_Instruction &decoded_instruction(const int16_t address) const;
+        void count_fusion(const Fusion_Enum fusion);
+        void count_landing_pop();
+        uint64_t get_fusion_count(const Fusion_Enum fusion) const;
         void load_program(const std::vector<int16_t> given_program);
+        void set_streams(std::istream &given_in, std::ostream &given_out);
+        bool map_input(const std::string &file_path, const Input_Format format);
+        void set_raw_print_stream(std::ostream &given_stream);
+        void seed_rand(const uint64_t seed);
+        void set_limits(const Run_Limits &given_limits);
+        void record_io(std::ostream &given_stream);
+        bool replay_io(const std::string &file_path);
+        CPU_Handle fork();
         void next_instruction(bool &hit_exit, bool continue_cond);
-        void run_program();
-        void run_program_debug();
+        Run_Result run_program();
+        Run_Result run_program_threaded();
+        Run_Result run_program_jit();
+        Run_Result run_program_debug(const std::map<int16_t, std::string> &symbols);
+        Run_Result run_program_debug_script(
+                std::istream &script,
+                Debug_Report &report,
+                const std::map<int16_t, std::string> &symbols
+        );
+        Run_Result run_program_profiled(Profile &profile);
+        Run_Result run_program_traced(Trace_Writer &trace);
+        Run_Result run_until_input();
+        Run_Result run_for(const uint64_t num_instructions);
+        bool save_checkpoint(const std::string &file_path) const;
+        bool load_checkpoint(const std::string &file_path);
 
         // needs access to private members, but won't be member method for reasons
-        friend void ins_nop(CPU_Handle &cpu_handle);
-        friend void ins_mov(CPU_Handle &cpu_handle);
-        friend void ins_inc(CPU_Handle &cpu_handle);
-        friend void ins_dec(CPU_Handle &cpu_handle);
-        friend void ins_add(CPU_Handle &cpu_handle);
-        friend void ins_sub(CPU_Handle &cpu_handle);
-        friend void ins_mul(CPU_Handle &cpu_handle);
-        friend void ins_div(CPU_Handle &cpu_handle);
-        friend void ins_mod(CPU_Handle &cpu_handle);
-        friend void ins_and(CPU_Handle &cpu_handle);
-        friend void ins_or(CPU_Handle &cpu_handle);
-        friend void ins_not(CPU_Handle &cpu_handle);
-        friend void ins_xor(CPU_Handle &cpu_handle);
-        friend void ins_lsh(CPU_Handle &cpu_handle);
-        friend void ins_rsh(CPU_Handle &cpu_handle);
-        friend void ins_cmp(CPU_Handle &cpu_handle);
-        friend void ins_jmp(CPU_Handle &cpu_handle);
-        friend void ins_jeq(CPU_Handle &cpu_handle);
-        friend void ins_jne(CPU_Handle &cpu_handle);
-        friend void ins_jge(CPU_Handle &cpu_handle);
-        friend void ins_jgr(CPU_Handle &cpu_handle);
-        friend void ins_jle(CPU_Handle &cpu_handle);
-        friend void ins_jls(CPU_Handle &cpu_handle);
-        friend void ins_call(CPU_Handle &cpu_handle);
-        friend void ins_ret(CPU_Handle &cpu_handle);
-        friend void ins_push(CPU_Handle &cpu_handle);
-        friend void ins_pop(CPU_Handle &cpu_handle);
-        friend void ins_write(CPU_Handle &cpu_handle);
-        friend void ins_read(CPU_Handle &cpu_handle);
-        friend void ins_print(CPU_Handle &cpu_handle);
-        friend void ins_sprint(CPU_Handle &cpu_handle);
-        friend void ins_cprint(CPU_Handle &cpu_handle);
-        friend void ins_input(CPU_Handle &cpu_handle);
-        friend void ins_sinput(CPU_Handle &cpu_handle);
-        friend void ins_rand(CPU_Handle   &cpu_handle);
-        friend void ins_exit(CPU_Handle &cpu_handle);
-        friend void pdb_handle_break(
-                const std::vector<std::string> cmd_tokens,
-                std::vector<int16_t> &breakpoints,
-                const std::vector<int16_t> mnemonic_addrs
-        );
-        friend void pdb_handle_delete(
-                const std::vector<std::string> cmd_tokens,
-                std::vector<int16_t> &breakpoints
-        );
+        friend class Jit_Engine;
+        friend class Debug_History;
+        friend void ins_nop(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        template <Operand_Kind SRC_KIND>
+        friend void ins_mov(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        template <Operand_Kind DEST_KIND>
+        friend void ins_inc(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        template <Operand_Kind DEST_KIND>
+        friend void ins_dec(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+        friend void ins_add(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+        friend void ins_sub(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+        friend void ins_mul(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+        friend void ins_div(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+        friend void ins_mod(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+        friend void ins_and(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+        friend void ins_or(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        template <Operand_Kind SRC_KIND>
+        friend void ins_not(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+        friend void ins_xor(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+        friend void ins_lsh(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+        friend void ins_rsh(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        template <Operand_Kind SRC_1_KIND, Operand_Kind SRC_2_KIND>
+        friend void ins_cmp(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        friend void ins_jmp(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        friend void ins_jeq(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        friend void ins_jne(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        friend void ins_jge(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        friend void ins_jgr(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        friend void ins_jle(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        friend void ins_jls(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        friend void ins_call(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        friend void ins_ret(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        template <Operand_Kind SRC_KIND>
+        friend void ins_push(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        friend void ins_pop(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        template <Operand_Kind SRC_1_KIND, Operand_Kind SRC_2_KIND>
+        friend void ins_write(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        template <Operand_Kind SRC_KIND>
+        friend void ins_read(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        template <Operand_Kind SRC_KIND>
+        friend void ins_print(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        template <Operand_Kind SRC_KIND>
+        friend void ins_sprint(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        template <Operand_Kind SRC_KIND>
+        friend void ins_cprint(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        friend void ins_input(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        friend void ins_sinput(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        friend void ins_rand(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+        friend void ins_exit(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
         friend void pdb_handle_print(
                 const std::vector<std::string> &cmd_tokens,
                 CPU_Handle &cpu_handle
@@ -140,20 +385,345 @@ public:
 };
 
 /**
- * @brief print corresponding error message, and exit
+ * @brief raises a runtime error in the running program
+ * @details throws Runtime_Fault, which ends the run_program* method that
+ * is running
+ */
+[[noreturn]] void handle_runtime_error(Runtime_Error_Enum error_code);
+
+/**
+ * @brief prints the message of a faulted Run_Result
+ */
+void print_runtime_error(const Run_Result &result);
+
+/**
+ * @brief prints which limit ended a Run_Result, and how far it got
+ */
+void print_limit_report(const Run_Result &result);
+
+/**
+ * @fn CPU_Handle::CPU_Handle(CPU_Handle &&other)
+ * @brief takes over the memory and loaded program of other
+ * @details other is left without memory, and can only be destroyed or
+ * assigned to. Copying is deleted, since both would own the same memory,
+ * see fork for a cheap copy
+ */
+
+/**
+ * @fn CPU_Handle CPU_Handle::fork()
+ * @brief copies this handle, as it is between two runs
+ * @details the loaded program is shared. Memory is copy-on-write: both
+ * handles read the same pages until one of them writes to a page, which
+ * then gets copied into that handle's memory first. Forks can run on
+ * different threads from each other. Streams are shared too, see
+ * set_streams, but a mapped input file is read from where this handle
+ * left off by each fork on its own, see map_input. Meant for trying
+ * several continuations of one state, see run_until_input
+ */
+
+/**
+ * @fn Run_Result CPU_Handle::run_until_input()
+ * @brief runs the program until it's about to read input
+ * @details carries on from prog_ctr, or starts at main, and pauses before
+ * the next INPUT or SINPUT. One it already paused at runs, so calling it
+ * again moves on to the one after. Pausing comes back as a Run_Result with
+ * paused set. Any run_program* method carries on from there
+ */
+
+/**
+ * @fn Run_Result CPU_Handle::run_for(const uint64_t num_instructions)
+ * @brief runs at most num_instructions more instructions
+ * @details pauses like run_until_input if the program is still running
+ * after them. Fused sequences run as their separate instructions, so the
+ * count is exact
+ */
+
+/**
+ * @fn Run_Result CPU_Handle::run_stepping(uint64_t steps_left, const bool stop_at_input)
+ * @brief one instruction at a time, until EXIT or a reason to pause
+ * @details helper function of run_until_input and run_for
+ */
+
+/**
+ * @fn bool CPU_Handle::save_checkpoint(const std::string &file_path) const
+ * @brief writes the program, registers and memory to a checkpoint file
+ * @details load_checkpoint carries on exactly where this left off. The
+ * file is written next to file_path first, then renamed over it, so an
+ * older checkpoint survives being killed halfway. Returns false if it
+ * can't be written. See checkpoint.cpp for the layout
+ */
+
+/**
+ * @fn bool CPU_Handle::load_checkpoint(const std::string &file_path)
+ * @brief loads the program and state saved by save_checkpoint
+ * @details replaces whatever was loaded before. The next run_program*
+ * call carries on from the saved prog_ctr, checked as if the program
+ * weren't verified. Returns false if the file can't be read or isn't a
+ * valid checkpoint, as when prog_ctr or a return address doesn't point at
+ * an instruction, leaving this handle as it was
+ */
+
+/**
+ * @fn void CPU_Handle::own_page(const int page)
+ * @brief copies a shared page into memory, before its first write
+ * @details helper function of write_ram and write_call_stack
+ */
+
+/**
+ * @fn void CPU_Handle::own_all_pages()
+ * @brief copies every shared page into memory
+ * @details after this, memory holds the whole state, which the JIT
+ * reads and writes directly. helper function of run_program_jit
+ */
+
+/**
+ * @fn void CPU_Handle::set_streams(std::istream &given_in, std::ostream &given_out)
+ * @brief redirects the program's input and output
+ * @details std::cin and std::cout by default. Both streams have to outlive
+ * every run. Output is buffered, see Output_Sink, and flushed by the end
+ * of every run. The debugger's own prompts still use the terminal
+ */
+
+/**
+ * @fn bool CPU_Handle::map_input(const std::string &file_path, const Input_Format format)
+ * @brief INPUT and SINPUT read from the file at file_path instead
+ * @details see Input_Source::map_file. With INPUT_RAW, INPUT pushes the
+ * next word as is (clamped like any input), and SINPUT pushes words up to
+ * and including the next 0 word. Once the file runs out, INPUT is a
+ * runtime error and SINPUT pushes an empty string. Returns false if the
+ * file can't be opened
+ */
+
+/**
+ * @fn void CPU_Handle::set_raw_print_stream(std::ostream &given_stream)
+ * @brief PRINT writes its value to given_stream as a little endian word
+ * @details instead of in decimal to the output stream. CPRINT and SPRINT
+ * are unaffected. given_stream has to outlive every run, and should be
+ * opened in binary mode
+ */
+
+/**
+ * @fn void CPU_Handle::seed_rand(const uint64_t seed)
+ * @brief RAND gives the same results every run with the same seed
+ * @details otherwise, each CPU_Handle is seeded from std::random_device
+ * when it's made. Forks carry on from the same point of the sequence
+ */
+
+/**
+ * @fn void CPU_Handle::record_io(std::ostream &given_stream)
+ * @brief logs every RAND result and input read to given_stream
+ * @details see Io_Log for the format. Call it after map_input, since the
+ * log says which format input was read in. given_stream has to outlive
+ * every run
+ */
+
+/**
+ * @fn bool CPU_Handle::replay_io(const std::string &file_path)
+ * @brief RAND and input give what a log written by record_io holds
+ * @details input isn't read at all. Taking something the log doesn't
+ * hold next is a runtime error. Returns false if the log can't be read
  */
-void handle_runtime_error(Runtime_Error_Enum error_code);
 
 /**
  * @fn void CPU_Handle::load_program(const std::vector<int16_t> given_program)
  * @brief loads elements of given_program to program_data
  * @details also allocates program_data member to have enough space to load
- * given_data, since string data may be large
+ * given_data, since string data may be large, and decodes every address
+ * into decoded_program. Both are kept in a Loaded_Program, shared with
+ * forks
+ */
+
+/**
+ * @fn Run_Result CPU_Handle::run_program()
+ * @brief runs the assembled program
+ * @details starts at main, or carries on from prog_ctr if the program
+ * already ran, see run_until_input. A runtime error ends the run, and
+ * comes back in the Run_Result instead of exiting. Same for the other
+ * run_program* methods. If
+ * verify_program passed, runs run_decoded<false>, which skips
+ * the prog_ctr bounds check before every instruction. With limits set,
+ * runs run_program_limited instead
+ */
+
+/**
+ * @fn void CPU_Handle::run_decoded()
+ * @brief the run_program loop, with or without the prog_ctr bounds check
+ * @details CHECKED can only be false for a verified program. LIMITED
+ * counts instructions, and checks them against limits wherever the
+ * program jumps, calls or returns, since any loop has to. Everything else
+ * is checked there too, every LIMIT_CHECK_INTERVAL instructions. helper
+ * function of run_program and run_program_limited
+ */
+
+/**
+ * @fn Run_Result CPU_Handle::run_program_limited()
+ * @brief run_program, counting usage and stopping at the first limit hit
+ * @details helper function of run_program
+ */
+
+/**
+ * @fn uint64_t CPU_Handle::check_limits()
+ * @brief throws Limit_Stop if the program is past a limit
+ * @details otherwise, returns the instruction count to check again at.
+ * helper function of run_decoded
+ */
+
+/**
+ * @fn uint64_t CPU_Handle::elapsed_millis() const
+ * @brief milliseconds run_program_limited has run for, over every run
+ */
+
+/**
+ * @fn void CPU_Handle::count_input()
+ * @brief counts one INPUT or SINPUT
+ * @details throws Limit_Stop instead if limits are enforced and there's
+ * been max_input_reads already. helper function of ins_input and
+ * ins_sinput
+ */
+
+/**
+ * @fn Input_Format CPU_Handle::input_format() const
+ * @brief the format INPUT and SINPUT read in, that of the replayed log
+ * when replaying
  */
 
 /**
- * @fn void CPU_Handle::run_program(const bool is_debug)
- * @brief runs the assembled program, with a debugger if enabled
+ * @fn std::string_view CPU_Handle::read_input_line()
+ * @brief the next line for INPUT or SINPUT, from the log when replaying
+ * @details recorded if recording. Output is flushed first when the line
+ * comes from a stream, so a prompt printed just before shows up
+ */
+
+/**
+ * @fn bool CPU_Handle::read_input_word(int16_t &word)
+ * @brief the next raw word for INPUT or SINPUT, like read_input_line
+ * @details false once the input has run out
+ */
+
+/**
+ * @fn int16_t CPU_Handle::next_rand()
+ * @brief the next RAND result, from -100 to 100
+ * @details drawn from prng, or taken from the log when replaying
+ */
+
+/**
+ * @fn void CPU_Handle::set_limits(const Run_Limits &given_limits)
+ * @brief quotas run_program enforces from now on
+ * @details a run that reaches one ends with limit_hit set in its
+ * Run_Result instead of faulting. The instruction and time limits are
+ * checked at the next jump, call or return, so the program can go a few
+ * instructions past them. Output past max_output_bytes is never written.
+ * run_program_threaded and run_program_jit use run_program while limits
+ * are set. The debugger, run_for and run_until_input ignore them
+ */
+
+/**
+ * @fn const Decoded_Instruction &CPU_Handle::current_instruction() const
+ * @brief gets the decoded instruction at prog_ctr
+ * @details prog_ctr must be inside the program. Used by the fused handlers
+ * to reach the rest of their sequence
+ */
+
+/**
+ * @fn const Decoded_Instruction &CPU_Handle::decoded_instruction(const int16_t address) const
+ * @brief gets the decoded instruction at address
+ * @details address must be inside the program. Used by the --profile report
+ */
+
+/**
+ * @fn void CPU_Handle::count_fusion(const Fusion_Enum fusion)
+ * @brief counts one run of a fused sequence, for --fusion-stats
+ */
+
+/**
+ * @fn void CPU_Handle::count_landing_pop()
+ * @brief counts the POP a RET+POP ran after its RET
+ * @details as a RET+POP for --fusion-stats, and as one more instruction
+ * for Run_Limits, since FUSION_LENGTHS only counts the RET, which is all
+ * that runs when the RET lands anywhere else
+ */
+
+/**
+ * @fn Run_Result CPU_Handle::get_run_result(const Runtime_Error_Enum error_code)
+ * @brief puts the current registers in a Run_Result
+ * @details also flushes output, so everything the program printed is out
+ * before the caller reports the result. helper function of the
+ * run_program* methods
+ */
+
+/**
+ * @fn Run_Result CPU_Handle::run_program_threaded()
+ * @brief runs the assembled program with direct threaded dispatch
+ * @details same results as run_program. Falls back to run_program when the
+ * compiler doesn't support labels as values
+ */
+
+/**
+ * @fn void CPU_Handle::run_threaded()
+ * @brief run_program_threaded, with or without the prog_ctr bounds check
+ * @details see run_decoded
+ */
+
+/**
+ * @fn Run_Result CPU_Handle::run_program_jit()
+ * @brief runs the assembled program, compiling blocks to native code
+ * @details same results as run_program. Only x86-64 Linux gets native
+ * code, see jit_engine.cpp, elsewhere this is run_program
+ */
+
+/**
+ * @fn void CPU_Handle::run_jit()
+ * @brief the run_program_jit loop, helper function of run_program_jit
+ */
+
+/**
+ * @fn Run_Result CPU_Handle::run_program_debug(const std::map<int16_t, std::string> &symbols)
+ * @brief runs the assembled program in the PAL debugger
+ * @details quitting the debugger ends the run without a fault. symbols are
+ * the label names the disassembly shows, by program address, and can be
+ * empty
+ */
+
+/**
+ * @fn Run_Result CPU_Handle::run_program_debug_script(std::istream &script, Debug_Report &report, const std::map<int16_t, std::string> &symbols)
+ * @brief runs the assembled program in the PAL debugger, taking commands
+ * from script instead of the terminal
+ * @details one command a line, and lines starting with # are skipped.
+ * Every stop, print, error and the end of the session is written to
+ * report. Running out of commands ends the run like quit, see
+ * debug_report.cpp
+ */
+
+/**
+ * @fn void CPU_Handle::run_debugger(std::istream *script, Debug_Report *report, const std::map<int16_t, std::string> &symbols)
+ * @brief the debugger session, helper function of run_program_debug and
+ * run_program_debug_script
+ * @details both script and report are null, unless commands come from a
+ * --debug-script
+ */
+
+/**
+ * @fn Debug_Stop_Enum CPU_Handle::run_to_breakpoint(Debug_Breakpoints &breakpoints, const bool skip_first)
+ * @brief the debugger's continue, at close to the speed of run_program
+ * @details runs until EXIT, a breakpoint whose condition holds, or a write
+ * to a watched address. The breakpoint at prog_ctr is skipped if
+ * skip_first, since the debugger stopped there. Nothing is logged for
+ * reverse-next, see Debug_History. helper function of run_debugger
+ */
+
+/**
+ * @fn Run_Result CPU_Handle::run_program_profiled(Profile &profile)
+ * @brief runs the assembled program, counting every instruction that runs
+ * @details counts go to profile.executions and profile.taken, by address,
+ * and carry on from an earlier run of the same program. Runs unfused and
+ * ignores limits, see profiler.cpp
+ */
+
+/**
+ * @fn Run_Result CPU_Handle::run_program_traced(Trace_Writer &trace)
+ * @brief runs the assembled program, writing a record of every instruction to trace
+ * @details writes the trace header first, if trace hasn't been written to
+ * yet. Runs unfused and ignores limits, see trace.cpp
  */
 
 /**
@@ -164,9 +734,110 @@ void handle_runtime_error(Runtime_Error_Enum error_code);
  */
 
 /**
- * @fn int16_t CPU_Handle::dereference_value(int16_t given_value);
+ * @fn int16_t CPU_Handle::dereference_value(const Decoded_Operand &operand);
  * @brief gets the intended source value, whether it's a register, offset, or literal
- * @details helper function of CPU_Handle::next_instruction
+ * @details helper function of the ins_* functions
  */
 
+/**
+ * @fn int16_t CPU_Handle::read_register(const int16_t idx) const
+ * @brief gets the value of register idx, RZ through CMP1
+ * @details idx has to be a valid register, see Register_Enum
+ */
+
+/**
+ * @fn int16_t CPU_Handle::read_ram(const int16_t address) const
+ * @brief gets a word of ram or stack, through its page
+ * @details an address outside [0, RAM_SIZE) raises OOB_ADDRESS, so a bad
+ * stack_ptr or offset ends the run instead of reading past the pages
+ */
+
+/**
+ * @fn void CPU_Handle::write_ram(const int16_t address, const int16_t value)
+ * @brief sets a word of ram or stack
+ * @details copies its page first if it's still shared, see fork. An
+ * address outside [0, RAM_SIZE) raises OOB_ADDRESS. Logged to write_log,
+ * if set
+ */
+
+/**
+ * @fn int16_t CPU_Handle::read_call_stack(const int16_t idx) const
+ * @brief read_ram, for the call stack
+ * @details an idx outside [0, CALL_STACK_SIZE) raises a call stack error
+ */
+
+/**
+ * @fn void CPU_Handle::write_call_stack(const int16_t idx, const int16_t value)
+ * @brief write_ram, for the call stack
+ * @details an idx outside [0, CALL_STACK_SIZE) raises a call stack error
+ */
+
+/**
+ * @fn int16_t CPU_Handle::load_operand(const Decoded_Operand &operand)
+ * @brief dereference_value, with the addressing mode known at compile time
+ * @details KIND is the kind of operand, or OPERAND_NONE when it's only
+ * known at runtime, which goes through dereference_value. OPERAND_LITERAL
+ * also covers string addresses and labels. OPERAND_RAM_ADDR skips the
+ * range check, so it's only picked for addresses inside the RAM, see
+ * specialise_program
+ */
+template <Operand_Kind KIND>
+inline int16_t CPU_Handle::load_operand(const Decoded_Operand &operand) {
+        if constexpr (KIND == OPERAND_LITERAL || KIND == OPERAND_STR_ADDR) {
+                return operand.value;
+        } else if constexpr (KIND == OPERAND_REGISTER) {
+                return read_register(operand.value);
+        } else if constexpr (KIND == OPERAND_STACK_OFFSET) {
+                const int16_t stack_ptr = registers[REG_RSP];
+                if (operand.value > stack_ptr || stack_ptr <= 0) {
+                        handle_runtime_error(INVALID_STACK_OFFSET);
+                }
+                return read_ram(STACK_START + stack_ptr - operand.value - 1);
+        } else if constexpr (KIND == OPERAND_RAM_ADDR) {
+                return read_ram(operand.value);
+        } else {
+                return dereference_value(operand);
+        }
+}
+
+inline int16_t CPU_Handle::read_register(const int16_t idx) const {
+        return registers[idx];
+}
+
+inline int16_t CPU_Handle::read_ram(const int16_t address) const {
+        // unsigned, so a negative address fails too
+        if ((uint16_t)address >= RAM_SIZE)
+                handle_runtime_error(OOB_ADDRESS);
+        return memory_pages[address >> MEMORY_PAGE_SHIFT][address & (MEMORY_PAGE_SIZE - 1)];
+}
+
+inline void CPU_Handle::write_ram(const int16_t address, const int16_t value) {
+        if ((uint16_t)address >= RAM_SIZE)
+                handle_runtime_error(OOB_ADDRESS);
+        const int page = address >> MEMORY_PAGE_SHIFT;
+        if (write_log)
+                write_log->push_back({SPACE_RAM, address, read_ram(address), value});
+        if (!((owned_pages >> page) & 1))
+                own_page(page);
+        memory->program_mem[address] = value;
+}
+
+inline int16_t CPU_Handle::read_call_stack(const int16_t idx) const {
+        if ((uint16_t)idx >= CALL_STACK_SIZE)
+                handle_runtime_error(idx < 0 ? CALL_STACK_UNDERFLOW : CALL_STACK_OVERFLOW);
+        const int page = NUM_RAM_PAGES + (idx >> MEMORY_PAGE_SHIFT);
+        return memory_pages[page][idx & (MEMORY_PAGE_SIZE - 1)];
+}
+
+inline void CPU_Handle::write_call_stack(const int16_t idx, const int16_t value) {
+        if ((uint16_t)idx >= CALL_STACK_SIZE)
+                handle_runtime_error(idx < 0 ? CALL_STACK_UNDERFLOW : CALL_STACK_OVERFLOW);
+        const int page = NUM_RAM_PAGES + (idx >> MEMORY_PAGE_SHIFT);
+        if (write_log)
+                write_log->push_back({SPACE_CALL_STACK, idx, read_call_stack(idx), value});
+        if (!((owned_pages >> page) & 1))
+                own_page(page);
+        memory->call_stack[idx] = value;
+}
+
 #endif
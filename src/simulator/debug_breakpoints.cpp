@@ -0,0 +1,265 @@
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../common_values.h"
+#include "../instruction_types.h"
+#include "cpu_handle.h"
+#include "debug_breakpoints.h"
+#include "decoder.h"
+
+Debug_Stop_Enum CPU_Handle::run_to_breakpoint(Debug_Breakpoints &breakpoints, const bool skip_first) {
+        int16_t &prog_ctr = registers[REG_RIP];
+        if (prog_ctr == 0)
+                prog_ctr = get_program_data(4);
+        const uint8_t *is_breakpoint = breakpoints.get_breakpoint_map();
+        std::vector<Memory_Write> memory_writes;
+        if (breakpoints.has_watches())
+                write_log = &memory_writes;
+
+        // run_decoded, unfused so a breakpoint inside a fused sequence
+        // still stops, with one bitmap lookup per instruction
+        Debug_Stop_Enum stop = DEBUG_STOP_EXIT;
+        bool skip_check = skip_first;
+        try {
+                while (true) {
+                        if (prog_ctr < 0 || prog_ctr >= prog_size) {
+                                handle_runtime_error(UNKNOWN_OPCODE);
+                        }
+                        if (is_breakpoint[prog_ctr] && !skip_check && breakpoints.should_break(*this, prog_ctr)) {
+                                stop = DEBUG_STOP_BREAKPOINT;
+                                break;
+                        }
+                        skip_check = false;
+                        const Decoded_Instruction &ins = decoded_program[prog_ctr];
+                        ins.base_handler(*this, ins);
+                        if (write_log && !memory_writes.empty()) {
+                                if (breakpoints.find_watched(memory_writes)) {
+                                        stop = DEBUG_STOP_WATCHPOINT;
+                                        break;
+                                }
+                                memory_writes.clear();
+                        }
+                        if (ins.opcode == OP_EXIT)
+                                break;
+                }
+        } catch (const Runtime_Fault &) {
+                write_log = nullptr;
+                throw;
+        }
+        write_log = nullptr;
+        // the debugger's prompt comes after the program's output
+        output.flush();
+        return stop;
+}
+
+Debug_Breakpoints::Debug_Breakpoints() {
+        is_watched.assign(RAM_SIZE, 0);
+        num_watched = 0;
+        watch_hit = -1;
+}
+
+void Debug_Breakpoints::set_program(const int16_t prog_size, const std::vector<int16_t> &mnemonic_addrs) {
+        is_breakpoint.assign(prog_size, 0);
+        is_instruction.assign(prog_size, 0);
+        for (int16_t address : mnemonic_addrs)
+                is_instruction[address] = 1;
+        conditions.clear();
+        clear_watches();
+}
+
+bool Debug_Breakpoints::can_break_at(const int16_t address) const {
+        return address >= 0 && (size_t)address < is_instruction.size() && is_instruction[address];
+}
+
+void Debug_Breakpoints::add_breakpoint(const int16_t address) {
+        is_breakpoint[address] = 1;
+        conditions.erase(address);
+}
+
+void Debug_Breakpoints::add_breakpoint(const int16_t address, const Break_Condition &condition) {
+        is_breakpoint[address] = 1;
+        conditions[address] = condition;
+}
+
+bool Debug_Breakpoints::remove_breakpoint(const int16_t address) {
+        if (address < 0 || (size_t)address >= is_breakpoint.size() || !is_breakpoint[address])
+                return false;
+        is_breakpoint[address] = 0;
+        conditions.erase(address);
+        return true;
+}
+
+void Debug_Breakpoints::clear_breakpoints() {
+        is_breakpoint.assign(is_breakpoint.size(), 0);
+        conditions.clear();
+}
+
+std::vector<int16_t> Debug_Breakpoints::list_breakpoints() const {
+        std::vector<int16_t> addresses;
+        for (size_t address = 0; address < is_breakpoint.size(); ++address) {
+                if (is_breakpoint[address])
+                        addresses.push_back((int16_t)address);
+        }
+        return addresses;
+}
+
+/**
+ * @brief writes an operand back the way parse_debug_operand reads it
+ * @details helper function of Debug_Breakpoints::describe_breakpoint
+ */
+static std::string describe_operand(const Decoded_Operand &operand) {
+        switch (operand.kind) {
+        case OPERAND_REGISTER:
+                for (const auto &entry : REGISTER_TABLE) {
+                        if (entry.second == operand.value)
+                                return entry.first;
+                }
+                return "?";
+        case OPERAND_STACK_OFFSET:
+                return "%" + std::to_string(operand.value);
+        default:
+                return "[$" + std::to_string(operand.value) + "]";
+        }
+}
+
+std::string Debug_Breakpoints::describe_breakpoint(const int16_t address) const {
+        std::string description = "#" + std::to_string(address);
+        auto found = conditions.find(address);
+        if (found != conditions.end()) {
+                const Break_Condition &condition = found->second;
+                description += " if " + describe_operand(condition.operand);
+                description += " " + std::string(COMPARE_NAMES[condition.compare]);
+                description += " " + std::to_string(condition.value);
+        }
+        return description;
+}
+
+bool Debug_Breakpoints::should_break(CPU_Handle &cpu_handle, const int16_t address) const {
+        if (!is_breakpoint[address])
+                return false;
+        auto found = conditions.find(address);
+        if (found == conditions.end())
+                return true;
+        const Break_Condition &condition = found->second;
+        int16_t value = 0;
+        try {
+                value = cpu_handle.dereference_value(condition.operand);
+        } catch (const Runtime_Fault &) {
+                return true;
+        }
+        switch (condition.compare) {
+        case COMPARE_EQ: return value == condition.value;
+        case COMPARE_NE: return value != condition.value;
+        case COMPARE_LS: return value < condition.value;
+        case COMPARE_LE: return value <= condition.value;
+        case COMPARE_GR: return value > condition.value;
+        case COMPARE_GE: return value >= condition.value;
+        default:         return true;
+        }
+}
+
+const uint8_t *Debug_Breakpoints::get_breakpoint_map() const {
+        return is_breakpoint.data();
+}
+
+void Debug_Breakpoints::add_watch(const int16_t address) {
+        if (!is_watched[address])
+                num_watched++;
+        is_watched[address] = 1;
+}
+
+bool Debug_Breakpoints::remove_watch(const int16_t address) {
+        if (address < 0 || address >= RAM_SIZE || !is_watched[address])
+                return false;
+        is_watched[address] = 0;
+        num_watched--;
+        return true;
+}
+
+void Debug_Breakpoints::clear_watches() {
+        is_watched.assign(RAM_SIZE, 0);
+        num_watched = 0;
+}
+
+std::vector<int16_t> Debug_Breakpoints::list_watches() const {
+        std::vector<int16_t> addresses;
+        for (int16_t address = 0; address < RAM_SIZE; ++address) {
+                if (is_watched[address])
+                        addresses.push_back(address);
+        }
+        return addresses;
+}
+
+bool Debug_Breakpoints::has_watches() const {
+        return num_watched != 0;
+}
+
+bool Debug_Breakpoints::find_watched(const std::vector<Memory_Write> &memory_writes) {
+        for (const Memory_Write &write : memory_writes) {
+                if (write.space == SPACE_RAM && is_watched[write.address]) {
+                        watch_hit = write.address;
+                        return true;
+                }
+        }
+        return false;
+}
+
+int16_t Debug_Breakpoints::get_watch_hit() const {
+        return watch_hit;
+}
+
+bool parse_debug_number(const std::string &text, int &number) {
+        size_t start = (!text.empty() && text[0] == '$') ? 1 : 0;
+        size_t first_digit = (text.length() > start && text[start] == '-') ? start + 1 : start;
+        bool is_number = text.length() > first_digit && text.length() - first_digit <= 5;
+        for (size_t i = first_digit; i < text.length(); ++i)
+                is_number = is_number && isdigit(text[i]);
+        if (!is_number)
+                return false;
+        number = std::stoi(text.substr(start));
+        return number >= INT16_MIN && number <= INT16_MAX;
+}
+
+bool parse_debug_operand(const std::string &text, Decoded_Operand &operand) {
+        int number = 0;
+        if (REGISTER_TABLE.count(text)) {
+                operand = Decoded_Operand{OPERAND_REGISTER, REGISTER_TABLE.at(text)};
+                return true;
+        }
+        if (text.length() > 1 && text[0] == '%') {
+                if (!parse_debug_number(text.substr(1), number) || number < 0 || number >= STACK_SIZE)
+                        return false;
+                operand = Decoded_Operand{OPERAND_STACK_OFFSET, (int16_t)number};
+                return true;
+        }
+        if (text.length() > 2 && text.front() == '[' && text.back() == ']') {
+                if (!parse_debug_number(text.substr(1, text.length() - 2), number) || number < 0 || number >= STACK_START)
+                        return false;
+                operand = Decoded_Operand{OPERAND_RAM_ADDR, (int16_t)number};
+                return true;
+        }
+        return false;
+}
+
+bool parse_break_condition(const std::vector<std::string> &tokens, Break_Condition &condition) {
+        if (tokens.size() != 4 || tokens[0] != "if")
+                return false;
+        if (!parse_debug_operand(tokens[1], condition.operand))
+                return false;
+        bool found_compare = false;
+        for (int i = 0; i < NUM_COMPARES; ++i) {
+                if (tokens[2] == COMPARE_NAMES[i]) {
+                        condition.compare = (Compare_Enum)i;
+                        found_compare = true;
+                }
+        }
+        int number = 0;
+        if (!found_compare || !parse_debug_number(tokens[3], number))
+                return false;
+        condition.value = (int16_t)number;
+        return true;
+}
@@ -0,0 +1,142 @@
+#ifndef DEBUG_BREAKPOINTS_H
+#define DEBUG_BREAKPOINTS_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "cpu_handle.h"
+#include "decoder.h"
+
+/**
+ * @brief comparisons a breakpoint condition can make
+ */
+enum Compare_Enum : uint8_t {
+        COMPARE_EQ = 0, ///< ==
+        COMPARE_NE,     ///< !=
+        COMPARE_LS,     ///< <
+        COMPARE_LE,     ///< <=
+        COMPARE_GR,     ///< >
+        COMPARE_GE,     ///< >=
+        NUM_COMPARES,
+};
+
+/**
+ * @brief how each Compare_Enum is written after "if"
+ */
+const char *const COMPARE_NAMES[NUM_COMPARES] = {"==", "!=", "<", "<=", ">", ">="};
+
+/**
+ * @brief what a conditional breakpoint checks before it stops
+ * @details the operand is a register, stack offset or ram address, read
+ * the same way an instruction would
+ */
+struct Break_Condition {
+        Decoded_Operand operand;
+        Compare_Enum compare;
+        int16_t value;
+};
+
+/**
+ * @brief why CPU_Handle::run_to_breakpoint returned
+ */
+enum Debug_Stop_Enum : uint8_t {
+        DEBUG_STOP_EXIT = 0,    ///< the program ran EXIT
+        DEBUG_STOP_BREAKPOINT,  ///< prog_ctr is at a breakpoint whose condition holds
+        DEBUG_STOP_WATCHPOINT,  ///< the last instruction wrote a watched ram address
+};
+
+/**
+ * @brief breakpoints and watchpoints of a PAL debugger session
+ * @details both are bitmaps, one byte per program address and one per ram
+ * address, so checking one costs the same however many are set
+ */
+class Debug_Breakpoints {
+        std::vector<uint8_t> is_breakpoint; /** per program address */
+        std::vector<uint8_t> is_instruction; /** per program address, where breakpoints can go */
+        std::map<int16_t, Break_Condition> conditions; /** of the breakpoints that have one */
+        std::vector<uint8_t> is_watched; /** per ram address, shadows program_mem */
+        size_t num_watched;
+        int16_t watch_hit; /** address find_watched last found */
+public:
+        Debug_Breakpoints();
+        void set_program(const int16_t prog_size, const std::vector<int16_t> &mnemonic_addrs);
+        bool can_break_at(const int16_t address) const;
+        void add_breakpoint(const int16_t address);
+        void add_breakpoint(const int16_t address, const Break_Condition &condition);
+        bool remove_breakpoint(const int16_t address);
+        void clear_breakpoints();
+        std::vector<int16_t> list_breakpoints() const;
+        std::string describe_breakpoint(const int16_t address) const;
+        bool should_break(CPU_Handle &cpu_handle, const int16_t address) const;
+        const uint8_t *get_breakpoint_map() const;
+        void add_watch(const int16_t address);
+        bool remove_watch(const int16_t address);
+        void clear_watches();
+        std::vector<int16_t> list_watches() const;
+        bool has_watches() const;
+        bool find_watched(const std::vector<Memory_Write> &memory_writes);
+        int16_t get_watch_hit() const;
+};
+
+/**
+ * @brief parses a whole number, with an optional $ in front
+ * @details false unless it fits in an int16_t, so the debugger's commands
+ * can take counts and addresses without std::stoi throwing
+ */
+bool parse_debug_number(const std::string &text, int &number);
+
+/**
+ * @brief parses the operand of a condition or watchpoint
+ * @details a register, a stack offset (%n), or a ram address ([$n]), the
+ * same as the print command takes. Returns false if text is none of them
+ */
+bool parse_debug_operand(const std::string &text, Decoded_Operand &operand);
+
+/**
+ * @brief parses the "if <operand> <compare> <value>" after a breakpoint address
+ * @details tokens are the words of the command, starting at "if". Returns
+ * false if they aren't a condition
+ */
+bool parse_break_condition(const std::vector<std::string> &tokens, Break_Condition &condition);
+
+/**
+ * @fn void Debug_Breakpoints::set_program(const int16_t prog_size, const std::vector<int16_t> &mnemonic_addrs)
+ * @brief sizes the bitmaps for the program, and marks where breakpoints can go
+ * @details clears every breakpoint and watchpoint
+ */
+
+/**
+ * @fn bool Debug_Breakpoints::should_break(CPU_Handle &cpu_handle, const int16_t address) const
+ * @brief whether the program should stop before running the instruction at address
+ * @details true if there's a breakpoint there, and its condition holds. A
+ * condition that can't be read, like a stack offset past the stack,
+ * counts as holding, so the program stops where it went wrong
+ */
+
+/**
+ * @fn const uint8_t *Debug_Breakpoints::get_breakpoint_map() const
+ * @brief the breakpoint bitmap, one byte per program address
+ * @details read directly by CPU_Handle::run_to_breakpoint
+ */
+
+/**
+ * @fn std::string Debug_Breakpoints::describe_breakpoint(const int16_t address) const
+ * @brief "#address", followed by its condition if it has one
+ */
+
+/**
+ * @fn void Debug_Breakpoints::add_watch(const int16_t address)
+ * @brief stops the program after any instruction that writes address
+ * @details address is into ram and stack, see write_ram
+ */
+
+/**
+ * @fn bool Debug_Breakpoints::find_watched(const std::vector<Memory_Write> &memory_writes)
+ * @brief whether any of memory_writes went to a watched address
+ * @details the first one found is kept, see get_watch_hit
+ */
+
+#endif
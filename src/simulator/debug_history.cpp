@@ -0,0 +1,123 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include "../instruction_types.h"
+#include "cpu_handle.h"
+#include "debug_history.h"
+
+Debug_History::Debug_History() {
+        num_undone = 0;
+        undone_changes = 0;
+        for (int i = 0; i < NUM_REGISTERS; ++i)
+                old_registers[i] = 0;
+        old_call_stack_ptr = 0;
+}
+
+bool Debug_History::can_undo() const {
+        return num_undone < step_sizes.size();
+}
+
+bool Debug_History::can_redo() const {
+        return num_undone != 0;
+}
+
+void Debug_History::run_step(CPU_Handle &cpu_handle, bool &hit_exit, const bool continue_cond) {
+        // a step that wasn't redone replaces whatever was undone
+        while (num_undone != 0) {
+                changes.resize(changes.size() - step_sizes.back());
+                step_sizes.pop_back();
+                num_undone--;
+        }
+        undone_changes = 0;
+
+        std::memcpy(old_registers, cpu_handle.registers, sizeof(old_registers));
+        old_call_stack_ptr = cpu_handle.call_stack_ptr;
+        memory_writes.clear();
+        cpu_handle.write_log = &memory_writes;
+        try {
+                cpu_handle.next_instruction(hit_exit, continue_cond);
+        } catch (const Runtime_Fault &) {
+                cpu_handle.write_log = nullptr;
+                throw;
+        }
+        cpu_handle.write_log = nullptr;
+
+        uint32_t num_changes = 0;
+        for (int i = 0; i < NUM_REGISTERS; ++i) {
+                if (old_registers[i] == cpu_handle.registers[i])
+                        continue;
+                changes.push_back({HISTORY_REGISTER, (int16_t)i, old_registers[i], cpu_handle.registers[i]});
+                num_changes++;
+        }
+        if (old_call_stack_ptr != cpu_handle.call_stack_ptr) {
+                changes.push_back({HISTORY_CALL_STACK_PTR, 0, old_call_stack_ptr, cpu_handle.call_stack_ptr});
+                num_changes++;
+        }
+        for (const Memory_Write &write : memory_writes) {
+                History_Target target = (write.space == SPACE_RAM) ? HISTORY_RAM : HISTORY_CALL_STACK;
+                changes.push_back({target, write.address, write.old_value, write.value});
+                num_changes++;
+        }
+        step_sizes.push_back(num_changes);
+
+        // the newest step is kept, however much it changed
+        while (changes.size() > DEBUG_HISTORY_MAX_CHANGES && step_sizes.size() > 1)
+                drop_oldest();
+}
+
+void Debug_History::drop_oldest() {
+        changes.erase(changes.begin(), changes.begin() + step_sizes.front());
+        step_sizes.pop_front();
+}
+
+void Debug_History::apply(CPU_Handle &cpu_handle, const History_Change &change, const bool is_undo) {
+        const int16_t value = is_undo ? change.old_value : change.new_value;
+        switch (change.target) {
+        case HISTORY_REGISTER:
+                cpu_handle.registers[change.address] = value;
+                break;
+        case HISTORY_RAM:
+                cpu_handle.write_ram(change.address, value);
+                break;
+        case HISTORY_CALL_STACK:
+                cpu_handle.write_call_stack(change.address, value);
+                break;
+        case HISTORY_CALL_STACK_PTR:
+                cpu_handle.call_stack_ptr = value;
+                break;
+        }
+}
+
+void Debug_History::undo(CPU_Handle &cpu_handle) {
+        const uint32_t num_changes = step_sizes[step_sizes.size() - num_undone - 1];
+        const size_t end = changes.size() - undone_changes;
+        // backwards, in case a step wrote the same word twice
+        for (size_t i = end; i > end - num_changes; --i)
+                apply(cpu_handle, changes[i - 1], true);
+        num_undone++;
+        undone_changes += num_changes;
+}
+
+void Debug_History::redo(CPU_Handle &cpu_handle) {
+        const uint32_t num_changes = step_sizes[step_sizes.size() - num_undone];
+        const size_t start = changes.size() - undone_changes;
+        memory_writes.clear();
+        for (size_t i = start; i < start + num_changes; ++i) {
+                const History_Change &change = changes[i];
+                apply(cpu_handle, change, false);
+                // same as run_step would have logged, for watchpoints
+                if (change.target == HISTORY_RAM)
+                        memory_writes.push_back({SPACE_RAM, change.address, change.old_value, change.new_value});
+                else if (change.target == HISTORY_CALL_STACK)
+                        memory_writes.push_back({SPACE_CALL_STACK, change.address, change.old_value, change.new_value});
+        }
+        num_undone--;
+        undone_changes -= num_changes;
+}
+
+const std::vector<Memory_Write> &Debug_History::get_memory_writes() const {
+        return memory_writes;
+}
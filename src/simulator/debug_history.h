@@ -0,0 +1,108 @@
+#ifndef DEBUG_HISTORY_H
+#define DEBUG_HISTORY_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "../instruction_types.h"
+#include "cpu_handle.h"
+
+/**
+ * @brief most changes Debug_History keeps before dropping its oldest steps
+ * @details 8 bytes each, so the history stays under about 130 MB
+ */
+const size_t DEBUG_HISTORY_MAX_CHANGES = (size_t)1 << 24;
+
+/**
+ * @brief what a History_Change changed
+ */
+enum History_Target : uint8_t {
+        HISTORY_REGISTER = 0,   ///< address is the register idx, RIP included
+        HISTORY_RAM,            ///< address is into ram and stack
+        HISTORY_CALL_STACK,     ///< address is into the call stack
+        HISTORY_CALL_STACK_PTR, ///< address is unused
+};
+
+/**
+ * @brief one word an instruction changed, before and after
+ */
+struct History_Change {
+        History_Target target;
+        int16_t address;
+        int16_t old_value;
+        int16_t new_value;
+};
+
+/**
+ * @brief undo log of the instructions run in the PAL debugger
+ * @details every step keeps the old and new value of everything it
+ * changed, so reverse-next and reverse-continue undo steps one at a time,
+ * and next and continue redo them until they're back where the program
+ * got to, then run it again. Either way, moving n steps costs time
+ * proportional to n. Redone steps aren't run, so nothing is printed or
+ * read twice, and RAND gives the same results. Output and input aren't
+ * undone
+ */
+class Debug_History {
+        std::deque<uint32_t> step_sizes; /** changes of each step, oldest first */
+        std::deque<History_Change> changes; /** of every step, in order */
+        size_t num_undone; /** steps at the back that were undone */
+        size_t undone_changes; /** changes at the back that were undone */
+        std::vector<Memory_Write> memory_writes; /** of the step running, see CPU_Handle::write_log */
+        int16_t old_registers[NUM_REGISTERS]; /** from before the step running */
+        int16_t old_call_stack_ptr; /** from before the step running */
+
+        void apply(CPU_Handle &cpu_handle, const History_Change &change, const bool is_undo);
+        void drop_oldest();
+public:
+        Debug_History();
+        void run_step(CPU_Handle &cpu_handle, bool &hit_exit, const bool continue_cond);
+        bool can_undo() const;
+        bool can_redo() const;
+        void undo(CPU_Handle &cpu_handle);
+        void redo(CPU_Handle &cpu_handle);
+        const std::vector<Memory_Write> &get_memory_writes() const;
+};
+
+/**
+ * @fn void Debug_History::run_step(CPU_Handle &cpu_handle, bool &hit_exit, const bool continue_cond)
+ * @brief CPU_Handle::next_instruction, logging what it changed
+ * @details only once every undone step is redone. If the instruction
+ * faults, nothing is logged
+ */
+
+/**
+ * @fn const std::vector<Memory_Write> &Debug_History::get_memory_writes() const
+ * @brief the memory the step run_step ran, or redo redid, wrote last
+ * @details for watchpoints, which a redone step hits like a run one
+ */
+
+/**
+ * @fn void Debug_History::undo(CPU_Handle &cpu_handle)
+ * @brief puts back everything the last step not undone changed
+ * @details can_undo has to be true
+ */
+
+/**
+ * @fn void Debug_History::redo(CPU_Handle &cpu_handle)
+ * @brief changes everything the first undone step changed again
+ * @details can_redo has to be true. What it wrote to memory is kept, see
+ * get_memory_writes
+ */
+
+/**
+ * @fn void Debug_History::apply(CPU_Handle &cpu_handle, const History_Change &change, const bool is_undo)
+ * @brief sets the word change is about to its old value, or its new one
+ * @details helper function of undo and redo
+ */
+
+/**
+ * @fn void Debug_History::drop_oldest()
+ * @brief forgets the oldest step, so it can't be undone anymore
+ * @details helper function of run_step, once there are more than
+ * DEBUG_HISTORY_MAX_CHANGES changes
+ */
+
+#endif
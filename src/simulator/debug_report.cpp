@@ -0,0 +1,174 @@
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../common_values.h"
+#include "../instruction_types.h"
+#include "cpu_handle.h"
+#include "debug_breakpoints.h"
+#include "debug_report.h"
+#include "decoder.h"
+#include "pal_debugger.h"
+
+// --debug-script: CPU_Handle::run_program_debug_script, and the JSON lines
+// it writes. See Debug_Report for the layout
+
+Run_Result CPU_Handle::run_program_debug_script(
+        std::istream &script,
+        Debug_Report &report,
+        const std::map<int16_t, std::string> &symbols
+) {
+        try {
+                run_debugger(&script, &report, symbols);
+        } catch (const Runtime_Fault &fault) {
+                report.put_end(*this, "fault", fault.error_code);
+                return get_run_result(fault.error_code);
+        }
+        return get_run_result(NO_RUNTIME_ERROR);
+}
+
+/**
+ * @brief writes text as a JSON string, quotes included
+ * @details helper function of Debug_Report
+ */
+static void put_json_string(std::ostream &stream, const std::string &text) {
+        const char HEX_DIGITS[] = "0123456789abcdef";
+        stream << '"';
+        for (char letter : text) {
+                if (letter == '"' || letter == '\\') {
+                        stream << '\\' << letter;
+                } else if ((unsigned char)letter < 0x20) {
+                        stream << "\\u00" << HEX_DIGITS[(letter >> 4) & 0xf] << HEX_DIGITS[letter & 0xf];
+                } else {
+                        stream << letter;
+                }
+        }
+        stream << '"';
+}
+
+/**
+ * @brief the instruction at address, disassembled like the list command
+ * @details without the address, and one space between each part. Empty
+ * if address isn't in the program. helper function of Debug_Report::put_state
+ */
+static std::string instruction_text(const CPU_Handle &cpu_handle, const int16_t address) {
+        if (address < 0 || address >= cpu_handle.get_prog_size())
+                return "";
+        int16_t opcode = cpu_handle.get_program_data(address);
+        int16_t ins_len = (int16_t)get_instruction(opcode).length;
+        std::vector<int16_t> instruction = {};
+        for (int16_t i = 0; i < ins_len && address + i < cpu_handle.get_prog_size(); ++i)
+                instruction.push_back(cpu_handle.get_program_data(address + i));
+        if ((int16_t)instruction.size() != ins_len)
+                return "";
+
+        std::string padded = disassemble_instruction(instruction, address, NO_SYMBOLS);
+        std::string text = "";
+        size_t start = padded.find(": ");
+        for (size_t i = (start == std::string::npos) ? 0 : start + 2; i < padded.length(); ++i) {
+                if (padded[i] == ' ' && (text.empty() || text.back() == ' '))
+                        continue;
+                text += padded[i];
+        }
+        while (!text.empty() && text.back() == ' ')
+                text.pop_back();
+        return text;
+}
+
+Debug_Report::Debug_Report(std::ostream &given_stream) {
+        stream = &given_stream;
+        line_num = 0;
+        command = "";
+}
+
+void Debug_Report::start_command(const size_t given_line_num, const std::string &given_command) {
+        line_num = given_line_num;
+        command = given_command;
+}
+
+void Debug_Report::put_start(const char *event) {
+        *stream << "{\"line\":" << line_num << ",\"command\":";
+        put_json_string(*stream, command);
+        *stream << ",\"event\":\"" << event << "\"";
+}
+
+void Debug_Report::put_state(const CPU_Handle &cpu_handle) {
+        const char *const REGISTER_NAMES[NUM_REGISTERS] = {
+                "RZ", "RA", "RB", "RC", "RD", "RE", "RF", "RG",
+                "RH", "RSP", "RIP", "CMP0", "CMP1"
+        };
+        const int16_t address = cpu_handle.get_prog_ctr();
+        *stream << ",\"address\":" << address << ",\"instruction\":";
+        put_json_string(*stream, instruction_text(cpu_handle, address));
+
+        *stream << ",\"registers\":{";
+        for (int i = 0; i < NUM_REGISTERS; ++i) {
+                *stream << (i == 0 ? "" : ",") << "\"" << REGISTER_NAMES[i] << "\":";
+                *stream << cpu_handle.read_register((int16_t)i);
+        }
+
+        // %0 first, the same order print reads them in
+        *stream << "},\"stack\":[";
+        const int16_t stack_ptr = cpu_handle.read_register(REG_RSP);
+        for (int16_t offset = 0; offset < stack_ptr && offset < STACK_SIZE; ++offset) {
+                *stream << (offset == 0 ? "" : ",");
+                *stream << cpu_handle.read_ram(STACK_START + stack_ptr - offset - 1);
+        }
+        *stream << "]";
+}
+
+void Debug_Report::put_stop(const CPU_Handle &cpu_handle, const char *reason, const int16_t watch_address) {
+        put_start("stop");
+        *stream << ",\"reason\":\"" << reason << "\"";
+        if (watch_address != -1) {
+                *stream << ",\"watch\":{\"address\":" << watch_address;
+                *stream << ",\"value\":" << cpu_handle.read_ram(watch_address) << "}";
+        }
+        put_state(cpu_handle);
+        *stream << "}\n";
+}
+
+void Debug_Report::put_value(CPU_Handle &cpu_handle, const std::string &operand_text) {
+        Decoded_Operand operand;
+        if (!parse_debug_operand(operand_text, operand)) {
+                put_error("expected a register, stack offset or ram address");
+                return;
+        }
+        int16_t value = 0;
+        try {
+                value = cpu_handle.dereference_value(operand);
+        } catch (const Runtime_Fault &fault) {
+                put_error(RUNTIME_ERROR_MESSAGES[fault.error_code]);
+                return;
+        }
+        put_start("value");
+        *stream << ",\"operand\":";
+        put_json_string(*stream, operand_text);
+        *stream << ",\"value\":" << value << "}\n";
+}
+
+void Debug_Report::put_error(const std::string &message) {
+        put_start("error");
+        *stream << ",\"message\":";
+        put_json_string(*stream, message);
+        *stream << "}\n";
+}
+
+void Debug_Report::put_end(const CPU_Handle &cpu_handle, const char *reason, const Runtime_Error_Enum error_code) {
+        put_start("end");
+        *stream << ",\"reason\":\"" << reason << "\"";
+        if (error_code != NO_RUNTIME_ERROR) {
+                *stream << ",\"error\":";
+                put_json_string(*stream, RUNTIME_ERROR_MESSAGES[error_code]);
+        }
+        put_state(cpu_handle);
+        *stream << "}\n";
+}
+
+bool Debug_Report::flush() {
+        stream->flush();
+        return !stream->fail();
+}
@@ -0,0 +1,90 @@
+#ifndef DEBUG_REPORT_H
+#define DEBUG_REPORT_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "cpu_handle.h"
+
+/**
+ * @brief writes the --debug-output file of a --debug-script session
+ * @details JSON lines: one object per line, so a report cut short by a
+ * killed run is still readable up to its last line. Every object has the
+ * script's "line" and "command" that caused it, and an "event":
+ *     "stop": next, continue or a reverse command stopped, with the
+ *     "reason" (step, breakpoint, watchpoint or reverse) and the state
+ *     "value": what print printed, as "operand" and "value"
+ *     "error": a command that couldn't be run, with a "message"
+ *     "end": the session ended, with the "reason" (exit, fault, quit or
+ *     script_end), the runtime "error" if it faulted, and the state
+ * the state is the "address" and "instruction" about to run, every
+ * register by name in "registers", and the stack from %0 down in "stack"
+ */
+class Debug_Report {
+        std::ostream *stream;
+        size_t line_num; /** of the script command being run */
+        std::string command; /** being run */
+
+        void put_start(const char *event);
+        void put_state(const CPU_Handle &cpu_handle);
+public:
+        explicit Debug_Report(std::ostream &given_stream);
+        void start_command(const size_t given_line_num, const std::string &given_command);
+        void put_stop(const CPU_Handle &cpu_handle, const char *reason, const int16_t watch_address);
+        void put_value(CPU_Handle &cpu_handle, const std::string &operand_text);
+        void put_error(const std::string &message);
+        void put_end(const CPU_Handle &cpu_handle, const char *reason, const Runtime_Error_Enum error_code);
+        bool flush();
+};
+
+/**
+ * @fn Debug_Report::Debug_Report(std::ostream &given_stream)
+ * @brief writes to given_stream, which has to outlive the report
+ */
+
+/**
+ * @fn void Debug_Report::start_command(const size_t given_line_num, const std::string &given_command)
+ * @brief the script command every object from now on is about
+ */
+
+/**
+ * @fn void Debug_Report::put_stop(const CPU_Handle &cpu_handle, const char *reason, const int16_t watch_address)
+ * @brief writes a stop, with the state of cpu_handle
+ * @details watch_address is the watchpoint that stopped it, included with
+ * its value, or -1
+ */
+
+/**
+ * @fn void Debug_Report::put_value(CPU_Handle &cpu_handle, const std::string &operand_text)
+ * @brief writes the value of a register, stack offset or ram address
+ * @details or an error, if operand_text isn't one, or can't be read
+ */
+
+/**
+ * @fn void Debug_Report::put_end(const CPU_Handle &cpu_handle, const char *reason, const Runtime_Error_Enum error_code)
+ * @brief writes the end of the session, with the state of cpu_handle
+ * @details error_code is NO_RUNTIME_ERROR unless the program faulted
+ */
+
+/**
+ * @fn bool Debug_Report::flush()
+ * @brief writes out whatever the stream buffered
+ * @details returns false if the stream has failed, so the report is
+ * incomplete
+ */
+
+/**
+ * @fn void Debug_Report::put_start(const char *event)
+ * @brief opens an object, with the line, command and event
+ * @details helper function of the put_* methods
+ */
+
+/**
+ * @fn void Debug_Report::put_state(const CPU_Handle &cpu_handle)
+ * @brief writes the address, instruction, registers and stack
+ * @details helper function of put_stop and put_end
+ */
+
+#endif
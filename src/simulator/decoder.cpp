@@ -0,0 +1,82 @@
+#include <cstdint>
+#include <vector>
+
+#include "../instruction_types.h"
+#include "decoder.h"
+
+Decoded_Operand decode_operand(const int16_t raw) {
+        Decoded_Operand operand;
+        int16_t addr_bits = (raw >> 12) & 7;
+        if ((raw >> 14) == 1 || raw < 0) {
+                // literal value
+                // set addr bits off for non-negative numbers
+                operand.kind = OPERAND_LITERAL;
+                operand.value = raw;
+                if (operand.value >= 0)
+                        operand.value ^= (int16_t)(4 << 12);
+        } else if (addr_bits == 1) {
+                operand.kind = OPERAND_STACK_OFFSET;
+                operand.value = raw ^ (int16_t)(1 << 12);
+        } else if (addr_bits == 2) {
+                operand.kind = OPERAND_RAM_ADDR;
+                operand.value = raw ^ (int16_t)(2 << 12);
+        } else if (addr_bits == 3) {
+                operand.kind = OPERAND_STR_ADDR;
+                operand.value = raw ^ (int16_t)(3 << 12);
+        } else {
+                // RZ through CMP1, see REGISTER_TABLE
+                operand.kind = (raw <= 12) ? OPERAND_REGISTER : OPERAND_BAD_REGISTER;
+                operand.value = raw;
+        }
+        return operand;
+}
+
+Decoded_Instruction decode_instruction(
+        const int16_t *program_data,
+        const int16_t prog_size,
+        const int16_t address
+) {
+        Decoded_Instruction decoded;
+        decoded.opcode = INVALID_OPCODE;
+        decoded.next_pc = address + 1;
+        decoded.args[0] = {OPERAND_NONE, 0};
+        decoded.args[1] = {OPERAND_NONE, 0};
+        decoded.fusion = FUSION_NONE;
+        decoded.proven = false;
+        decoded.base_handler = nullptr;
+        decoded.handler = nullptr;
+
+        int16_t opcode = program_data[address];
+        if (opcode < 0 || opcode >= NUM_OPCODES)
+                return decoded;
+        const Instruction_Data &blueprint = get_instruction(opcode);
+        // arguments can't be fetched past the end of the program
+        if (address + (int)blueprint.length > prog_size)
+                return decoded;
+
+        for (size_t arg_idx = 1; arg_idx < blueprint.length; ++arg_idx) {
+                int16_t raw = program_data[address + arg_idx];
+                if (blueprint.blueprint.at(arg_idx) == LABEL)
+                        decoded.args[arg_idx - 1] = {OPERAND_LABEL, raw};
+                else
+                        decoded.args[arg_idx - 1] = decode_operand(raw);
+        }
+        decoded.opcode = opcode;
+        decoded.next_pc = address + (int16_t)blueprint.length;
+        return decoded;
+}
+
+std::vector<Decoded_Instruction> decode_program(
+        const int16_t *program_data,
+        const int16_t prog_size
+) {
+        std::vector<Decoded_Instruction> decoded_program = {};
+        decoded_program.reserve(prog_size);
+        // decode every address, not just the ones reachable from main,
+        // so that a jump anywhere behaves the same as the raw program
+        for (int16_t address = 0; address < prog_size; ++address) {
+                Decoded_Instruction curr = decode_instruction(program_data, prog_size, address);
+                decoded_program.push_back(curr);
+        }
+        return decoded_program;
+}
@@ -0,0 +1,130 @@
+#ifndef DECODER_H
+#define DECODER_H 1
+
+#include <cstdint>
+#include <vector>
+
+#include "../instruction_types.h"
+
+/**
+ * @brief opcode given to addresses that don't hold a runnable instruction
+ * @details either an unknown opcode, or an instruction cut off by the end
+ * of the program
+ */
+const int16_t INVALID_OPCODE = NUM_OPCODES;
+
+class CPU_Handle;
+struct Decoded_Instruction;
+
+/**
+ * @brief common signature of every ins_* function
+ */
+typedef void (*Instruction_Handler)(
+        CPU_Handle &cpu_handle,
+        const Decoded_Instruction &ins
+);
+
+/**
+ * @brief sequences of instructions that can run as one step
+ * @details see fuse_program
+ */
+enum Fusion_Enum : uint8_t {
+        FUSION_NONE = 0,
+        FUSION_CMP_JUMP,      ///< CMP, then a conditional jump
+        FUSION_STEP_CMP_JUMP, ///< INC or DEC, then CMP, then a conditional jump
+        FUSION_PUSH_CALL,     ///< PUSH, then CALL
+        FUSION_RET_POP,       ///< RET that lands on a POP
+        NUM_FUSIONS,
+};
+
+/**
+ * @brief printable names of Fusion_Enum, for --fusion-stats
+ */
+const char *const FUSION_NAMES[NUM_FUSIONS] = {
+        "none",
+        "CMP+Jcc",
+        "INC/DEC+CMP+Jcc",
+        "PUSH+CALL",
+        "RET+POP",
+};
+
+/**
+ * @brief instructions each Fusion_Enum runs in one step
+ * @details FUSION_NONE is a single instruction. Used to count instructions
+ * for Run_Limits. RET+POP is only the RET, as the POP only runs when the
+ * RET lands on one, see CPU_Handle::count_landing_pop
+ */
+const uint8_t FUSION_LENGTHS[NUM_FUSIONS] = {1, 2, 3, 2, 1};
+
+/**
+ * @brief addressing mode of a decoded argument
+ */
+enum Operand_Kind : uint8_t {
+        OPERAND_NONE = 0,
+        OPERAND_REGISTER,     ///< value is the register idx, RZ through CMP1
+        OPERAND_BAD_REGISTER, ///< value is the raw idx, fails when read
+        OPERAND_LITERAL,      ///< value is the literal itself
+        OPERAND_STACK_OFFSET, ///< value is the offset from the top of the stack
+        OPERAND_RAM_ADDR,     ///< value is the RAM address
+        OPERAND_STR_ADDR,     ///< value is the program address of the string
+        OPERAND_LABEL,        ///< value is the program address to jump to
+};
+
+/**
+ * @brief argument of an instruction, with its addressing bits resolved
+ */
+struct Decoded_Operand {
+        Operand_Kind kind;
+        int16_t value;
+};
+
+/**
+ * @brief instruction with its arguments resolved ahead of time
+ * @details one is made for every program address, so jumps can index
+ * the decoded program with prog_ctr directly
+ */
+struct Decoded_Instruction {
+        int16_t opcode;  ///< INVALID_OPCODE if not runnable
+        int16_t next_pc; ///< address of the instruction that follows
+        Decoded_Operand args[2];
+        Fusion_Enum fusion;               ///< sequence handler runs, if any
+        bool proven;                      ///< set by verify_program
+        Instruction_Handler base_handler; ///< set by specialise_program
+        Instruction_Handler handler;      ///< set by fuse_program
+};
+
+/**
+ * @brief the bytes a SPRINT writes, decoded ahead of time
+ * @details offset and length are into Loaded_Program::string_bytes
+ */
+struct String_Span {
+        uint32_t offset;
+        uint32_t length;
+};
+
+/**
+ * @brief resolves the addressing bits of a single assembled argument
+ * @details same rules as the assembler bitmasks, see docs/abi.md
+ */
+Decoded_Operand decode_operand(const int16_t raw);
+
+/**
+ * @brief decodes the instruction that starts at address
+ * @details helper function of decode_program
+ */
+Decoded_Instruction decode_instruction(
+        const int16_t *program_data,
+        const int16_t prog_size,
+        const int16_t address
+);
+
+/**
+ * @brief decodes every address of an assembled program
+ * @details helper function of CPU_Handle::load_program
+ */
+std::vector<Decoded_Instruction> decode_program(
+        const int16_t *program_data,
+        const int16_t prog_size
+);
+
+#endif
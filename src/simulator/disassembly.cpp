@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../instruction_types.h"
+#include "cpu_handle.h"
+#include "disassembly.h"
+#include "pal_debugger.h"
+
+/**
+ * @brief the words of the instruction at address, cut off at the end of the program
+ * @details helper function of Disassembly
+ */
+static std::vector<int16_t> instruction_words(const CPU_Handle &cpu_handle, const int16_t address) {
+        int16_t opcode = cpu_handle.get_program_data(address);
+        int16_t ins_len = (int16_t)get_instruction(opcode).length;
+        std::vector<int16_t> instruction = {};
+        for (int16_t i = 0; i < ins_len && address + i < cpu_handle.get_prog_size(); ++i)
+                instruction.push_back(cpu_handle.get_program_data(address + i));
+        return instruction;
+}
+
+Disassembly::Disassembly(const CPU_Handle &given_cpu_handle, const std::map<int16_t, std::string> &given_symbols) {
+        cpu_handle = &given_cpu_handle;
+        symbols = given_symbols;
+        const int16_t prog_size = cpu_handle->get_prog_size();
+        line_idx.assign(prog_size, -1);
+
+        // instructions start after the 0xffff that ends the string data
+        int16_t address = 5; // SA, NT, IA, GO, main
+        while ((cpu_handle->get_program_data(address - 1) != (int16_t)0xffff) && (address < prog_size))
+                address++;
+        while (address < prog_size) {
+                std::vector<int16_t> instruction = instruction_words(*cpu_handle, address);
+                int16_t opcode = cpu_handle->get_program_data(address);
+                // an instruction cut off by the end of the program isn't one
+                if (instruction.size() != get_instruction(opcode).length)
+                        break;
+                line_idx[address] = (int32_t)lines.size();
+                addresses.push_back(address);
+                lines.push_back(disassemble_instruction(instruction, address, symbols));
+                address += (int16_t)instruction.size();
+        }
+}
+
+const std::vector<int16_t> &Disassembly::get_addresses() const {
+        return addresses;
+}
+
+std::string Disassembly::get_line(const int16_t address) const {
+        if (address >= 0 && (size_t)address < line_idx.size() && line_idx[address] != -1)
+                return lines[line_idx[address]];
+        if (address < 0 || address >= cpu_handle->get_prog_size())
+                return "#" + std::to_string(address) + ": outside the program";
+        std::vector<int16_t> instruction = instruction_words(*cpu_handle, address);
+        if (instruction.size() != get_instruction(instruction.at(0)).length)
+                return "#" + std::to_string(address) + ": cut off by the end of the program";
+        return disassemble_instruction(instruction, address, symbols);
+}
+
+size_t Disassembly::print_range(std::ostream &out, const int16_t first, const int16_t last) const {
+        auto start = std::lower_bound(addresses.begin(), addresses.end(), first);
+        auto curr = start;
+        for (; curr != addresses.end() && *curr <= last; ++curr) {
+                auto symbol = symbols.find(*curr);
+                if (symbol != symbols.end())
+                        out << symbol->second << ":\n";
+                out << lines[line_idx[*curr]] << "\n";
+        }
+        return (size_t)(curr - start);
+}
@@ -0,0 +1,60 @@
+#ifndef DISASSEMBLY_H
+#define DISASSEMBLY_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "cpu_handle.h"
+
+/**
+ * @brief every instruction of a program, disassembled once for the debugger
+ * @details lines are kept in address order, with an index per program
+ * address, so list, the line printed after every step, and a disassemble
+ * of any range cost a lookup instead of decoding the program again. With
+ * symbols, jumps and calls show the label they go to instead of its address
+ */
+class Disassembly {
+        std::vector<int16_t> addresses; /** of every instruction, ascending */
+        std::vector<std::string> lines; /** of every instruction, same order */
+        std::vector<int32_t> line_idx; /** per program address, into lines, -1 unless an instruction starts there */
+        std::map<int16_t, std::string> symbols; /** label name, by program address */
+        const CPU_Handle *cpu_handle; /** for addresses no instruction starts at */
+public:
+        Disassembly(const CPU_Handle &given_cpu_handle, const std::map<int16_t, std::string> &given_symbols);
+        const std::vector<int16_t> &get_addresses() const;
+        std::string get_line(const int16_t address) const;
+        size_t print_range(std::ostream &out, const int16_t first, const int16_t last) const;
+};
+
+/**
+ * @fn Disassembly::Disassembly(const CPU_Handle &given_cpu_handle, const std::map<int16_t, std::string> &given_symbols)
+ * @brief disassembles the program loaded in given_cpu_handle
+ * @details given_cpu_handle has to outlive the disassembly. given_symbols
+ * can be empty, as with a binary
+ */
+
+/**
+ * @fn const std::vector<int16_t> &Disassembly::get_addresses() const
+ * @brief the address of every instruction, ascending
+ * @details where breakpoints can go
+ */
+
+/**
+ * @fn std::string Disassembly::get_line(const int16_t address) const
+ * @brief the instruction at address, as disassemble_instruction prints it
+ * @details cached, unless no instruction starts at address, as after a
+ * jump into the middle of one
+ */
+
+/**
+ * @fn size_t Disassembly::print_range(std::ostream &out, const int16_t first, const int16_t last) const
+ * @brief prints every instruction from first to last, addresses included
+ * @details a label goes on its own line, before the instruction it names.
+ * Returns how many instructions were printed
+ */
+
+#endif
@@ -0,0 +1,141 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#include <vector>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "input_source.h"
+
+/**
+ * @brief the bytes of a file given to Input_Source::map_file
+ * @details unmapped once the last Input_Source reading it is gone.
+ * Windows builds read the file into memory instead
+ */
+struct Mapped_File {
+        const char *data;
+        size_t size;
+#ifdef _WIN32
+        std::vector<char> contents;
+#endif
+
+        Mapped_File() : data(nullptr), size(0) {}
+        ~Mapped_File() {
+#ifndef _WIN32
+                if (data != nullptr)
+                        munmap((void *)data, size);
+#endif
+        }
+        Mapped_File(const Mapped_File &other) = delete;
+        Mapped_File &operator=(const Mapped_File &other) = delete;
+};
+
+/**
+ * @brief maps the whole file at file_path, null if it can't be opened
+ * @details helper function of Input_Source::map_file
+ */
+static std::shared_ptr<const Mapped_File> open_mapped_file(const std::string &file_path) {
+        std::shared_ptr<Mapped_File> mapped = std::make_shared<Mapped_File>();
+#ifdef _WIN32
+        std::ifstream source_file(file_path, std::ios::binary);
+        if (source_file.fail())
+                return nullptr;
+        mapped->contents.assign(std::istreambuf_iterator<char>(source_file),
+                std::istreambuf_iterator<char>());
+        mapped->data = mapped->contents.data();
+        mapped->size = mapped->contents.size();
+#else
+        int file_desc = open(file_path.c_str(), O_RDONLY);
+        if (file_desc == -1)
+                return nullptr;
+        struct stat file_info;
+        if (fstat(file_desc, &file_info) == -1 || !S_ISREG(file_info.st_mode)) {
+                close(file_desc);
+                return nullptr;
+        }
+        // an empty file can't be mapped, and has nothing to read anyway
+        if (file_info.st_size > 0) {
+                void *data = mmap(nullptr, (size_t)file_info.st_size,
+                        PROT_READ, MAP_PRIVATE, file_desc, 0);
+                if (data == MAP_FAILED) {
+                        close(file_desc);
+                        return nullptr;
+                }
+                madvise(data, (size_t)file_info.st_size, MADV_SEQUENTIAL);
+                mapped->data = (const char *)data;
+                mapped->size = (size_t)file_info.st_size;
+        }
+        // the mapping stays valid without the descriptor
+        close(file_desc);
+#endif
+        return mapped;
+}
+
+Input_Source::Input_Source() {
+        stream = &std::cin;
+        line = "";
+        read_pos = 0;
+        format = INPUT_TEXT;
+}
+
+void Input_Source::set_stream(std::istream &given_stream) {
+        stream = &given_stream;
+        mapped.reset();
+        read_pos = 0;
+        format = INPUT_TEXT;
+}
+
+bool Input_Source::map_file(const std::string &file_path, const Input_Format given_format) {
+        std::shared_ptr<const Mapped_File> opened = open_mapped_file(file_path);
+        if (!opened)
+                return false;
+        mapped = opened;
+        read_pos = 0;
+        format = given_format;
+        return true;
+}
+
+Input_Format Input_Source::get_format() const {
+        return format;
+}
+
+bool Input_Source::is_mapped() const {
+        return (bool)mapped;
+}
+
+std::string_view Input_Source::next_line() {
+        if (!mapped) {
+                std::getline(*stream, line);
+                return line;
+        }
+        const char *start = mapped->data + read_pos;
+        const size_t left = mapped->size - read_pos;
+        if (left == 0)
+                return std::string_view();
+        const char *newline = (const char *)std::memchr(start, '\n', left);
+        size_t length = (newline == nullptr) ? left : (size_t)(newline - start);
+        // skip past the newline too, if there is one
+        read_pos += (newline == nullptr) ? length : length + 1;
+        return std::string_view(start, length);
+}
+
+bool Input_Source::next_word(int16_t &word) {
+        if (!mapped || mapped->size - read_pos < 2)
+                return false;
+        const unsigned char *bytes = (const unsigned char *)mapped->data + read_pos;
+        word = (int16_t)(bytes[0] | (bytes[1] << 8));
+        read_pos += 2;
+        return true;
+}
@@ -0,0 +1,80 @@
+#ifndef INPUT_SOURCE_H
+#define INPUT_SOURCE_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief how a mapped file is read by INPUT and SINPUT
+ */
+enum Input_Format {
+        INPUT_TEXT, ///< one value or string per line, same as stdin
+        INPUT_RAW,  ///< little endian int16_t words, one per value or character
+};
+
+struct Mapped_File;
+
+/**
+ * @brief where INPUT and SINPUT read from
+ * @details by default, lines of a stream (std::cin unless set_stream says
+ * otherwise). map_file reads a whole file through mmap instead, so the
+ * lines or words are taken straight out of memory without going through
+ * the stream
+ */
+class Input_Source {
+        std::istream *stream;
+        std::string line; /** last line read from stream */
+        std::shared_ptr<const Mapped_File> mapped; /** null unless map_file was called */
+        size_t read_pos; /** bytes of mapped read so far */
+        Input_Format format;
+public:
+        Input_Source();
+        void set_stream(std::istream &given_stream);
+        bool map_file(const std::string &file_path, const Input_Format given_format);
+        Input_Format get_format() const;
+        bool is_mapped() const;
+        std::string_view next_line();
+        bool next_word(int16_t &word);
+};
+
+/**
+ * @fn Input_Source::Input_Source()
+ * @brief reads text lines from std::cin
+ */
+
+/**
+ * @fn void Input_Source::set_stream(std::istream &given_stream)
+ * @brief reads text lines from given_stream, and drops any mapped file
+ */
+
+/**
+ * @fn bool Input_Source::map_file(const std::string &file_path, const Input_Format given_format)
+ * @brief reads from the file at file_path, in given_format
+ * @details the file is mapped once and read from the start. Copies of
+ * this Input_Source share the mapping, but each keeps its own position.
+ * Returns false, and changes nothing, if the file can't be opened
+ */
+
+/**
+ * @fn bool Input_Source::is_mapped() const
+ * @brief whether a file was mapped, rather than reading a stream
+ */
+
+/**
+ * @fn std::string_view Input_Source::next_line()
+ * @brief the next line, without its newline, same as std::getline
+ * @details empty once there's nothing left. Only valid until the next
+ * call. For INPUT_TEXT only
+ */
+
+/**
+ * @fn bool Input_Source::next_word(int16_t &word)
+ * @brief the next little endian word of a mapped file
+ * @details false once fewer than two bytes are left. For INPUT_RAW only
+ */
+
+#endif
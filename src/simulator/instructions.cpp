@@ -1,96 +1,433 @@
+#include <cctype>
+#include <charconv>
 #include <cstdint>
 #include <iostream>
 #include <map>
-#include <random>
 #include <string>
-#include <sstream>
+#include <string_view>
+#include <vector>
 
 #include "../common_values.h"
+#include "../instruction_types.h"
 #include "cpu_handle.h"
 #include "instructions.h"
 
 // note to self: maybe don't hardcode values that are easy to mess up?
 
-int16_t clamp(const int16_t value) {
-        if (value > LIT_MAX_VALUE)
-                return LIT_MAX_VALUE;
-        else if (value < LIT_MIN_VALUE)
-                return LIT_MIN_VALUE;
-        return value;
+// OPERAND_NONE as a template argument means the operand kind is only known
+// at runtime, see CPU_Handle::load_operand
+#define ANY OPERAND_NONE
+
+const Instruction_Handler INSTRUCTION_HANDLERS[NUM_OPCODES + 1] = {
+        ins_nop,
+        ins_mov<ANY>,
+        ins_inc<ANY>,
+        ins_dec<ANY>,
+        ins_add<ANY, ANY>,
+        ins_sub<ANY, ANY>,
+        ins_mul<ANY, ANY>,
+        ins_div<ANY, ANY>,
+        ins_mod<ANY, ANY>,
+        ins_and<ANY, ANY>,
+        ins_or<ANY, ANY>,
+        ins_not<ANY>,
+        ins_xor<ANY, ANY>,
+        ins_lsh<ANY, ANY>,
+        ins_rsh<ANY, ANY>,
+        ins_cmp<ANY, ANY>,
+        ins_jmp,   ins_jeq,    ins_jne,    ins_jge,
+        ins_jgr,   ins_jle,    ins_jls,    ins_call,
+        ins_ret,
+        ins_push<ANY>,
+        ins_pop,
+        ins_write<ANY, ANY>,
+        ins_read<ANY>,
+        ins_print<ANY>,
+        ins_sprint<ANY>,
+        ins_cprint<ANY>,
+        ins_input, ins_sinput, ins_rand,   ins_exit,
+        ins_invalid, // INVALID_OPCODE
+};
+
+/**
+ * @brief gets the register idx to pass to update_register
+ * @details destinations that aren't registers get an idx update_register
+ * refuses, same as their raw value would have been
+ */
+static int16_t dest_index(const Decoded_Operand &operand) {
+        if (operand.kind == OPERAND_REGISTER || operand.kind == OPERAND_BAD_REGISTER)
+                return operand.value;
+        return -1;
+}
+
+// specialised handlers, see specialise_program
+// the tables below are indexed by kind_slot, in this order
+#define KIND_LIST(handler, ...) {                                              \
+        handler<__VA_ARGS__ ANY>,                                              \
+        handler<__VA_ARGS__ OPERAND_REGISTER>,                                 \
+        handler<__VA_ARGS__ OPERAND_LITERAL>,                                  \
+        handler<__VA_ARGS__ OPERAND_STACK_OFFSET>,                             \
+        handler<__VA_ARGS__ OPERAND_RAM_ADDR>,                                 \
+}
+#define NUM_KIND_SLOTS 5
+
+// first operand is a register destination, so only two kinds are worth it
+#define DEST_KIND_LIST(handler) {                                              \
+        KIND_LIST(handler, ANY,),                                              \
+        KIND_LIST(handler, OPERAND_REGISTER,),                                 \
+}
+
+#define TWO_KIND_LIST(handler) {                                               \
+        KIND_LIST(handler, ANY,),                                              \
+        KIND_LIST(handler, OPERAND_REGISTER,),                                 \
+        KIND_LIST(handler, OPERAND_LITERAL,),                                  \
+        KIND_LIST(handler, OPERAND_STACK_OFFSET,),                             \
+        KIND_LIST(handler, OPERAND_RAM_ADDR,),                                 \
+}
+
+static const Instruction_Handler MOV_HANDLERS[NUM_KIND_SLOTS]    = KIND_LIST(ins_mov);
+static const Instruction_Handler NOT_HANDLERS[NUM_KIND_SLOTS]    = KIND_LIST(ins_not);
+static const Instruction_Handler INC_HANDLERS[NUM_KIND_SLOTS]    = KIND_LIST(ins_inc);
+static const Instruction_Handler DEC_HANDLERS[NUM_KIND_SLOTS]    = KIND_LIST(ins_dec);
+static const Instruction_Handler PUSH_HANDLERS[NUM_KIND_SLOTS]   = KIND_LIST(ins_push);
+static const Instruction_Handler READ_HANDLERS[NUM_KIND_SLOTS]   = KIND_LIST(ins_read);
+static const Instruction_Handler PRINT_HANDLERS[NUM_KIND_SLOTS]  = KIND_LIST(ins_print);
+static const Instruction_Handler CPRINT_HANDLERS[NUM_KIND_SLOTS] = KIND_LIST(ins_cprint);
+
+static const Instruction_Handler CMP_HANDLERS[NUM_KIND_SLOTS][NUM_KIND_SLOTS]   = TWO_KIND_LIST(ins_cmp);
+static const Instruction_Handler WRITE_HANDLERS[NUM_KIND_SLOTS][NUM_KIND_SLOTS] = TWO_KIND_LIST(ins_write);
+
+// ADD through RSH, indexed by opcode - OP_ADD. NOT has its own table
+static const Instruction_Handler ARITHMETIC_HANDLERS[OP_RSH - OP_ADD + 1][2][NUM_KIND_SLOTS] = {
+        DEST_KIND_LIST(ins_add), DEST_KIND_LIST(ins_sub), DEST_KIND_LIST(ins_mul),
+        DEST_KIND_LIST(ins_div), DEST_KIND_LIST(ins_mod), DEST_KIND_LIST(ins_and),
+        DEST_KIND_LIST(ins_or),  {},                      DEST_KIND_LIST(ins_xor),
+        DEST_KIND_LIST(ins_lsh), DEST_KIND_LIST(ins_rsh),
+};
+
+#undef TWO_KIND_LIST
+#undef DEST_KIND_LIST
+#undef KIND_LIST
+
+/**
+ * @brief gets the idx of the handler specialised for operand's kind
+ * @details helper function of specialise_program. Kinds that always fail,
+ * and RAM addresses outside the RAM, get the runtime checked handler
+ */
+static int kind_slot(const Decoded_Operand &operand) {
+        switch (operand.kind) {
+        case OPERAND_REGISTER:
+                return 1;
+        case OPERAND_LITERAL:
+        case OPERAND_STR_ADDR:
+        case OPERAND_LABEL:
+                return 2;
+        case OPERAND_STACK_OFFSET:
+                return 3;
+        case OPERAND_RAM_ADDR:
+                if (operand.value >= 0 && operand.value < STACK_START)
+                        return 4;
+                return 0;
+        default:
+                return 0;
+        }
+}
+
+void specialise_program(std::vector<Decoded_Instruction> &decoded_program) {
+        for (Decoded_Instruction &ins : decoded_program) {
+                int first = kind_slot(ins.args[0]);
+                int second = kind_slot(ins.args[1]);
+                int dest = (first == 1) ? 1 : 0;
+                switch (ins.opcode) {
+                case OP_MOV:    ins.base_handler = MOV_HANDLERS[second];    break;
+                case OP_NOT:    ins.base_handler = NOT_HANDLERS[second];    break;
+                case OP_INC:    ins.base_handler = INC_HANDLERS[first];     break;
+                case OP_DEC:    ins.base_handler = DEC_HANDLERS[first];     break;
+                case OP_PUSH:   ins.base_handler = PUSH_HANDLERS[first];    break;
+                case OP_READ:   ins.base_handler = READ_HANDLERS[second];   break;
+                case OP_PRINT:  ins.base_handler = PRINT_HANDLERS[first];   break;
+                case OP_CPRINT: ins.base_handler = CPRINT_HANDLERS[first];  break;
+                case OP_SPRINT:
+                        if (ins.proven)
+                                ins.base_handler = ins_sprint<OPERAND_STR_ADDR>;
+                        else
+                                ins.base_handler = ins_sprint<ANY>;
+                        break;
+                case OP_CMP:    ins.base_handler = CMP_HANDLERS[first][second];   break;
+                case OP_WRITE:  ins.base_handler = WRITE_HANDLERS[first][second]; break;
+                case OP_ADD:
+                case OP_SUB:
+                case OP_MUL:
+                case OP_DIV:
+                case OP_MOD:
+                case OP_AND:
+                case OP_OR:
+                case OP_XOR:
+                case OP_LSH:
+                case OP_RSH:
+                        ins.base_handler = ARITHMETIC_HANDLERS[ins.opcode - OP_ADD][dest][second];
+                        break;
+                default:
+                        ins.base_handler = INSTRUCTION_HANDLERS[ins.opcode];
+                        break;
+                }
+        }
+}
+
+// SPRINT strings that spell out one of these are written as the escape
+// code itself
+static const std::map<std::string, std::string> ANSI_CODE_MAP = {
+        {"\\x1b[0m",  "\x1b[0m"},  // clear
+        {"\\x1b[30m", "\x1b[30m"}, // black   fg
+        {"\\x1b[31m", "\x1b[31m"}, // red     fg
+        {"\\x1b[32m", "\x1b[32m"}, // green   fg
+        {"\\x1b[33m", "\x1b[33m"}, // yellow  fg
+        {"\\x1b[34m", "\x1b[34m"}, // blue    fg
+        {"\\x1b[35m", "\x1b[35m"}, // magenta fg
+        {"\\x1b[36m", "\x1b[36m"}, // cyan    fg
+        {"\\x1b[37m", "\x1b[37m"}, // white   fg
+        {"\\x1b[40m", "\x1b[40m"}, // black   bg
+        {"\\x1b[41m", "\x1b[41m"}, // red     bg
+        {"\\x1b[42m", "\x1b[42m"}, // green   bg
+        {"\\x1b[43m", "\x1b[43m"}, // yellow  bg
+        {"\\x1b[44m", "\x1b[44m"}, // blue    bg
+        {"\\x1b[45m", "\x1b[45m"}, // magenta bg
+        {"\\x1b[46m", "\x1b[46m"}, // cyan    bg
+        {"\\x1b[47m", "\x1b[47m"}, // white   bg
+};
+
+/**
+ * @brief appends the characters packed in word, low byte first
+ * @details the high byte is skipped if it's zero, so that \x1b[0m gets
+ * matched correctly. helper function of decode_strings and ins_sprint
+ */
+static void unpack_word(std::string &output, const int16_t word) {
+        output += (char)(word & 255);
+        char higher = (char)(word >> 8);
+        if (higher != 0)
+                output += higher;
+}
+
+/**
+ * @brief replaces output with its ANSI escape code, if it spells one out
+ * @details helper function of decode_strings and ins_sprint
+ */
+static void resolve_ansi_code(std::string &output) {
+        std::map<std::string, std::string>::const_iterator found = ANSI_CODE_MAP.find(output);
+        if (found != ANSI_CODE_MAP.end())
+                output = found->second;
+}
+
+void decode_strings(
+        const int16_t *program_data,
+        const int16_t prog_size,
+        const std::vector<Decoded_Instruction> &decoded_program,
+        std::string &string_bytes,
+        std::vector<String_Span> &string_spans
+) {
+        string_bytes.clear();
+        string_spans.assign(prog_size, String_Span{0, 0});
+        std::vector<bool> is_decoded(prog_size, false);
+        for (const Decoded_Instruction &ins : decoded_program) {
+                if (ins.opcode != OP_SPRINT || !ins.proven)
+                        continue;
+                // proven, so the string is terminated inside the program
+                int16_t str_addr = ins.args[0].value;
+                if (is_decoded[str_addr])
+                        continue;
+                std::string output;
+                for (int16_t idx = str_addr; program_data[idx] != 0; ++idx)
+                        unpack_word(output, program_data[idx]);
+                resolve_ansi_code(output);
+                string_spans[str_addr].offset = (uint32_t)string_bytes.size();
+                string_spans[str_addr].length = (uint32_t)output.size();
+                string_bytes += output;
+                is_decoded[str_addr] = true;
+        }
+}
+
+// fused handlers, see fuse_program
+// each one calls the base handlers of its sequence in order, so registers,
+// prog_ctr and runtime errors come out the same as running them one by one
+
+template <Instruction_Handler JUMP>
+static void ins_cmp_jump(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        ins.base_handler(cpu_handle, ins);
+        JUMP(cpu_handle, cpu_handle.current_instruction());
+        cpu_handle.count_fusion(FUSION_CMP_JUMP);
 }
 
-void ins_nop(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        prog_ctr += 1;
+template <Instruction_Handler JUMP>
+static void ins_step_cmp_jump(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        ins.base_handler(cpu_handle, ins);
+        const Decoded_Instruction &cmp = cpu_handle.current_instruction();
+        cmp.base_handler(cpu_handle, cmp);
+        JUMP(cpu_handle, cpu_handle.current_instruction());
+        cpu_handle.count_fusion(FUSION_STEP_CMP_JUMP);
 }
 
-void ins_mov(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t dest = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t raw_2 = cpu_handle.get_program_data(prog_ctr + 2);
-        int16_t value = cpu_handle.dereference_value(raw_2);
+static void ins_push_call(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        ins.base_handler(cpu_handle, ins);
+        ins_call(cpu_handle, cpu_handle.current_instruction());
+        cpu_handle.count_fusion(FUSION_PUSH_CALL);
+}
+
+static void ins_ret_pop(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        ins_ret(cpu_handle, ins);
+        // return addresses are only ever made by CALL, so never negative
+        if (cpu_handle.get_prog_ctr() >= cpu_handle.get_prog_size())
+                return;
+        const Decoded_Instruction &landing = cpu_handle.current_instruction();
+        if (landing.opcode == OP_POP) {
+                ins_pop(cpu_handle, landing);
+                cpu_handle.count_landing_pop();
+        }
+}
+
+// fused handlers indexed by conditional jump, starting at OP_JEQ
+static const Instruction_Handler CMP_JUMP_HANDLERS[6] = {
+        ins_cmp_jump<ins_jeq>, ins_cmp_jump<ins_jne>, ins_cmp_jump<ins_jge>,
+        ins_cmp_jump<ins_jgr>, ins_cmp_jump<ins_jle>, ins_cmp_jump<ins_jls>,
+};
+
+static const Instruction_Handler STEP_CMP_JUMP_HANDLERS[6] = {
+        ins_step_cmp_jump<ins_jeq>, ins_step_cmp_jump<ins_jne>,
+        ins_step_cmp_jump<ins_jge>, ins_step_cmp_jump<ins_jgr>,
+        ins_step_cmp_jump<ins_jle>, ins_step_cmp_jump<ins_jls>,
+};
+
+/**
+ * @brief gets the opcode of the instruction after ins
+ * @details helper function of fuse_program
+ */
+static int16_t opcode_after(
+        const std::vector<Decoded_Instruction> &decoded_program,
+        const Decoded_Instruction &ins
+) {
+        if (ins.next_pc >= (int16_t)decoded_program.size())
+                return INVALID_OPCODE;
+        return decoded_program[ins.next_pc].opcode;
+}
+
+static bool is_conditional_jump(const int16_t opcode) {
+        return opcode >= OP_JEQ && opcode <= OP_JLS;
+}
+
+void fuse_program(std::vector<Decoded_Instruction> &decoded_program) {
+        // every address is decoded, so a jump into the middle of a fused
+        // sequence just runs the record at that address instead
+        for (Decoded_Instruction &ins : decoded_program) {
+                ins.handler = ins.base_handler;
+                ins.fusion = FUSION_NONE;
+                int16_t second = opcode_after(decoded_program, ins);
+                int16_t third = INVALID_OPCODE;
+                if (second != INVALID_OPCODE)
+                        third = opcode_after(decoded_program, decoded_program[ins.next_pc]);
+
+                switch (ins.opcode) {
+                case OP_CMP:
+                        if (is_conditional_jump(second)) {
+                                ins.handler = CMP_JUMP_HANDLERS[second - OP_JEQ];
+                                ins.fusion = FUSION_CMP_JUMP;
+                        }
+                        break;
+                case OP_INC:
+                case OP_DEC:
+                        if (second == OP_CMP && is_conditional_jump(third)) {
+                                ins.handler = STEP_CMP_JUMP_HANDLERS[third - OP_JEQ];
+                                ins.fusion = FUSION_STEP_CMP_JUMP;
+                        }
+                        break;
+                case OP_PUSH:
+                        if (second == OP_CALL) {
+                                ins.handler = ins_push_call;
+                                ins.fusion = FUSION_PUSH_CALL;
+                        }
+                        break;
+                case OP_RET:
+                        // where RET lands is only known at runtime
+                        ins.handler = ins_ret_pop;
+                        ins.fusion = FUSION_RET_POP;
+                        break;
+                default:
+                        break;
+                }
+        }
+}
+
+#undef ANY
+
+void ins_nop(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        prog_ctr = ins.next_pc;
+}
+
+template <Operand_Kind SRC_KIND>
+void ins_mov(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t dest = dest_index(ins.args[0]);
+        int16_t value = cpu_handle.load_operand<SRC_KIND>(ins.args[1]);
         update_register(cpu_handle, dest, value);
-        prog_ctr += 3;
+        prog_ctr = ins.next_pc;
 }
 
-void ins_inc(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t dest = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t value = cpu_handle.dereference_value(dest) + 1;
+template <Operand_Kind DEST_KIND>
+void ins_inc(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t dest = dest_index(ins.args[0]);
+        int16_t value = cpu_handle.load_operand<DEST_KIND>(ins.args[0]) + 1;
         // simulate wrap around
         if (value == LIT_MAX_VALUE + 1) {
                 value = LIT_MIN_VALUE;
         }
         update_register(cpu_handle, dest, value);
 
-        prog_ctr += 2;
+        prog_ctr = ins.next_pc;
 }
 
-void ins_dec(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t dest = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t value = cpu_handle.dereference_value(dest) - 1;
+template <Operand_Kind DEST_KIND>
+void ins_dec(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t dest = dest_index(ins.args[0]);
+        int16_t value = cpu_handle.load_operand<DEST_KIND>(ins.args[0]) - 1;
         // simulate wrap around
         if (value == LIT_MIN_VALUE - 1) {
                 value = LIT_MAX_VALUE;
         }
         update_register(cpu_handle, dest, value);
 
-        prog_ctr += 2;
+        prog_ctr = ins.next_pc;
 }
 
-void ins_add(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t dest = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t raw_2 = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t raw_3 = cpu_handle.get_program_data(prog_ctr + 2);
-        int16_t src_1 = cpu_handle.dereference_value(raw_2);
-        int16_t src_2 = cpu_handle.dereference_value(raw_3);
+template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+void ins_add(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t dest = dest_index(ins.args[0]);
+        int16_t src_1 = cpu_handle.load_operand<DEST_KIND>(ins.args[0]);
+        int16_t src_2 = cpu_handle.load_operand<SRC_KIND>(ins.args[1]);
         int16_t value = src_1 + src_2;
         update_register(cpu_handle, dest, value);
 
-        prog_ctr += 3;
+        prog_ctr = ins.next_pc;
 }
 
-void ins_sub(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t dest = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t raw_2 = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t raw_3 = cpu_handle.get_program_data(prog_ctr + 2);
-        int16_t src_1 = cpu_handle.dereference_value(raw_2);
-        int16_t src_2 = cpu_handle.dereference_value(raw_3);
+template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+void ins_sub(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t dest = dest_index(ins.args[0]);
+        int16_t src_1 = cpu_handle.load_operand<DEST_KIND>(ins.args[0]);
+        int16_t src_2 = cpu_handle.load_operand<SRC_KIND>(ins.args[1]);
         int16_t value = src_1 - src_2;
         update_register(cpu_handle, dest, value);
-        prog_ctr += 3;
+        prog_ctr = ins.next_pc;
 }
 
-void ins_mul(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t dest = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t raw_2 = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t raw_3 = cpu_handle.get_program_data(prog_ctr + 2);
-        int16_t src_1 = cpu_handle.dereference_value(raw_2);
-        int16_t src_2 = cpu_handle.dereference_value(raw_3);
+template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+void ins_mul(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t dest = dest_index(ins.args[0]);
+        int16_t src_1 = cpu_handle.load_operand<DEST_KIND>(ins.args[0]);
+        int16_t src_2 = cpu_handle.load_operand<SRC_KIND>(ins.args[1]);
         // ensure 16 bit overflow keeps the right sign before clamp
         bool expected_positive = (src_1 >= 0) == (src_2 >= 0);
         int32_t raw_value = src_1 * src_2;
@@ -105,222 +442,217 @@ void ins_mul(CPU_Handle &cpu_handle) {
                 raw_value = LIT_MIN_VALUE;
         int16_t value = (int16_t)raw_value;
         update_register(cpu_handle, dest, value);
-        prog_ctr += 3;
+        prog_ctr = ins.next_pc;
 }
 
-void ins_div(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t dest = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t raw_2 = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t raw_3 = cpu_handle.get_program_data(prog_ctr + 2);
-        int16_t src_1 = cpu_handle.dereference_value(raw_2);
-        int16_t src_2 = cpu_handle.dereference_value(raw_3);
+template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+void ins_div(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t dest = dest_index(ins.args[0]);
+        int16_t src_1 = cpu_handle.load_operand<DEST_KIND>(ins.args[0]);
+        int16_t src_2 = cpu_handle.load_operand<SRC_KIND>(ins.args[1]);
         if (src_2 == 0) {
-                std::cout << "Warning: Division by Zero. Result will be 0\n";
+                const char warning[] = "Warning: Division by Zero. Result will be 0\n";
+                cpu_handle.output.put_string(warning, sizeof(warning) - 1);
         }
         src_1 = (src_2 != 0 ? src_1 : (int16_t)0);
         src_2 = (src_2 != 0 ? src_2 : (int16_t)1);
         int16_t value = src_1 / src_2;
         update_register(cpu_handle, dest, value);
 
-        prog_ctr += 3;
+        prog_ctr = ins.next_pc;
 }
 
-void ins_mod(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t dest = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t raw_2 = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t raw_3 = cpu_handle.get_program_data(prog_ctr + 2);
-        int16_t src_1 = cpu_handle.dereference_value(raw_2);
-        int16_t src_2 = cpu_handle.dereference_value(raw_3);
+template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+void ins_mod(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t dest = dest_index(ins.args[0]);
+        int16_t src_1 = cpu_handle.load_operand<DEST_KIND>(ins.args[0]);
+        int16_t src_2 = cpu_handle.load_operand<SRC_KIND>(ins.args[1]);
         if (src_2 == 0) {
-                std::cout << "Warning: Mod by Zero. Result will be 0\n";
+                const char warning[] = "Warning: Mod by Zero. Result will be 0\n";
+                cpu_handle.output.put_string(warning, sizeof(warning) - 1);
         }
         src_1 = (src_2 != 0 ? src_1 : (int16_t)0);
         src_2 = (src_2 != 0 ? src_2 : (int16_t)1);
         int16_t value = src_1 % src_2;
         update_register(cpu_handle, dest, value);
 
-        prog_ctr += 3;
+        prog_ctr = ins.next_pc;
 }
 
-void ins_and(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t dest = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t raw_2 = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t raw_3 = cpu_handle.get_program_data(prog_ctr + 2);
-        int16_t src_1 = cpu_handle.dereference_value(raw_2);
-        int16_t src_2 = cpu_handle.dereference_value(raw_3);
+template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+void ins_and(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t dest = dest_index(ins.args[0]);
+        int16_t src_1 = cpu_handle.load_operand<DEST_KIND>(ins.args[0]);
+        int16_t src_2 = cpu_handle.load_operand<SRC_KIND>(ins.args[1]);
         int16_t value = src_1 & src_2;
         update_register(cpu_handle, dest, value);
 
-        prog_ctr += 3;
+        prog_ctr = ins.next_pc;
 }
 
-void ins_or(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t dest = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t raw_2 = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t raw_3 = cpu_handle.get_program_data(prog_ctr + 2);
-        int16_t src_1 = cpu_handle.dereference_value(raw_2);
-        int16_t src_2 = cpu_handle.dereference_value(raw_3);
+template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+void ins_or(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t dest = dest_index(ins.args[0]);
+        int16_t src_1 = cpu_handle.load_operand<DEST_KIND>(ins.args[0]);
+        int16_t src_2 = cpu_handle.load_operand<SRC_KIND>(ins.args[1]);
         int16_t value = src_1 | src_2;
         update_register(cpu_handle, dest, value);
-        prog_ctr += 3;
+        prog_ctr = ins.next_pc;
 }
 
-void ins_not(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t dest = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t raw_2 = cpu_handle.dereference_value(prog_ctr + 2);
-        int16_t src_1 = cpu_handle.dereference_value(raw_2);
+template <Operand_Kind SRC_KIND>
+void ins_not(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t dest = dest_index(ins.args[0]);
+        int16_t src_1 = cpu_handle.load_operand<SRC_KIND>(ins.args[1]);
         int16_t value = ~src_1;
         update_register(cpu_handle, dest, value);
-        prog_ctr += 3;
+        prog_ctr = ins.next_pc;
 }
 
-void ins_xor(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t dest = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t raw_2 = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t raw_3 = cpu_handle.get_program_data(prog_ctr + 2);
-        int16_t src_1 = cpu_handle.dereference_value(raw_2);
-        int16_t src_2 = cpu_handle.dereference_value(raw_3);
+template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+void ins_xor(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t dest = dest_index(ins.args[0]);
+        int16_t src_1 = cpu_handle.load_operand<DEST_KIND>(ins.args[0]);
+        int16_t src_2 = cpu_handle.load_operand<SRC_KIND>(ins.args[1]);
         int16_t value = src_1 ^ src_2;
         update_register(cpu_handle, dest, value);
-        prog_ctr += 3;
+        prog_ctr = ins.next_pc;
 }
 
-void ins_lsh(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t dest = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t raw_2 = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t raw_3 = cpu_handle.get_program_data(prog_ctr + 2);
-        int16_t src_1 = cpu_handle.dereference_value(raw_2);
-        int16_t src_2 = cpu_handle.dereference_value(raw_3);
+template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+void ins_lsh(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t dest = dest_index(ins.args[0]);
+        int16_t src_1 = cpu_handle.load_operand<DEST_KIND>(ins.args[0]);
+        int16_t src_2 = cpu_handle.load_operand<SRC_KIND>(ins.args[1]);
         if (src_2 < 0) {
-                std::cout << "Warning: Negative Bitshift. Result will be src 1\n";
+                const char warning[] = "Warning: Negative Bitshift. Result will be src 1\n";
+                cpu_handle.output.put_string(warning, sizeof(warning) - 1);
         }
 
         int16_t value = src_1 << (src_2 < 0 ? 0 : src_2);
         update_register(cpu_handle, dest, value);
 
-        prog_ctr += 3;
+        prog_ctr = ins.next_pc;
 }
 
-void ins_rsh(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
+template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+void ins_rsh(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
 
-        int16_t dest = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t raw_2 = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t raw_3 = cpu_handle.get_program_data(prog_ctr + 2);
-        int16_t src_1 = cpu_handle.dereference_value(raw_2);
-        int16_t src_2 = cpu_handle.dereference_value(raw_3);
-        if (src_2 < 0)
-                std::cout << "Warning: Negative Bitshift. Result will be src 1\n";
+        int16_t dest = dest_index(ins.args[0]);
+        int16_t src_1 = cpu_handle.load_operand<DEST_KIND>(ins.args[0]);
+        int16_t src_2 = cpu_handle.load_operand<SRC_KIND>(ins.args[1]);
+        if (src_2 < 0) {
+                const char warning[] = "Warning: Negative Bitshift. Result will be src 1\n";
+                cpu_handle.output.put_string(warning, sizeof(warning) - 1);
+        }
         int16_t value = src_1 >> (src_2 > 0 ? src_2 : 0);
         update_register(cpu_handle, dest, value);
-        prog_ctr += 3;
+        prog_ctr = ins.next_pc;
 }
 
-void ins_cmp(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t &reg_cmp_a = cpu_handle.reg_cmp_a;
-        int16_t &reg_cmp_b = cpu_handle.reg_cmp_b;
+template <Operand_Kind SRC_1_KIND, Operand_Kind SRC_2_KIND>
+void ins_cmp(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t &reg_cmp_a = cpu_handle.registers[REG_CMP0];
+        int16_t &reg_cmp_b = cpu_handle.registers[REG_CMP1];
 
-        int16_t raw = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t raw_2 = cpu_handle.get_program_data(prog_ctr + 2);
-        int16_t src_1 = cpu_handle.dereference_value(raw);
-        int16_t src_2 = cpu_handle.dereference_value(raw_2);
+        int16_t src_1 = cpu_handle.load_operand<SRC_1_KIND>(ins.args[0]);
+        int16_t src_2 = cpu_handle.load_operand<SRC_2_KIND>(ins.args[1]);
         src_1 = clamp(src_1);
         src_2 = clamp(src_2);
         reg_cmp_a = src_1;
         reg_cmp_b = src_2;
 
-        prog_ctr += 3;
+        prog_ctr = ins.next_pc;
 }
 
-void ins_jmp(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t new_address = cpu_handle.get_program_data(prog_ctr + 1);
+void ins_jmp(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t new_address = ins.args[0].value;
         prog_ctr = new_address;
-        // always jumps, so INSTRUCTION_LENS[16] unneeded
 }
 
-void ins_jeq(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t &reg_cmp_a = cpu_handle.reg_cmp_a;
-        int16_t &reg_cmp_b = cpu_handle.reg_cmp_b;
-        int16_t new_address = cpu_handle.get_program_data(prog_ctr + 1);
+void ins_jeq(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t &reg_cmp_a = cpu_handle.registers[REG_CMP0];
+        int16_t &reg_cmp_b = cpu_handle.registers[REG_CMP1];
+        int16_t new_address = ins.args[0].value;
         if (reg_cmp_a == reg_cmp_b)
                 prog_ctr = new_address;
         else
-                prog_ctr += 2;
+                prog_ctr = ins.next_pc;
 }
 
-void ins_jne(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t &reg_cmp_a = cpu_handle.reg_cmp_a;
-        int16_t &reg_cmp_b = cpu_handle.reg_cmp_b;
-        int16_t new_address = cpu_handle.get_program_data(prog_ctr + 1);
+void ins_jne(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t &reg_cmp_a = cpu_handle.registers[REG_CMP0];
+        int16_t &reg_cmp_b = cpu_handle.registers[REG_CMP1];
+        int16_t new_address = ins.args[0].value;
         if (reg_cmp_a != reg_cmp_b)
                 prog_ctr = new_address;
         else
-                prog_ctr += 2;
+                prog_ctr = ins.next_pc;
 }
 
-void ins_jge(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t &reg_cmp_a = cpu_handle.reg_cmp_a;
-        int16_t &reg_cmp_b = cpu_handle.reg_cmp_b;
-        int16_t new_address = cpu_handle.get_program_data(prog_ctr + 1);
+void ins_jge(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t &reg_cmp_a = cpu_handle.registers[REG_CMP0];
+        int16_t &reg_cmp_b = cpu_handle.registers[REG_CMP1];
+        int16_t new_address = ins.args[0].value;
         if (reg_cmp_a >= reg_cmp_b)
                 prog_ctr = new_address;
         else
-                prog_ctr += 2;
+                prog_ctr = ins.next_pc;
 }
 
-void ins_jgr(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t &reg_cmp_a = cpu_handle.reg_cmp_a;
-        int16_t &reg_cmp_b = cpu_handle.reg_cmp_b;
-        int16_t new_address = cpu_handle.get_program_data(prog_ctr + 1);
+void ins_jgr(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t &reg_cmp_a = cpu_handle.registers[REG_CMP0];
+        int16_t &reg_cmp_b = cpu_handle.registers[REG_CMP1];
+        int16_t new_address = ins.args[0].value;
         if (reg_cmp_a >  reg_cmp_b)
                 prog_ctr = new_address;
         else
-                prog_ctr += 2;
+                prog_ctr = ins.next_pc;
 }
 
-void ins_jle(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t &reg_cmp_a = cpu_handle.reg_cmp_a;
-        int16_t &reg_cmp_b = cpu_handle.reg_cmp_b;
-        int16_t new_address = cpu_handle.get_program_data(prog_ctr + 1);
+void ins_jle(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t &reg_cmp_a = cpu_handle.registers[REG_CMP0];
+        int16_t &reg_cmp_b = cpu_handle.registers[REG_CMP1];
+        int16_t new_address = ins.args[0].value;
         if (reg_cmp_a <= reg_cmp_b)
                 prog_ctr = new_address;
         else
-                prog_ctr += 2;
+                prog_ctr = ins.next_pc;
 }
 
-void ins_jls(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t &reg_cmp_a = cpu_handle.reg_cmp_a;
-        int16_t &reg_cmp_b = cpu_handle.reg_cmp_b;
-        int16_t new_address = cpu_handle.get_program_data(prog_ctr + 1);
+void ins_jls(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t &reg_cmp_a = cpu_handle.registers[REG_CMP0];
+        int16_t &reg_cmp_b = cpu_handle.registers[REG_CMP1];
+        int16_t new_address = ins.args[0].value;
         if (reg_cmp_a < reg_cmp_b)
                 prog_ctr = new_address;
         else
-                prog_ctr += 2;
+                prog_ctr = ins.next_pc;
 }
 
-void ins_call(CPU_Handle &cpu_handle) {
+void ins_call(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
         // points to next instruction, not current
-        int16_t *call_stack = cpu_handle.call_stack;
         int16_t &call_stack_ptr = cpu_handle.call_stack_ptr;
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t new_address = cpu_handle.get_program_data(prog_ctr + 1);
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t new_address = ins.args[0].value;
         if (call_stack_ptr < CALL_STACK_SIZE) {
-                call_stack[call_stack_ptr] = prog_ctr + 2;
+                cpu_handle.write_call_stack(call_stack_ptr, ins.next_pc);
                 call_stack_ptr++;
                 prog_ctr = new_address;
         } else {
@@ -328,228 +660,239 @@ void ins_call(CPU_Handle &cpu_handle) {
         }
 }
 
-void ins_ret(CPU_Handle &cpu_handle) {
-        int16_t *call_stack = cpu_handle.call_stack;
+void ins_ret(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
         int16_t &call_stack_ptr = cpu_handle.call_stack_ptr;
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
         if (call_stack_ptr > 0) {
                 call_stack_ptr--;
-                int16_t new_address = call_stack[call_stack_ptr];
+                int16_t new_address = cpu_handle.read_call_stack(call_stack_ptr);
                 prog_ctr = new_address;
-                // prog_ctr points to next instruction, so INSTRUCTION_LENS[24] unneeded
         } else {
                 handle_runtime_error(CALL_STACK_UNDERFLOW);
         }
 }
 
-void ins_push(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t &stack_ptr = cpu_handle.stack_ptr;
-        int16_t *program_mem = cpu_handle.program_mem;
+template <Operand_Kind SRC_KIND>
+void ins_push(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t &stack_ptr = cpu_handle.registers[REG_RSP];
         if (stack_ptr == STACK_SIZE) {
                 handle_runtime_error(STACK_OVERFLOW);
         }
-        int16_t raw = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t value = cpu_handle.dereference_value(raw);
+        int16_t value = cpu_handle.load_operand<SRC_KIND>(ins.args[0]);
         value = clamp(value);
-        program_mem[STACK_START + stack_ptr] = value;
+        cpu_handle.write_ram(STACK_START + stack_ptr, value);
         stack_ptr++;
 
-        prog_ctr += 2;
+        prog_ctr = ins.next_pc;
 }
 
-void ins_pop(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t &stack_ptr = cpu_handle.stack_ptr;
-        int16_t *program_mem = cpu_handle.program_mem;
+void ins_pop(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t &stack_ptr = cpu_handle.registers[REG_RSP];
 
         if (stack_ptr <= 0) {
                 handle_runtime_error(STACK_UNDERFLOW);
         }
 
         stack_ptr--;
-        int16_t value = program_mem[STACK_START + stack_ptr];
-        int16_t dest = cpu_handle.get_program_data(prog_ctr + 1);
+        int16_t value = cpu_handle.read_ram(STACK_START + stack_ptr);
+        int16_t dest = dest_index(ins.args[0]);
         update_register(cpu_handle, dest, value);
 
-        prog_ctr += 2;
+        prog_ctr = ins.next_pc;
 }
 
-void ins_write(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t *program_mem = cpu_handle.program_mem;
-        int16_t raw = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t value = cpu_handle.dereference_value(raw);
+template <Operand_Kind SRC_1_KIND, Operand_Kind SRC_2_KIND>
+void ins_write(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t value = cpu_handle.load_operand<SRC_1_KIND>(ins.args[0]);
         value = clamp(value);
-        int16_t raw_2 = cpu_handle.get_program_data(prog_ctr + 2);
-        int16_t address = cpu_handle.dereference_value(raw_2);
+        int16_t address = cpu_handle.load_operand<SRC_2_KIND>(ins.args[1]);
         if (address < 0 || address >= STACK_START) {
                 handle_runtime_error(OOB_ADDRESS);
         }
-        program_mem[address] = value;
-        prog_ctr += 3;
+        cpu_handle.write_ram(address, value);
+        prog_ctr = ins.next_pc;
 }
 
-void ins_read(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t *program_mem = cpu_handle.program_mem;
-        int16_t dest = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t address = cpu_handle.dereference_value(cpu_handle.get_program_data(prog_ctr + 2));
+template <Operand_Kind SRC_KIND>
+void ins_read(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t dest = dest_index(ins.args[0]);
+        int16_t address = cpu_handle.load_operand<SRC_KIND>(ins.args[1]);
         if (address < 0 || address >= STACK_START) {
                 handle_runtime_error(OOB_ADDRESS);
         }
-        int16_t value = program_mem[address];
+        int16_t value = cpu_handle.read_ram(address);
         update_register(cpu_handle, dest, value);
-        prog_ctr += 3;
-}
-
-void ins_print(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t raw = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t value = cpu_handle.dereference_value(raw);
-        std::cout << value;
-        prog_ctr += 2;
-}
-
-void ins_sprint(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t raw = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t temp_str_idx = cpu_handle.dereference_value(raw);
-        std::string output;
-        while (cpu_handle.get_program_data(temp_str_idx) != (int16_t)0) {
-                int16_t curr = cpu_handle.get_program_data(temp_str_idx);
-                char lower = (char)(curr & 255);
-                char higher = (char)(curr >> 8);
-                output += lower;
-                // so that \x1b[0m gets matched correctly
-                if (higher != 0)
-                        output += higher;
-                temp_str_idx++;
-        }
+        prog_ctr = ins.next_pc;
+}
 
-        // check if sprint string is an ANSI escape code
-        std::map<std::string, std::string> ansi_code_map = {
-                {"\\x1b[0m",  "\x1b[0m"},  // clear
-                {"\\x1b[30m", "\x1b[30m"}, // black   fg
-                {"\\x1b[31m", "\x1b[31m"}, // red     fg
-                {"\\x1b[32m", "\x1b[32m"}, // green   fg
-                {"\\x1b[33m", "\x1b[33m"}, // yellow  fg
-                {"\\x1b[34m", "\x1b[34m"}, // blue    fg
-                {"\\x1b[35m", "\x1b[35m"}, // magenta fg
-                {"\\x1b[36m", "\x1b[36m"}, // cyan    fg
-                {"\\x1b[37m", "\x1b[37m"}, // white   fg
-                {"\\x1b[40m", "\x1b[40m"}, // black   bg
-                {"\\x1b[41m", "\x1b[41m"}, // red     bg
-                {"\\x1b[42m", "\x1b[42m"}, // green   bg
-                {"\\x1b[43m", "\x1b[43m"}, // yellow  bg
-                {"\\x1b[44m", "\x1b[44m"}, // blue    bg
-                {"\\x1b[45m", "\x1b[45m"}, // magenta bg
-                {"\\x1b[46m", "\x1b[46m"}, // cyan    bg
-                {"\\x1b[47m", "\x1b[47m"}, // white   bg
-        };
-
-        if (ansi_code_map.find(output) != ansi_code_map.end()) {
-                std::cout << ansi_code_map.at(output);
+template <Operand_Kind SRC_KIND>
+void ins_print(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t value = cpu_handle.load_operand<SRC_KIND>(ins.args[0]);
+        if (cpu_handle.raw_print_output)
+                cpu_handle.raw_print_output->put_word(value);
+        else
+                cpu_handle.output.put_int(value);
+        prog_ctr = ins.next_pc;
+}
+
+template <Operand_Kind SRC_KIND>
+void ins_sprint(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t temp_str_idx = cpu_handle.load_operand<SRC_KIND>(ins.args[0]);
+        if constexpr (SRC_KIND == OPERAND_STR_ADDR) {
+                // only picked for strings verify_program proved are
+                // terminated inside the program, which decode_strings
+                // already unpacked
+                const Loaded_Program &loaded = *cpu_handle.loaded_program;
+                const String_Span &span = loaded.string_spans[temp_str_idx];
+                cpu_handle.output.put_string(loaded.string_bytes.data() + span.offset, span.length);
         } else {
-                std::cout << output;
+                std::string output;
+                while (true) {
+                        int16_t curr = cpu_handle.get_program_data(temp_str_idx);
+                        if (curr == (int16_t)0)
+                                break;
+                        unpack_word(output, curr);
+                        temp_str_idx++;
+                }
+                resolve_ansi_code(output);
+                cpu_handle.output.put_string(output.data(), output.size());
         }
 
-        prog_ctr += 2;
+        prog_ctr = ins.next_pc;
 }
 
-void ins_cprint(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t raw = cpu_handle.get_program_data(prog_ctr + 1);
-        int16_t value = cpu_handle.dereference_value(raw);
+template <Operand_Kind SRC_KIND>
+void ins_cprint(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t value = cpu_handle.load_operand<SRC_KIND>(ins.args[0]);
         if (value < 0 || value > 127) {
                 handle_runtime_error(ASCII_ERROR);
         }
-        std::cout << (char)value;
-
-        prog_ctr += 2;
+        cpu_handle.output.put_char((char)value);
+
+        prog_ctr = ins.next_pc;
+}
+
+/**
+ * @brief parses an INPUT line as an integer, same as std::istream >> would
+ * @details leading whitespace and a '+' are skipped, and anything after the
+ * digits is ignored. False if there are no digits, or the value doesn't fit
+ * in an int16_t. helper function of ins_input
+ */
+static bool parse_input_value(const std::string_view user_input, int16_t &value) {
+        const char *first = user_input.data();
+        const char *last = user_input.data() + user_input.size();
+        while (first != last && isspace((unsigned char)*first))
+                first++;
+        // from_chars takes a '-', but not a '+'
+        if (first != last && *first == '+') {
+                first++;
+                if (first != last && *first == '-')
+                        return false;
+        }
+        std::from_chars_result result = std::from_chars(first, last, value);
+        return result.ec == std::errc();
 }
 
-void ins_input(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t &stack_ptr = cpu_handle.stack_ptr;
-        int16_t *program_mem = cpu_handle.program_mem;
+void ins_input(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t &stack_ptr = cpu_handle.registers[REG_RSP];
         if (stack_ptr == STACK_SIZE) {
                 handle_runtime_error(STACK_OVERFLOW);
         }
 
+        cpu_handle.count_input();
         int16_t value;
-        std::string user_input;
-        std::getline(std::cin, user_input);
-        if (user_input.length() == 0) {
-                // empty input interpreted as newline (ascii value 10)
-                user_input = "\n";
-        }
-
-        bool is_ascii_input = (user_input.length() == 1) && isascii(user_input.at(0));
-        if (!isdigit(user_input.at(0)) && is_ascii_input) {
-                // if user inputs an asciiable, interpret it's ascii value
-                value = (int16_t)((char)user_input.at(0));
+        if (cpu_handle.input_format() == INPUT_RAW) {
+                if (!cpu_handle.read_input_word(value))
+                        handle_runtime_error(INPUT_ERROR);
         } else {
-                // else, interpret as an integer
-                std::stringstream aux_stream;
-                aux_stream << user_input;
-                aux_stream >> value;
-                if (aux_stream.fail())
+                std::string_view user_input = cpu_handle.read_input_line();
+                if (user_input.length() == 0) {
+                        // empty input interpreted as newline (ascii value 10)
+                        user_input = "\n";
+                }
+
+                bool is_ascii_input = (user_input.length() == 1) && isascii(user_input.at(0));
+                if (!isdigit(user_input.at(0)) && is_ascii_input) {
+                        // if user inputs an asciiable, interpret it's ascii value
+                        value = (int16_t)((char)user_input.at(0));
+                } else if (!parse_input_value(user_input, value)) {
+                        // else, interpret as an integer
                         handle_runtime_error(INPUT_ERROR);
+                }
         }
         value = clamp(value);
-        program_mem[STACK_START + stack_ptr] = value;
+        cpu_handle.write_ram(STACK_START + stack_ptr, value);
         stack_ptr++;
-        prog_ctr += 1;
+        prog_ctr = ins.next_pc;
 }
 
-void ins_sinput(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t &stack_ptr = cpu_handle.stack_ptr;
-        int16_t *program_mem = cpu_handle.program_mem;
-
-        std::string user_input;
-        std::getline(std::cin, user_input);
-        if (user_input.length() == 0) {
-                // empty input interpreted as newline
-                user_input = "\n";
-        }
-
-        for (char i : user_input) {
-                // push ascii value to each character
-                if (stack_ptr == STACK_SIZE) {
-                        handle_runtime_error(STACK_OVERFLOW);
-                }
-                program_mem[STACK_START + stack_ptr] = (int16_t)i;
-                stack_ptr++;
-        }
+/**
+ * @brief pushes one character of a SINPUT string
+ * @details helper function of ins_sinput
+ */
+static void push_input_char(CPU_Handle &cpu_handle, int16_t &stack_ptr, const int16_t value) {
         if (stack_ptr == STACK_SIZE) {
                 handle_runtime_error(STACK_OVERFLOW);
         }
-        program_mem[STACK_START + stack_ptr] = (int16_t)0; // push null terminator
+        cpu_handle.write_ram(STACK_START + stack_ptr, value);
         stack_ptr++;
-        prog_ctr += 1;
 }
 
-void ins_rand(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        int16_t &stack_ptr = cpu_handle.stack_ptr;
-        int16_t *program_mem = cpu_handle.program_mem;
+void ins_sinput(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t &stack_ptr = cpu_handle.registers[REG_RSP];
+
+        cpu_handle.count_input();
+        if (cpu_handle.input_format() == INPUT_RAW) {
+                // the string is already one word per character
+                int16_t word;
+                while (cpu_handle.read_input_word(word) && word != 0)
+                        push_input_char(cpu_handle, stack_ptr, word);
+        } else {
+                std::string_view user_input = cpu_handle.read_input_line();
+                if (user_input.length() == 0) {
+                        // empty input interpreted as newline
+                        user_input = "\n";
+                }
+                for (char i : user_input) {
+                        // push ascii value to each character
+                        push_input_char(cpu_handle, stack_ptr, (int16_t)i);
+                }
+        }
+        push_input_char(cpu_handle, stack_ptr, (int16_t)0); // push null terminator
+        prog_ctr = ins.next_pc;
+}
+
+void ins_rand(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        int16_t &stack_ptr = cpu_handle.registers[REG_RSP];
         if (stack_ptr == STACK_SIZE) {
                 handle_runtime_error(STACK_OVERFLOW);
         }
 
-        std::random_device rd;
-        std::mt19937 mt(rd());
-        std::uniform_int_distribution<int16_t> generator((int16_t)-100, (int16_t)100);
-        program_mem[STACK_START + stack_ptr] = generator(mt);
+        cpu_handle.write_ram(STACK_START + stack_ptr, cpu_handle.next_rand());
         stack_ptr++;
-        prog_ctr += 1;
+        prog_ctr = ins.next_pc;
+}
+
+void ins_exit(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        int16_t &prog_ctr = cpu_handle.registers[REG_RIP];
+        cpu_handle.output.flush();
+        prog_ctr = ins.next_pc;
 }
 
-void ins_exit(CPU_Handle &cpu_handle) {
-        int16_t &prog_ctr = cpu_handle.prog_ctr;
-        prog_ctr += 1;
+void ins_invalid(CPU_Handle &cpu_handle, const Decoded_Instruction &ins) {
+        (void)cpu_handle;
+        (void)ins;
+        handle_runtime_error(UNKNOWN_OPCODE);
 }
 
 void update_register(
@@ -557,26 +900,15 @@ void update_register(
         const int16_t dest,
         const int16_t value)
 {
-        if (dest < 0 || dest > 9) {
+        if (dest < REG_RZ || dest > REG_RSP) {
                 handle_runtime_error(IMMUTABLE_MUTATION);
         }
-        int16_t clamped_value = clamp(value);
-        switch (dest) {
-                case 0: break; // "RZ"
-                case 1: cpu_handle.reg_a = clamped_value; break;
-                case 2: cpu_handle.reg_b = clamped_value; break;
-                case 3: cpu_handle.reg_c = clamped_value; break;
-                case 4: cpu_handle.reg_d = clamped_value; break;
-                case 5: cpu_handle.reg_e = clamped_value; break;
-                case 6: cpu_handle.reg_f = clamped_value; break;
-                case 7: cpu_handle.reg_g = clamped_value; break;
-                case 8: cpu_handle.reg_h = clamped_value; break;
-                case 9: cpu_handle.stack_ptr = clamped_value; break;
-                default: break; /* impossible */
-        }
-
-        if (value == 8 &&
-                (cpu_handle.stack_ptr < 0 || cpu_handle.stack_ptr >= STACK_SIZE)) {
+        const int16_t clamped = clamp(value);
+        // a stack_ptr outside the stack would push and pop outside of it
+        if (dest == REG_RSP && (clamped < 0 || clamped >= STACK_SIZE)) {
                 handle_runtime_error(STACK_WRITE_ERROR);
         }
+        // RZ always reads 0, so writes to it are dropped
+        if (dest != REG_RZ)
+                cpu_handle.registers[dest] = clamped;
 }
@@ -2,52 +2,129 @@
 #define INSTRUCTIONS_H 1
 
 #include <cstdint>
+#include <string>
+#include <vector>
 
+#include "../instruction_types.h"
 #include "cpu_handle.h"
+#include "decoder.h"
 
 // functions to simulate instructions
 
-int16_t clamp(const int16_t value);
-void ins_nop(CPU_Handle    &cpu_handle);
-void ins_mov(CPU_Handle    &cpu_handle);
-void ins_inc(CPU_Handle    &cpu_handle);
-void ins_dec(CPU_Handle    &cpu_handle);
-void ins_add(CPU_Handle    &cpu_handle);
-void ins_sub(CPU_Handle    &cpu_handle);
-void ins_mul(CPU_Handle    &cpu_handle);
-void ins_div(CPU_Handle    &cpu_handle);
-void ins_mod(CPU_Handle    &cpu_handle);
-void ins_and(CPU_Handle    &cpu_handle);
-void ins_or(CPU_Handle     &cpu_handle);
-void ins_not(CPU_Handle    &cpu_handle);
-void ins_xor(CPU_Handle    &cpu_handle);
-void ins_lsh(CPU_Handle    &cpu_handle);
-void ins_rsh(CPU_Handle    &cpu_handle);
-void ins_cmp(CPU_Handle    &cpu_handle);
-void ins_jmp(CPU_Handle    &cpu_handle);
-void ins_jeq(CPU_Handle    &cpu_handle);
-void ins_jne(CPU_Handle    &cpu_handle);
-void ins_jge(CPU_Handle    &cpu_handle);
-void ins_jgr(CPU_Handle    &cpu_handle);
-void ins_jle(CPU_Handle    &cpu_handle);
-void ins_jls(CPU_Handle    &cpu_handle);
-void ins_call(CPU_Handle   &cpu_handle);
-void ins_ret(CPU_Handle    &cpu_handle);
-void ins_push(CPU_Handle   &cpu_handle);
-void ins_pop(CPU_Handle    &cpu_handle);
-void ins_write(CPU_Handle  &cpu_handle);
-void ins_read(CPU_Handle   &cpu_handle);
-void ins_print(CPU_Handle  &cpu_handle);
-void ins_sprint(CPU_Handle &cpu_handle);
-void ins_cprint(CPU_Handle &cpu_handle);
-void ins_input(CPU_Handle  &cpu_handle);
-void ins_sinput(CPU_Handle &cpu_handle);
-void ins_rand(CPU_Handle &cpu_handle);
-void ins_exit(CPU_Handle   &cpu_handle);
+/**
+ * @brief ins_* functions indexed by opcode, for one step dispatch
+ * @details helper table of CPU_Handle::next_instruction. The extra entry
+ * at INVALID_OPCODE raises an unknown opcode error
+ */
+extern const Instruction_Handler INSTRUCTION_HANDLERS[NUM_OPCODES + 1];
+
+/**
+ * @brief picks the base handler of every decoded instruction
+ * @details instructions with operands get a handler compiled for their
+ * operand kinds, e.g. ins_add<OPERAND_REGISTER, OPERAND_LITERAL>, so the
+ * switch in dereference_value is skipped. SPRINTs marked proven by
+ * verify_program write the string decode_strings unpacked for them. Runs after
+ * verify_program and before fuse_program
+ */
+void specialise_program(std::vector<Decoded_Instruction> &decoded_program);
+
+/**
+ * @brief decodes the string of every proven SPRINT ahead of time
+ * @details the packed characters are unpacked, and ANSI escape codes are
+ * resolved, the same way ins_sprint<ANY> does it when it runs. Each
+ * distinct string is appended to string_bytes once, and string_spans,
+ * indexed by the address the string starts at, says where it went. Runs
+ * after verify_program
+ */
+void decode_strings(
+        const int16_t *program_data,
+        const int16_t prog_size,
+        const std::vector<Decoded_Instruction> &decoded_program,
+        std::string &string_bytes,
+        std::vector<String_Span> &string_spans
+);
+
+/**
+ * @brief picks the handler of every decoded instruction
+ * @details where a sequence in Fusion_Enum starts, the handler runs the
+ * whole sequence in one step, with the same effects as running the
+ * instructions one at a time. Used by run_program and run_program_threaded,
+ * but not the debugger, which has to stop between every instruction
+ */
+void fuse_program(std::vector<Decoded_Instruction> &decoded_program);
+
+inline int16_t clamp(const int16_t value);
+void ins_nop(CPU_Handle    &cpu_handle, const Decoded_Instruction &ins);
+template <Operand_Kind SRC_KIND>
+void ins_mov(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+template <Operand_Kind DEST_KIND>
+void ins_inc(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+template <Operand_Kind DEST_KIND>
+void ins_dec(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+void ins_add(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+void ins_sub(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+void ins_mul(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+void ins_div(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+void ins_mod(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+void ins_and(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+void ins_or(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+template <Operand_Kind SRC_KIND>
+void ins_not(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+void ins_xor(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+void ins_lsh(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+template <Operand_Kind DEST_KIND, Operand_Kind SRC_KIND>
+void ins_rsh(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+template <Operand_Kind SRC_1_KIND, Operand_Kind SRC_2_KIND>
+void ins_cmp(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+void ins_jmp(CPU_Handle    &cpu_handle, const Decoded_Instruction &ins);
+void ins_jeq(CPU_Handle    &cpu_handle, const Decoded_Instruction &ins);
+void ins_jne(CPU_Handle    &cpu_handle, const Decoded_Instruction &ins);
+void ins_jge(CPU_Handle    &cpu_handle, const Decoded_Instruction &ins);
+void ins_jgr(CPU_Handle    &cpu_handle, const Decoded_Instruction &ins);
+void ins_jle(CPU_Handle    &cpu_handle, const Decoded_Instruction &ins);
+void ins_jls(CPU_Handle    &cpu_handle, const Decoded_Instruction &ins);
+void ins_call(CPU_Handle   &cpu_handle, const Decoded_Instruction &ins);
+void ins_ret(CPU_Handle    &cpu_handle, const Decoded_Instruction &ins);
+template <Operand_Kind SRC_KIND>
+void ins_push(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+void ins_pop(CPU_Handle    &cpu_handle, const Decoded_Instruction &ins);
+template <Operand_Kind SRC_1_KIND, Operand_Kind SRC_2_KIND>
+void ins_write(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+template <Operand_Kind SRC_KIND>
+void ins_read(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+template <Operand_Kind SRC_KIND>
+void ins_print(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+template <Operand_Kind SRC_KIND>
+void ins_sprint(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+template <Operand_Kind SRC_KIND>
+void ins_cprint(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+void ins_input(CPU_Handle  &cpu_handle, const Decoded_Instruction &ins);
+void ins_sinput(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+void ins_rand(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
+void ins_exit(CPU_Handle   &cpu_handle, const Decoded_Instruction &ins);
+void ins_invalid(CPU_Handle &cpu_handle, const Decoded_Instruction &ins);
 void update_register(
         CPU_Handle &cpu_handle,
         const int16_t dest,
         const int16_t value
 );
 
+// inline, so the engines that don't go through update_register can use it
+inline int16_t clamp(const int16_t value) {
+        if (value > LIT_MAX_VALUE)
+                return LIT_MAX_VALUE;
+        else if (value < LIT_MIN_VALUE)
+                return LIT_MIN_VALUE;
+        return value;
+}
+
 #endif
@@ -0,0 +1,128 @@
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "input_source.h"
+#include "io_log.h"
+
+static const std::string IO_LOG_HEADER = "PAL io log ";
+
+/**
+ * @brief parses the int16_t that makes up all of text
+ * @details helper function of parse_event
+ */
+static bool parse_value(const std::string_view text, int16_t &value) {
+        const char *last = text.data() + text.size();
+        std::from_chars_result result = std::from_chars(text.data(), last, value);
+        return result.ec == std::errc() && result.ptr == last;
+}
+
+/**
+ * @brief turns one line of a recorded log back into an event
+ * @details false if the line isn't one put_rand, put_line or put_word
+ * writes. helper function of Io_Log::replay_from
+ */
+static bool parse_event(const std::string &log_line, Io_Event &event) {
+        event.kind = log_line.empty() ? '\0' : log_line[0];
+        event.found = true;
+        event.value = 0;
+        event.line = "";
+        std::string_view payload = std::string_view(log_line).substr(log_line.empty() ? 0 : 1);
+        if (event.kind == 'W' && payload.empty()) {
+                event.found = false;
+                return true;
+        }
+        if (payload.empty() || payload[0] != ' ')
+                return false;
+        payload.remove_prefix(1);
+        switch (event.kind) {
+        case 'R':
+        case 'W':
+                return parse_value(payload, event.value);
+        case 'I':
+                event.line = std::string(payload);
+                return true;
+        default:
+                return false;
+        }
+}
+
+Io_Log::Io_Log() {
+        mode = IO_LOG_OFF;
+        record_stream = nullptr;
+        next_event = 0;
+        format = INPUT_TEXT;
+}
+
+void Io_Log::record_to(std::ostream &given_stream, const Input_Format given_format) {
+        mode = IO_LOG_RECORD;
+        record_stream = &given_stream;
+        events.reset();
+        format = given_format;
+        *record_stream << IO_LOG_HEADER << ((format == INPUT_RAW) ? "raw" : "text") << "\n";
+}
+
+bool Io_Log::replay_from(const std::string &file_path) {
+        std::ifstream log_file(file_path, std::ios::binary);
+        if (log_file.fail())
+                return false;
+        std::string log_line;
+        if (!std::getline(log_file, log_line))
+                return false;
+        Input_Format log_format;
+        if (log_line == IO_LOG_HEADER + "text")
+                log_format = INPUT_TEXT;
+        else if (log_line == IO_LOG_HEADER + "raw")
+                log_format = INPUT_RAW;
+        else
+                return false;
+
+        std::shared_ptr<std::vector<Io_Event>> log_events = std::make_shared<std::vector<Io_Event>>();
+        while (std::getline(log_file, log_line)) {
+                Io_Event event;
+                if (!parse_event(log_line, event))
+                        return false;
+                log_events->push_back(event);
+        }
+        mode = IO_LOG_REPLAY;
+        record_stream = nullptr;
+        events = log_events;
+        next_event = 0;
+        format = log_format;
+        return true;
+}
+
+Io_Log_Mode Io_Log::get_mode() const {
+        return mode;
+}
+
+Input_Format Io_Log::get_format() const {
+        return format;
+}
+
+void Io_Log::put_rand(const int16_t value) {
+        *record_stream << "R " << value << "\n";
+}
+
+void Io_Log::put_line(const std::string_view line) {
+        *record_stream << "I " << line << "\n";
+}
+
+void Io_Log::put_word(const bool found, const int16_t word) {
+        if (found)
+                *record_stream << "W " << word << "\n";
+        else
+                *record_stream << "W\n";
+}
+
+const Io_Event *Io_Log::take_event(const char kind) {
+        if (next_event >= events->size() || (*events)[next_event].kind != kind)
+                return nullptr;
+        return &(*events)[next_event++];
+}
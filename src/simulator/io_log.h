@@ -0,0 +1,84 @@
+#ifndef IO_LOG_H
+#define IO_LOG_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "input_source.h"
+
+/**
+ * @brief whether RAND results and input reads are logged or replayed
+ */
+enum Io_Log_Mode {
+        IO_LOG_OFF,    ///< default
+        IO_LOG_RECORD, ///< every RAND result and input read is written out
+        IO_LOG_REPLAY, ///< RAND results and input come from a recorded log
+};
+
+/**
+ * @brief one RAND result or input read of a recorded log
+ */
+struct Io_Event {
+        char kind;        ///< 'R' for RAND, 'I' for a line, 'W' for a raw word
+        bool found;       ///< for 'W', false if the input had run out
+        int16_t value;    ///< for 'R' and 'W'
+        std::string line; ///< for 'I'
+};
+
+/**
+ * @brief log of everything that makes a run of a program nondeterministic
+ * @details a recorded log is text, so it can be read and edited. The first
+ * line is "PAL io log " followed by "text" or "raw", the format input was
+ * read in. Then one line per event: "R <value>", "I <line>", "W <word>",
+ * or "W" alone when raw input had run out
+ */
+class Io_Log {
+        Io_Log_Mode mode;
+        std::ostream *record_stream; /** null unless recording */
+        std::shared_ptr<const std::vector<Io_Event>> events; /** null unless replaying */
+        size_t next_event; /** first event of events not replayed yet */
+        Input_Format format; /** of the input being recorded or replayed */
+public:
+        Io_Log();
+        void record_to(std::ostream &given_stream, const Input_Format given_format);
+        bool replay_from(const std::string &file_path);
+        Io_Log_Mode get_mode() const;
+        Input_Format get_format() const;
+        void put_rand(const int16_t value);
+        void put_line(const std::string_view line);
+        void put_word(const bool found, const int16_t word);
+        const Io_Event *take_event(const char kind);
+};
+
+/**
+ * @fn Io_Log::Io_Log()
+ * @brief neither records nor replays
+ */
+
+/**
+ * @fn void Io_Log::record_to(std::ostream &given_stream, const Input_Format given_format)
+ * @brief writes the header, then every event, to given_stream
+ * @details given_stream has to outlive every run
+ */
+
+/**
+ * @fn bool Io_Log::replay_from(const std::string &file_path)
+ * @brief reads every event of a recorded log, to be taken in order
+ * @details copies of this Io_Log share the events, but each keeps its own
+ * place. Returns false, and changes nothing, if the file can't be opened
+ * or isn't a log
+ */
+
+/**
+ * @fn const Io_Event *Io_Log::take_event(const char kind)
+ * @brief the next event, if it's of the given kind
+ * @details null if it isn't, or the log has run out, which means the
+ * program being replayed isn't the one that was recorded
+ */
+
+#endif
@@ -0,0 +1,674 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#define PAL_JIT_SUPPORTED 1
+#endif
+
+#include "../common_values.h"
+#include "../instruction_types.h"
+#include "cpu_handle.h"
+#include "decoder.h"
+#include "jit_engine.h"
+
+// x86-64 backend for CPU_Handle::run_program_jit
+// the native code keeps every PAL register in the CPU_Handle itself, and
+// only uses eax, ecx and edx in between, so a block is a plain function
+// that only has to load CPU_Handle::memory into rsi on entry. Before an
+// instruction writes anything, it runs the same checks as its ins_*
+// function. If one fails, the block returns that instruction's address
+// with JIT_INTERPRET set, and the interpreter runs it again to raise the
+// usual error (or print the usual warning)
+
+#ifdef PAL_JIT_SUPPORTED
+
+// most instructions a block holds, so a block always fits in an arena
+#define JIT_MAX_BLOCK_LENGTH 64
+#define JIT_ARENA_SIZE (1 << 20)
+
+enum X86_Register : uint8_t {
+        EAX = 0,
+        ECX = 1,
+        EDX = 2,
+};
+
+// condition codes, as the second byte of a two byte jcc
+enum X86_Condition : uint8_t {
+        CC_EQ  = 0x84,
+        CC_NE  = 0x85,
+        CC_AE  = 0x83, // unsigned, for range checks
+        CC_A   = 0x87, // unsigned, for range checks
+        CC_LS  = 0x8c,
+        CC_GE  = 0x8d,
+        CC_LE  = 0x8e,
+        CC_GR  = 0x8f,
+};
+
+/**
+ * @brief code buffer of the block being compiled
+ */
+struct Jit_Emitter {
+        std::vector<uint8_t> code;
+        // jcc rel32 fields that go to the bail out of some address
+        std::vector<std::pair<size_t, int16_t>> bail_sites;
+        int16_t curr_address; // instruction being compiled
+
+        void byte(const uint8_t value) {
+                code.push_back(value);
+        }
+
+        void imm16(const int16_t value) {
+                byte((uint8_t)(value & 255));
+                byte((uint8_t)((value >> 8) & 255));
+        }
+
+        void imm32(const int32_t value) {
+                for (int i = 0; i < 4; ++i)
+                        byte((uint8_t)((value >> (8 * i)) & 255));
+        }
+
+        // emits a jcc rel32 with an empty target, returns where to patch it
+        size_t jcc(const X86_Condition condition) {
+                byte(0x0f);
+                byte(condition);
+                imm32(0);
+                return code.size() - 4;
+        }
+
+        size_t jmp() {
+                byte(0xe9);
+                imm32(0);
+                return code.size() - 4;
+        }
+
+        void patch(const size_t site, const size_t target) {
+                int32_t rel = (int32_t)target - (int32_t)(site + 4);
+                memcpy(&code[site], &rel, 4);
+        }
+
+        // leaves the block when condition holds, so the interpreter runs
+        // the current instruction instead
+        void bail_if(const X86_Condition condition) {
+                bail_sites.push_back({jcc(condition), curr_address});
+        }
+};
+
+// movsx reg, word [rdi + disp]
+static void emit_load_field(Jit_Emitter &e, const X86_Register reg, const int32_t disp) {
+        e.byte(0x0f); e.byte(0xbf); e.byte(0x87 | (reg << 3));
+        e.imm32(disp);
+}
+
+// mov word [rdi + disp], reg
+static void emit_store_field(Jit_Emitter &e, const X86_Register reg, const int32_t disp) {
+        e.byte(0x66); e.byte(0x89); e.byte(0x87 | (reg << 3));
+        e.imm32(disp);
+}
+
+// add word [rdi + disp], 1
+static void emit_increment_field(Jit_Emitter &e, const int32_t disp) {
+        e.byte(0x66); e.byte(0x83); e.byte(0x87);
+        e.imm32(disp);
+        e.byte(1);
+}
+
+// mov rsi, qword [rdi + disp], the base of every memory access
+static void emit_load_memory_base(Jit_Emitter &e, const int32_t disp) {
+        e.byte(0x48); e.byte(0x8b); e.byte(0xb7);
+        e.imm32(disp);
+}
+
+// movsx reg, word [rsi + disp]
+static void emit_load_memory(Jit_Emitter &e, const X86_Register reg, const int32_t disp) {
+        e.byte(0x0f); e.byte(0xbf); e.byte(0x86 | (reg << 3));
+        e.imm32(disp);
+}
+
+// movsx reg, word [rsi + index*2 + disp]
+static void emit_load_indexed(
+        Jit_Emitter &e,
+        const X86_Register reg,
+        const X86_Register index,
+        const int32_t disp
+) {
+        e.byte(0x0f); e.byte(0xbf); e.byte(0x84 | (reg << 3));
+        e.byte(0x46 | (index << 3));
+        e.imm32(disp);
+}
+
+// mov word [rsi + index*2 + disp], reg
+static void emit_store_indexed(
+        Jit_Emitter &e,
+        const X86_Register reg,
+        const X86_Register index,
+        const int32_t disp
+) {
+        e.byte(0x66); e.byte(0x89); e.byte(0x84 | (reg << 3));
+        e.byte(0x46 | (index << 3));
+        e.imm32(disp);
+}
+
+// mov reg, imm
+static void emit_mov_imm(Jit_Emitter &e, const X86_Register reg, const int32_t value) {
+        e.byte(0xb8 + reg);
+        e.imm32(value);
+}
+
+// cmp reg, imm
+static void emit_cmp_imm(Jit_Emitter &e, const X86_Register reg, const int32_t value) {
+        e.byte(0x81); e.byte(0xf8 | reg);
+        e.imm32(value);
+}
+
+// add reg, imm
+static void emit_add_imm(Jit_Emitter &e, const X86_Register reg, const int32_t value) {
+        e.byte(0x81); e.byte(0xc0 | reg);
+        e.imm32(value);
+}
+
+// test reg, reg
+static void emit_test(Jit_Emitter &e, const X86_Register reg) {
+        e.byte(0x85); e.byte(0xc0 | (reg << 3) | reg);
+}
+
+// movsx reg, reg16, the truncation of assigning an int to an int16_t
+static void emit_truncate(Jit_Emitter &e, const X86_Register reg) {
+        e.byte(0x0f); e.byte(0xbf); e.byte(0xc0 | (reg << 3) | reg);
+}
+
+// same as clamp, on eax or ecx. uses edx
+static void emit_clamp(Jit_Emitter &e, const X86_Register reg) {
+        emit_cmp_imm(e, reg, LIT_MAX_VALUE);
+        emit_mov_imm(e, EDX, LIT_MAX_VALUE);
+        e.byte(0x0f); e.byte(0x4f); e.byte(0xc2 | (reg << 3)); // cmovg reg, edx
+        emit_cmp_imm(e, reg, LIT_MIN_VALUE);
+        emit_mov_imm(e, EDX, LIT_MIN_VALUE);
+        e.byte(0x0f); e.byte(0x4c); e.byte(0xc2 | (reg << 3)); // cmovl reg, edx
+}
+
+// mov eax, result; ret
+static void emit_exit(Jit_Emitter &e, const int32_t result) {
+        emit_mov_imm(e, EAX, result);
+        e.byte(0xc3);
+}
+
+// leaves the block for address, or loops back if it's the start of the block
+static void emit_goto(Jit_Emitter &e, const int16_t address, const int16_t block_start) {
+        if (address == block_start)
+                e.patch(e.jmp(), 0);
+        else
+                emit_exit(e, address);
+}
+
+static bool is_writable(const Decoded_Operand &operand) {
+        // RZ through RSP, see update_register
+        return operand.kind == OPERAND_REGISTER && operand.value <= REG_RSP;
+}
+
+/**
+ * @brief loads the value of operand into reg, same as dereference_value
+ * @details reg is eax or ecx. Uses edx. Returns false for operands that
+ * always fail, which are left to the interpreter
+ */
+static bool emit_load_operand(
+        Jit_Emitter &e,
+        const Jit_Layout &layout,
+        const X86_Register reg,
+        const Decoded_Operand &operand
+) {
+        switch (operand.kind) {
+        case OPERAND_LITERAL:
+        case OPERAND_STR_ADDR:
+        case OPERAND_LABEL:
+                emit_mov_imm(e, reg, operand.value);
+                return true;
+        case OPERAND_REGISTER:
+                if (operand.value == REG_RZ)
+                        emit_mov_imm(e, reg, 0);
+                else if (operand.value == REG_RIP) // RIP reads the current address
+                        emit_mov_imm(e, reg, e.curr_address);
+                else
+                        emit_load_field(e, reg, layout.registers[operand.value]);
+                return true;
+        case OPERAND_STACK_OFFSET:
+                // operand.value > stack_ptr || stack_ptr <= 0
+                emit_load_field(e, EDX, layout.registers[REG_RSP]);
+                emit_test(e, EDX);
+                e.bail_if(CC_LE);
+                emit_cmp_imm(e, EDX, operand.value);
+                e.bail_if(CC_LS);
+                emit_add_imm(e, EDX, STACK_START - operand.value - 1);
+                // a stack_ptr set past the stack would read outside program_mem
+                emit_cmp_imm(e, EDX, RAM_SIZE);
+                e.bail_if(CC_AE);
+                emit_load_indexed(e, reg, EDX, layout.program_mem);
+                return true;
+        case OPERAND_RAM_ADDR:
+                if (operand.value < 0 || operand.value >= STACK_START)
+                        return false;
+                emit_load_memory(e, reg, layout.program_mem + 2 * operand.value);
+                return true;
+        default:
+                return false;
+        }
+}
+
+/**
+ * @brief stores eax to register dest, same as update_register
+ * @details dest has to pass is_writable. A stack_ptr outside the stack
+ * bails before the store, so the interpreter raises STACK_WRITE_ERROR
+ */
+static void emit_update_register(Jit_Emitter &e, const Jit_Layout &layout, const int16_t dest) {
+        emit_clamp(e, EAX);
+        if (dest == REG_RSP) {
+                // unsigned, so a negative stack_ptr fails too
+                emit_cmp_imm(e, EAX, STACK_SIZE);
+                e.bail_if(CC_AE);
+        }
+        if (dest != REG_RZ)
+                emit_store_field(e, EAX, layout.registers[dest]);
+}
+
+enum Emit_Result {
+        EMIT_UNSUPPORTED, ///< left to the interpreter, nothing emitted
+        EMIT_CONTINUE,    ///< next instruction goes in the same block
+        EMIT_END,         ///< control left the block
+};
+
+/**
+ * @brief emits the native code of one instruction
+ * @details helper function of Jit_Engine::compile_block
+ */
+static Emit_Result emit_instruction(
+        Jit_Emitter &e,
+        const Jit_Layout &layout,
+        const Decoded_Instruction &ins,
+        const int16_t block_start
+) {
+        const Decoded_Operand &arg_0 = ins.args[0];
+        const Decoded_Operand &arg_1 = ins.args[1];
+        int16_t dest = arg_0.value;
+
+        switch (ins.opcode) {
+        case OP_NOP:
+                return EMIT_CONTINUE;
+        case OP_MOV:
+                if (!is_writable(arg_0) || !emit_load_operand(e, layout, EAX, arg_1))
+                        return EMIT_UNSUPPORTED;
+                emit_update_register(e, layout, dest);
+                return EMIT_CONTINUE;
+        case OP_INC:
+        case OP_DEC:
+                if (!is_writable(arg_0) || !emit_load_operand(e, layout, EAX, arg_0))
+                        return EMIT_UNSUPPORTED;
+                emit_add_imm(e, EAX, ins.opcode == OP_INC ? 1 : -1);
+                emit_truncate(e, EAX);
+                // simulate wrap around
+                if (ins.opcode == OP_INC) {
+                        emit_cmp_imm(e, EAX, LIT_MAX_VALUE + 1);
+                        e.byte(0x75); e.byte(5); // jne past the mov
+                        emit_mov_imm(e, EAX, LIT_MIN_VALUE);
+                } else {
+                        emit_cmp_imm(e, EAX, LIT_MIN_VALUE - 1);
+                        e.byte(0x75); e.byte(5);
+                        emit_mov_imm(e, EAX, LIT_MAX_VALUE);
+                }
+                emit_update_register(e, layout, dest);
+                return EMIT_CONTINUE;
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_MOD:
+        case OP_AND:
+        case OP_OR:
+        case OP_XOR:
+        case OP_LSH:
+        case OP_RSH:
+                if (!is_writable(arg_0)
+                        || !emit_load_operand(e, layout, EAX, arg_0)
+                        || !emit_load_operand(e, layout, ECX, arg_1))
+                        return EMIT_UNSUPPORTED;
+                switch (ins.opcode) {
+                case OP_ADD: e.byte(0x01); e.byte(0xc8); break; // add eax, ecx
+                case OP_SUB: e.byte(0x29); e.byte(0xc8); break; // sub eax, ecx
+                case OP_AND: e.byte(0x21); e.byte(0xc8); break; // and eax, ecx
+                case OP_OR:  e.byte(0x09); e.byte(0xc8); break; // or eax, ecx
+                case OP_XOR: e.byte(0x31); e.byte(0xc8); break; // xor eax, ecx
+                case OP_MUL:
+                        // the exact product, saturated like ins_mul
+                        e.byte(0x0f); e.byte(0xaf); e.byte(0xc1); // imul eax, ecx
+                        emit_clamp(e, EAX);
+                        break;
+                case OP_DIV:
+                case OP_MOD:
+                        // by zero prints a warning, so the interpreter does it
+                        emit_test(e, ECX);
+                        e.bail_if(CC_EQ);
+                        e.byte(0x99);                // cdq
+                        e.byte(0xf7); e.byte(0xf9);  // idiv ecx
+                        if (ins.opcode == OP_MOD) {
+                                e.byte(0x89); e.byte(0xd0); // mov eax, edx
+                        }
+                        break;
+                case OP_LSH:
+                case OP_RSH:
+                        // negative shifts print a warning too
+                        emit_test(e, ECX);
+                        e.bail_if(CC_LS);
+                        e.byte(0xd3); // shl eax, cl / sar eax, cl
+                        e.byte(ins.opcode == OP_LSH ? 0xe0 : 0xf8);
+                        break;
+                default:
+                        break;
+                }
+                emit_truncate(e, EAX);
+                emit_update_register(e, layout, dest);
+                return EMIT_CONTINUE;
+        case OP_NOT:
+                if (!is_writable(arg_0) || !emit_load_operand(e, layout, EAX, arg_1))
+                        return EMIT_UNSUPPORTED;
+                e.byte(0xf7); e.byte(0xd0); // not eax
+                emit_truncate(e, EAX);
+                emit_update_register(e, layout, dest);
+                return EMIT_CONTINUE;
+        case OP_CMP:
+                if (!emit_load_operand(e, layout, EAX, arg_0)
+                        || !emit_load_operand(e, layout, ECX, arg_1))
+                        return EMIT_UNSUPPORTED;
+                emit_clamp(e, EAX);
+                emit_clamp(e, ECX);
+                emit_store_field(e, EAX, layout.registers[REG_CMP0]);
+                emit_store_field(e, ECX, layout.registers[REG_CMP1]);
+                return EMIT_CONTINUE;
+        case OP_JMP:
+                emit_goto(e, arg_0.value, block_start);
+                return EMIT_END;
+        case OP_JEQ:
+        case OP_JNE:
+        case OP_JGE:
+        case OP_JGR:
+        case OP_JLE:
+        case OP_JLS: {
+                static const X86_Condition CONDITIONS[6] = {
+                        CC_EQ, CC_NE, CC_GE, CC_GR, CC_LE, CC_LS,
+                };
+                emit_load_field(e, EAX, layout.registers[REG_CMP0]);
+                emit_load_field(e, ECX, layout.registers[REG_CMP1]);
+                e.byte(0x39); e.byte(0xc8); // cmp eax, ecx
+                size_t taken_site = e.jcc(CONDITIONS[ins.opcode - OP_JEQ]);
+                emit_goto(e, ins.next_pc, block_start);
+                e.patch(taken_site, e.code.size());
+                emit_goto(e, arg_0.value, block_start);
+                return EMIT_END;
+        }
+        case OP_CALL:
+                emit_load_field(e, EDX, layout.call_stack_ptr);
+                emit_cmp_imm(e, EDX, CALL_STACK_SIZE);
+                e.bail_if(CC_AE);
+                // mov word [rsi + rdx*2 + call_stack], next_pc
+                e.byte(0x66); e.byte(0xc7); e.byte(0x84); e.byte(0x56);
+                e.imm32(layout.call_stack);
+                e.imm16(ins.next_pc);
+                emit_increment_field(e, layout.call_stack_ptr);
+                emit_goto(e, arg_0.value, block_start);
+                return EMIT_END;
+        case OP_RET:
+                emit_load_field(e, EDX, layout.call_stack_ptr);
+                emit_test(e, EDX);
+                e.bail_if(CC_LE);
+                emit_add_imm(e, EDX, -1);
+                emit_store_field(e, EDX, layout.call_stack_ptr);
+                // movzx eax, word [rsi + rdx*2 + call_stack]
+                e.byte(0x0f); e.byte(0xb7); e.byte(0x84); e.byte(0x56);
+                e.imm32(layout.call_stack);
+                e.byte(0xc3);
+                return EMIT_END;
+        case OP_PUSH:
+                // stack_ptr == STACK_SIZE, or any stack_ptr outside the stack
+                emit_load_field(e, EDX, layout.registers[REG_RSP]);
+                emit_cmp_imm(e, EDX, STACK_SIZE);
+                e.bail_if(CC_AE);
+                if (!emit_load_operand(e, layout, EAX, arg_0))
+                        return EMIT_UNSUPPORTED;
+                emit_clamp(e, EAX);
+                emit_load_field(e, EDX, layout.registers[REG_RSP]);
+                emit_store_indexed(e, EAX, EDX, layout.program_mem + 2 * STACK_START);
+                emit_increment_field(e, layout.registers[REG_RSP]);
+                return EMIT_CONTINUE;
+        case OP_POP:
+                // after the decrement, stack_ptr is always inside the stack,
+                // so update_register can't raise STACK_WRITE_ERROR here
+                if (!is_writable(arg_0))
+                        return EMIT_UNSUPPORTED;
+                emit_load_field(e, EDX, layout.registers[REG_RSP]);
+                emit_test(e, EDX);
+                e.bail_if(CC_LE);
+                emit_cmp_imm(e, EDX, STACK_SIZE);
+                e.bail_if(CC_A);
+                emit_add_imm(e, EDX, -1);
+                emit_store_field(e, EDX, layout.registers[REG_RSP]);
+                emit_load_indexed(e, EAX, EDX, layout.program_mem + 2 * STACK_START);
+                emit_clamp(e, EAX);
+                if (dest != REG_RZ)
+                        emit_store_field(e, EAX, layout.registers[dest]);
+                return EMIT_CONTINUE;
+        case OP_WRITE:
+                if (!emit_load_operand(e, layout, EAX, arg_0))
+                        return EMIT_UNSUPPORTED;
+                emit_clamp(e, EAX);
+                if (!emit_load_operand(e, layout, ECX, arg_1))
+                        return EMIT_UNSUPPORTED;
+                emit_cmp_imm(e, ECX, STACK_START);
+                e.bail_if(CC_AE);
+                emit_store_indexed(e, EAX, ECX, layout.program_mem);
+                return EMIT_CONTINUE;
+        case OP_READ:
+                if (!is_writable(arg_0) || !emit_load_operand(e, layout, ECX, arg_1))
+                        return EMIT_UNSUPPORTED;
+                emit_cmp_imm(e, ECX, STACK_START);
+                e.bail_if(CC_AE);
+                emit_load_indexed(e, EAX, ECX, layout.program_mem);
+                emit_update_register(e, layout, dest);
+                return EMIT_CONTINUE;
+        default:
+                // I/O, RAND, EXIT and invalid opcodes
+                return EMIT_UNSUPPORTED;
+        }
+}
+
+Jit_Engine::Jit_Engine(CPU_Handle &cpu_handle)
+        : cpu_handle(cpu_handle),
+          blocks(cpu_handle.prog_size, nullptr),
+          attempted(cpu_handle.prog_size, false),
+          arenas(),
+          arena_used(JIT_ARENA_SIZE),
+          enabled(true)
+{
+        const char *base = (const char*)&cpu_handle;
+        for (int i = 0; i < NUM_REGISTERS; ++i)
+                layout.registers[i] = (int32_t)((const char*)&cpu_handle.registers[i] - base);
+        layout.call_stack_ptr = (int32_t)((const char*)&cpu_handle.call_stack_ptr - base);
+        layout.memory = (int32_t)((const char*)&cpu_handle.memory - base);
+        layout.call_stack = (int32_t)offsetof(CPU_Memory, call_stack);
+        layout.program_mem = (int32_t)offsetof(CPU_Memory, program_mem);
+}
+
+Jit_Engine::~Jit_Engine() {
+        for (uint8_t *arena : arenas)
+                munmap(arena, JIT_ARENA_SIZE);
+}
+
+Jit_Block Jit_Engine::block_at(const int16_t address) {
+        if (!attempted[address]) {
+                attempted[address] = true;
+                if (enabled)
+                        blocks[address] = compile_block(address);
+        }
+        return blocks[address];
+}
+
+Jit_Block Jit_Engine::compile_block(const int16_t address) {
+        const Decoded_Instruction *decoded_program = cpu_handle.decoded_program;
+        Jit_Emitter e;
+        int16_t curr_address = address;
+        int num_compiled = 0;
+        bool ended = false;
+
+        emit_load_memory_base(e, layout.memory);
+        while (!ended) {
+                if (curr_address < 0 || curr_address >= cpu_handle.prog_size) {
+                        // ran off the end, the interpreter raises the error
+                        emit_exit(e, curr_address);
+                        break;
+                }
+                if (num_compiled == JIT_MAX_BLOCK_LENGTH) {
+                        emit_exit(e, curr_address);
+                        break;
+                }
+                const Decoded_Instruction &ins = decoded_program[curr_address];
+                size_t code_mark = e.code.size();
+                size_t bail_mark = e.bail_sites.size();
+                e.curr_address = curr_address;
+
+                switch (emit_instruction(e, layout, ins, address)) {
+                case EMIT_UNSUPPORTED:
+                        e.code.resize(code_mark);
+                        e.bail_sites.resize(bail_mark);
+                        if (num_compiled == 0)
+                                return nullptr;
+                        emit_exit(e, curr_address | JIT_INTERPRET);
+                        ended = true;
+                        break;
+                case EMIT_CONTINUE:
+                        num_compiled++;
+                        curr_address = ins.next_pc;
+                        break;
+                case EMIT_END:
+                        num_compiled++;
+                        ended = true;
+                        break;
+                }
+        }
+
+        // one bail out per instruction that has checks
+        size_t site_idx = 0;
+        while (site_idx < e.bail_sites.size()) {
+                int16_t bail_address = e.bail_sites[site_idx].second;
+                size_t stub = e.code.size();
+                emit_exit(e, bail_address | JIT_INTERPRET);
+                while (site_idx < e.bail_sites.size()
+                        && e.bail_sites[site_idx].second == bail_address) {
+                        e.patch(e.bail_sites[site_idx].first, stub);
+                        site_idx++;
+                }
+        }
+        return install(e.code);
+}
+
+Jit_Block Jit_Engine::install(const std::vector<uint8_t> &code) {
+        if (arena_used + code.size() > JIT_ARENA_SIZE) {
+                void *arena = mmap(nullptr, JIT_ARENA_SIZE, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (arena == MAP_FAILED) {
+                        // keep going with the interpreter
+                        enabled = false;
+                        return nullptr;
+                }
+                arenas.push_back((uint8_t*)arena);
+                arena_used = 0;
+        }
+        // never writable and executable at the same time
+        uint8_t *arena = arenas.back();
+        if (mprotect(arena, JIT_ARENA_SIZE, PROT_READ | PROT_WRITE) != 0) {
+                enabled = false;
+                return nullptr;
+        }
+        uint8_t *start = arena + arena_used;
+        memcpy(start, code.data(), code.size());
+        // keep blocks 16 byte aligned
+        arena_used += (code.size() + 15) & ~(size_t)15;
+        if (mprotect(arena, JIT_ARENA_SIZE, PROT_READ | PROT_EXEC) != 0) {
+                enabled = false;
+                return nullptr;
+        }
+        Jit_Block block;
+        memcpy(&block, &start, sizeof(block));
+        return block;
+}
+
+Run_Result CPU_Handle::run_program_jit() {
+        // only run_program counts instructions
+        if (has_limits())
+                return run_program();
+        try {
+                run_jit();
+        } catch (const Runtime_Fault &fault) {
+                return get_run_result(fault.error_code);
+        }
+        return get_run_result(NO_RUNTIME_ERROR);
+}
+
+void CPU_Handle::run_jit() {
+        int16_t &prog_ctr = registers[REG_RIP];
+        // compiled code uses memory directly, not through the pages
+        own_all_pages();
+        Jit_Engine jit(*this);
+        if (prog_ctr == 0)
+                prog_ctr = get_program_data(4);
+
+        while (true) {
+                if (prog_ctr < 0 || prog_ctr >= prog_size) {
+                        handle_runtime_error(UNKNOWN_OPCODE);
+                }
+                Jit_Block block = jit.block_at(prog_ctr);
+                if (block) {
+                        int32_t result = block(this);
+                        prog_ctr = (int16_t)(result & 0xffff);
+                        if (!(result & JIT_INTERPRET))
+                                continue;
+                }
+                // not compiled, or stopped by a check, so do it the slow way
+                const Decoded_Instruction &ins = decoded_program[prog_ctr];
+                ins.base_handler(*this, ins);
+                if (ins.opcode == OP_EXIT)
+                        break;
+        }
+}
+
+#else
+
+Jit_Engine::Jit_Engine(CPU_Handle &cpu_handle)
+        : cpu_handle(cpu_handle), layout(), blocks(), attempted(), arenas(),
+          arena_used(0), enabled(false)
+{
+}
+
+Jit_Engine::~Jit_Engine() {
+}
+
+Jit_Block Jit_Engine::block_at(const int16_t address) {
+        (void)address;
+        return nullptr;
+}
+
+Jit_Block Jit_Engine::compile_block(const int16_t address) {
+        (void)address;
+        return nullptr;
+}
+
+Jit_Block Jit_Engine::install(const std::vector<uint8_t> &code) {
+        (void)code;
+        return nullptr;
+}
+
+// no native code on this platform, so every instruction is interpreted
+Run_Result CPU_Handle::run_program_jit() {
+        return run_program();
+}
+
+#endif
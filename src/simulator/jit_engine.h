@@ -0,0 +1,85 @@
+#ifndef JIT_ENGINE_H
+#define JIT_ENGINE_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../instruction_types.h"
+
+class CPU_Handle;
+
+/**
+ * @brief native code of one compiled block, called with the running CPU_Handle
+ * @details returns the PAL address to continue from. If JIT_INTERPRET is
+ * set, the instruction at that address has to be run by the interpreter
+ * before the next block is entered
+ */
+typedef int32_t (*Jit_Block)(CPU_Handle *cpu_handle);
+
+/**
+ * @brief flag in the result of a Jit_Block, see Jit_Block
+ */
+const int32_t JIT_INTERPRET = 1 << 16;
+
+/**
+ * @brief byte offsets of the CPU_Handle members the native code reaches
+ * @details registers, call_stack_ptr and memory are relative to the
+ * CPU_Handle passed to the block, call_stack and program_mem to the
+ * CPU_Memory it points to. Registers are indexed like Register_Enum. RZ
+ * and RIP are never read from memory
+ */
+struct Jit_Layout {
+        int32_t registers[NUM_REGISTERS];
+        int32_t call_stack_ptr;
+        int32_t memory;
+        int32_t call_stack;
+        int32_t program_mem;
+};
+
+/**
+ * @brief compiles and caches the blocks of one loaded program
+ * @details a block is the straight line of instructions starting at some
+ * address, up to the first jump, CALL, RET, or instruction that only the
+ * interpreter runs (I/O, RAND, EXIT). Blocks are compiled the first time
+ * they're entered, and live until the Jit_Engine is destroyed
+ */
+class Jit_Engine {
+        CPU_Handle &cpu_handle;
+        Jit_Layout layout;
+        std::vector<Jit_Block> blocks; /** compiled block of each address */
+        std::vector<bool> attempted;   /** whether an address was compiled yet */
+        std::vector<uint8_t*> arenas;  /** executable mmap regions */
+        size_t arena_used;             /** bytes used in arenas.back() */
+        bool enabled;                  /** false when code can't be mapped */
+public:
+        Jit_Engine(CPU_Handle &cpu_handle);
+        ~Jit_Engine();
+        Jit_Engine(const Jit_Engine &other) = delete;
+        Jit_Engine &operator=(const Jit_Engine &other) = delete;
+        Jit_Block block_at(const int16_t address);
+private:
+        Jit_Block compile_block(const int16_t address);
+        Jit_Block install(const std::vector<uint8_t> &code);
+};
+
+/**
+ * @fn Jit_Block Jit_Engine::block_at(const int16_t address)
+ * @brief gets the block starting at address, compiling it if needed
+ * @details returns nullptr if the instruction at address can't be compiled,
+ * in which case the interpreter has to run it
+ */
+
+/**
+ * @fn Jit_Block Jit_Engine::compile_block(const int16_t address)
+ * @brief translates the instructions starting at address to x86-64
+ * @details helper function of Jit_Engine::block_at
+ */
+
+/**
+ * @fn Jit_Block Jit_Engine::install(const std::vector<uint8_t> &code)
+ * @brief copies compiled code into an executable region
+ * @details helper function of Jit_Engine::compile_block
+ */
+
+#endif
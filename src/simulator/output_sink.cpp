@@ -0,0 +1,112 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+#ifdef _WIN32
+#include <cstdio>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "output_sink.h"
+
+/**
+ * @brief whether stdout is a terminal
+ * @details helper function of Output_Sink::set_stream
+ */
+static bool is_stdout_terminal() {
+#ifdef _WIN32
+        return _isatty(_fileno(stdout));
+#else
+        return isatty(STDOUT_FILENO);
+#endif
+}
+
+Output_Sink::Output_Sink() {
+        stream = &std::cout;
+        buffer = new char[OUTPUT_SINK_SIZE];
+        used = 0;
+        line_buffered = is_stdout_terminal();
+        flushed = 0;
+        byte_limit = UINT64_MAX;
+}
+
+Output_Sink::~Output_Sink() {
+        delete[] buffer;
+        buffer = nullptr;
+}
+
+Output_Sink::Output_Sink(Output_Sink &&other) noexcept
+        : stream(&std::cout),
+          buffer(nullptr),
+          used(0),
+          line_buffered(false),
+          flushed(0),
+          byte_limit(UINT64_MAX)
+{
+        *this = std::move(other);
+}
+
+Output_Sink &Output_Sink::operator=(Output_Sink &&other) noexcept {
+        if (this == &other)
+                return *this;
+        // swap, so other frees whatever this held before
+        std::swap(stream, other.stream);
+        std::swap(buffer, other.buffer);
+        std::swap(used, other.used);
+        std::swap(line_buffered, other.line_buffered);
+        std::swap(flushed, other.flushed);
+        std::swap(byte_limit, other.byte_limit);
+        return *this;
+}
+
+void Output_Sink::set_stream(std::ostream &given_stream) {
+        flush();
+        stream = &given_stream;
+        line_buffered = stream == &std::cout && is_stdout_terminal();
+}
+
+std::ostream &Output_Sink::get_stream() const {
+        return *stream;
+}
+
+void Output_Sink::put_string(const char *data, const size_t length) {
+        if (used + length > OUTPUT_SINK_SIZE)
+                flush();
+        if (length >= OUTPUT_SINK_SIZE) {
+                // wouldn't fit anyway
+                write_out(data, length);
+        } else {
+                std::memcpy(buffer + used, data, length);
+                used += length;
+        }
+        if (line_buffered && std::memchr(data, '\n', length))
+                flush();
+}
+
+void Output_Sink::flush() {
+        if (used != 0)
+                write_out(buffer, used);
+        used = 0;
+        stream->flush();
+}
+
+void Output_Sink::set_byte_limit(const uint64_t limit) {
+        byte_limit = limit;
+}
+
+uint64_t Output_Sink::bytes_written() const {
+        return flushed + used;
+}
+
+void Output_Sink::write_out(const char *data, const size_t length) {
+        uint64_t allowed = 0;
+        if (flushed < byte_limit)
+                allowed = (length < byte_limit - flushed) ? length : byte_limit - flushed;
+        if (allowed != 0)
+                stream->write(data, (std::streamsize)allowed);
+        flushed += length;
+}
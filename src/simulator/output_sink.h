@@ -0,0 +1,129 @@
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H 1
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+/**
+ * @brief bytes an Output_Sink holds before it writes them out
+ */
+const size_t OUTPUT_SINK_SIZE = 1 << 16;
+
+/**
+ * @brief buffers everything the simulated program prints
+ * @details PRINT, CPRINT and SPRINT append to one buffer instead of going
+ * through iostream formatting on every call, and the buffer is written to
+ * the stream in one piece when it's full or flush is called. CPU_Handle
+ * flushes it on EXIT, before INPUT and SINPUT read, and at the end of
+ * every run. A line buffered sink also flushes after every newline
+ */
+class Output_Sink {
+        std::ostream *stream;
+        char *buffer;       /** OUTPUT_SINK_SIZE bytes */
+        size_t used;        /** bytes of buffer not written out yet */
+        bool line_buffered;
+        uint64_t flushed;    /** bytes put before the ones in buffer */
+        uint64_t byte_limit; /** bytes past this many are dropped */
+
+        void write_out(const char *data, const size_t length);
+public:
+        Output_Sink();
+        ~Output_Sink();
+        Output_Sink(Output_Sink &&other) noexcept;
+        Output_Sink &operator=(Output_Sink &&other) noexcept;
+        Output_Sink(const Output_Sink &other) = delete;
+        Output_Sink &operator=(const Output_Sink &other) = delete;
+        void set_stream(std::ostream &given_stream);
+        std::ostream &get_stream() const;
+        void put_char(const char letter);
+        void put_int(const int16_t value);
+        void put_word(const int16_t value);
+        void put_string(const char *data, const size_t length);
+        void flush();
+        void set_byte_limit(const uint64_t limit);
+        uint64_t bytes_written() const;
+};
+
+/**
+ * @fn Output_Sink::Output_Sink()
+ * @brief an empty sink on std::cout
+ */
+
+/**
+ * @fn Output_Sink::Output_Sink(Output_Sink &&other)
+ * @brief takes over the buffer and stream of other
+ * @details other is left without a buffer, and can only be destroyed or
+ * assigned to. Nothing is flushed on destruction, see flush
+ */
+
+/**
+ * @fn void Output_Sink::set_stream(std::ostream &given_stream)
+ * @brief flushes what's buffered, then writes to given_stream
+ * @details line buffered if given_stream is std::cout and stdout is a
+ * terminal, so prompts show up before the program waits
+ */
+
+/**
+ * @fn std::ostream &Output_Sink::get_stream() const
+ * @brief the stream buffered output goes to
+ */
+
+/**
+ * @fn void Output_Sink::put_int(const int16_t value)
+ * @brief appends value in decimal, same as std::ostream would
+ */
+
+/**
+ * @fn void Output_Sink::put_word(const int16_t value)
+ * @brief appends value as two bytes, low byte first
+ */
+
+/**
+ * @fn void Output_Sink::flush()
+ * @brief writes out everything buffered, then flushes the stream
+ */
+
+/**
+ * @fn void Output_Sink::write_out(const char *data, const size_t length)
+ * @brief writes data to the stream, up to byte_limit
+ * @details helper function of put_string and flush
+ */
+
+/**
+ * @fn void Output_Sink::set_byte_limit(const uint64_t limit)
+ * @brief only the first limit bytes ever put reach the stream
+ * @details the rest are still counted by bytes_written, so the caller can
+ * tell the limit was passed. No limit by default
+ */
+
+/**
+ * @fn uint64_t Output_Sink::bytes_written() const
+ * @brief bytes put since the sink was made, dropped ones included
+ */
+
+inline void Output_Sink::put_char(const char letter) {
+        if (used == OUTPUT_SINK_SIZE)
+                flush();
+        buffer[used++] = letter;
+        if (line_buffered && letter == '\n')
+                flush();
+}
+
+inline void Output_Sink::put_int(const int16_t value) {
+        // "-32768" is the longest an int16_t gets
+        if (used + 6 > OUTPUT_SINK_SIZE)
+                flush();
+        std::to_chars_result result = std::to_chars(buffer + used, buffer + OUTPUT_SINK_SIZE, value);
+        used = (size_t)(result.ptr - buffer);
+}
+
+inline void Output_Sink::put_word(const int16_t value) {
+        if (used + 2 > OUTPUT_SINK_SIZE)
+                flush();
+        buffer[used++] = (char)(value & 255);
+        buffer[used++] = (char)((value >> 8) & 255);
+}
+
+#endif
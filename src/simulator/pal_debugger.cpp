@@ -1,8 +1,10 @@
+#include <algorithm>
 #include <cctype>
 #include <cstdint>
 #include <iomanip>
 #include <iostream>
 #include <map>
+#include <string>
 #include <vector>
 
 #include "../instruction_types.h"
@@ -13,89 +15,105 @@
 #define BOLD "\x1b[1m"
 #define CLEAR "\x1b[0m"
 
-extern std::map<std::string, Instruction_Data> BLUEPRINTS;
-
-void pdb_handle_break(
+bool pdb_handle_break(
         const std::vector<std::string> &cmd_tokens,
-        std::vector<int16_t> &breakpoints,
-        const std::vector<int16_t> &mnemonic_addrs
+        Debug_Breakpoints &breakpoints
 ) {
-        if (cmd_tokens.size() != 2) {
+        if (cmd_tokens.size() < 2) {
                 std::cout << "argument required\n";
-                return;
+                return false;
         }
 
         // if subcommand is "list", list breakpoints and quit
         if (cmd_tokens.at(1) == "list") {
                 std::cout << "breakpoints:\n";
-                for (int16_t address : breakpoints) {
-                        std::cout << "#" <<  address << "\n";
+                for (int16_t address : breakpoints.list_breakpoints()) {
+                        std::cout << breakpoints.describe_breakpoint(address) << "\n";
                 }
-                return;
+                return true;
         }
 
         // check if breakpoint points to an address with an opcode
-        int16_t awaiting = (int16_t)std::stoi(cmd_tokens.at(1));
-        bool is_valid = false;
-        for (int16_t address : mnemonic_addrs) {
-                if (awaiting == address) {
-                        is_valid = true;
-                        break;
-                }
-        }
-        if (!is_valid) {
-                std::cout << awaiting << " is not a valid breakpoint\n";
-                return;
+        const std::string &address_arg = cmd_tokens.at(1);
+        int number = -1;
+        if (!parse_debug_number(address_arg, number) || !breakpoints.can_break_at((int16_t)number)) {
+                std::cout << address_arg << " is not a valid breakpoint\n";
+                return false;
         }
+        int16_t awaiting = (int16_t)number;
 
-        // check if breakpoint already exists
-        for (int16_t address : breakpoints) {
-                if (awaiting == address) {
-                        std::cout << "breakpoint already exists\n";
-                        break;
+        if (cmd_tokens.size() == 2) {
+                breakpoints.add_breakpoint(awaiting);
+        } else {
+                std::vector<std::string> condition_tokens(cmd_tokens.begin() + 2, cmd_tokens.end());
+                Break_Condition condition;
+                if (!parse_break_condition(condition_tokens, condition)) {
+                        std::cout << "expected a condition like: if RA > 50\n";
+                        return false;
                 }
+                breakpoints.add_breakpoint(awaiting, condition);
         }
+        std::cout << "added " << breakpoints.describe_breakpoint(awaiting) << "\n";
+        return true;
+}
 
-        breakpoints.push_back(awaiting);
-        std::cout << "added " << awaiting << "\n";
+bool pdb_handle_checkpoint(
+        const std::vector<std::string> &cmd_tokens,
+        const CPU_Handle &cpu_handle
+) {
+        if (cmd_tokens.size() != 2) {
+                std::cout << "checkpoint expects a file\n";
+                return false;
+        }
+        if (!cpu_handle.save_checkpoint(cmd_tokens.at(1))) {
+                std::cout << "failed to write " << cmd_tokens.at(1) << "\n";
+                return false;
+        }
+        std::cout << "saved checkpoint to " << cmd_tokens.at(1) << "\n";
+        return true;
 }
 
-void pdb_handle_delete(
+bool pdb_handle_delete(
         const std::vector<std::string> &cmd_tokens,
-        std::vector<int16_t> &breakpoints
+        Debug_Breakpoints &breakpoints
 ) {
         if (cmd_tokens.size() != 2) {
                 // delete all breakpoints
-                breakpoints.clear();
+                breakpoints.clear_breakpoints();
                 std::cout << "all breakpoints deleted\n";
-                return;
+                return true;
         }
         // remove address from breakpoints
-        int16_t condemned = (int16_t)std::stoi(cmd_tokens.at(1));
-        for (size_t i = 0; i < breakpoints.size(); ++i) {
-                if (breakpoints[i] == condemned) {
-                        breakpoints.erase(breakpoints.begin() + i);
-                        std::cout << "deleted #" << condemned << "\n";
-                        break;
-                }
+        int condemned = -1;
+        if (!parse_debug_number(cmd_tokens.at(1), condemned)
+                || !breakpoints.remove_breakpoint((int16_t)condemned)) {
+                std::cout << "no breakpoint at " << cmd_tokens.at(1) << "\n";
+                return false;
         }
+        std::cout << "deleted #" << condemned << "\n";
+        return true;
 }
 
 void pdb_handle_help() {
         // if you're wondering why I don't just use std::endl, it's because
         // I'm trying to prevent stdout flushing every single line
-        std::cout << BOLD "break" CLEAR " <program address>\n";
-        std::cout << "    set a breakpoint at a specified address, which halts execution\n";
+        std::cout << BOLD "break" CLEAR " <program address> [if <value> <comparison> <number>]\n";
+        std::cout << "    set a breakpoint at a specified address, which halts execution.\n";
+        std::cout << "    with if, only halts when the comparison holds, e.g. break 120 if RA > 50\n";
+        std::cout << BOLD "checkpoint" CLEAR " <file>\n";
+        std::cout << "    save the program's state, to resume with --restore\n";
         std::cout << BOLD "clear" CLEAR "\n";
         std::cout << "    clear the console\n";
         std::cout << BOLD "continue" CLEAR "\n";
-        std::cout << "    continue program execution until EXIT or next breakpoint\n";
+        std::cout << "    continue program execution until EXIT, the next breakpoint, or a\n";
+        std::cout << "    write to a watched address\n";
         std::cout << BOLD "delete" CLEAR " <program address>\n";
         std::cout << "    delete breakpoint at a specified address\n";
         std::cout << BOLD "help" CLEAR "\n";
         std::cout << "    show this help screen\n";
-        std::cout << BOLD "disassemble" CLEAR "\n";
-        std::cout << "    show disassembled program.\n";
+        std::cout << BOLD "disassemble" CLEAR " [<first address> [<last address>]]\n";
+        std::cout << "    show disassembled program, or only its instructions from first to last.\n";
+        std::cout << "    labels are shown by name, unless the program is a binary\n";
         std::cout << BOLD "list" CLEAR "\n";
         std::cout << "    show the next instruction to be performed\n";
         std::cout << "    useful for debugging branching instructions and SPRINT\n";
@@ -104,10 +122,41 @@ void pdb_handle_help() {
         std::cout << BOLD "print" CLEAR " <register|stack offset|ram address>\n";
         std::cout << "    print value in program's memory\n";
         std::cout << BOLD "quit" CLEAR "\n";
-        std::cout << "    quit debugger and program execution\n\n";
+        std::cout << "    quit debugger and program execution\n";
+        std::cout << BOLD "record" CLEAR " [stop]\n";
+        std::cout << "    log continue too, so reverse-next can go back past it. slower\n";
+        std::cout << BOLD "reverse-continue" CLEAR "\n";
+        std::cout << "    go back until the previous breakpoint, or as far as is recorded\n";
+        std::cout << BOLD "reverse-next" CLEAR " <count>\n";
+        std::cout << "    go back one instruction, or count of them. next and continue\n";
+        std::cout << "    then replay what was undone. output and input aren't undone\n";
+        std::cout << BOLD "unwatch" CLEAR " <ram address|stack offset>\n";
+        std::cout << "    delete a watchpoint, or all of them\n";
+        std::cout << BOLD "watch" CLEAR " <ram address|stack offset>\n";
+        std::cout << "    halt after any instruction writes the address\n\n";
 }
 
-void pdb_handle_disassemble(const CPU_Handle &cpu_handle) {
+bool pdb_handle_disassemble(
+        const std::vector<std::string> &cmd_tokens,
+        const CPU_Handle &cpu_handle,
+        const Disassembly &disassembly
+) {
+        // a range skips the header and string data
+        if (cmd_tokens.size() > 1) {
+                int16_t bounds[2] = {0, (int16_t)(cpu_handle.get_prog_size() - 1)};
+                for (size_t i = 1; i < cmd_tokens.size() && i <= 2; ++i) {
+                        int bound = 0;
+                        if (!parse_debug_number(cmd_tokens.at(i), bound) || bound < 0 || cmd_tokens.size() > 3) {
+                                std::cout << "expected program addresses, as in disassemble 200 260\n";
+                                return false;
+                        }
+                        bounds[i - 1] = (int16_t)bound;
+                }
+                if (disassembly.print_range(std::cout, bounds[0], bounds[1]) == 0)
+                        std::cout << "no instructions from " << bounds[0] << " to " << bounds[1] << "\n";
+                return true;
+        }
+
         Program_State_Enum curr_state = READING_ENTRY_LABEL;
         const int16_t header[4] = {
                 cpu_handle.get_program_data(0),
@@ -136,14 +185,9 @@ void pdb_handle_disassemble(const CPU_Handle &cpu_handle) {
         // it's only going to see mnemonics afterwards
 
 
-        // auxiliary variables
-        int16_t opcode;
-        int16_t ins_len;
-
         // start at 4 to skip magic numbers
         int16_t curr_str_idx = 0;
         int16_t int_idx = 4;
-        std::vector<int16_t> instruction = {};
         while (int_idx < cpu_handle.get_prog_size()) {
                 int16_t curr_int = cpu_handle.get_program_data(int_idx);
                 switch (curr_state) {
@@ -156,15 +200,9 @@ void pdb_handle_disassemble(const CPU_Handle &cpu_handle) {
                         int_idx++;
                         break;
                 case READING_MNEMONIC:
-                        opcode = cpu_handle.get_program_data(int_idx);
-                        ins_len = (int16_t)BLUEPRINTS.at(get_mnem_name(opcode)).length;
-                        for (int16_t i = 0; i < ins_len; ++i) {
-                                int16_t curr_element = cpu_handle.get_program_data(int_idx + i);
-                                instruction.push_back(curr_element);
-                        }
-                        disassemble_print_instruction(instruction, int_idx);
-                        int_idx += ins_len;
-                        break;
+                        // every instruction is already disassembled
+                        disassembly.print_range(std::cout, int_idx, (int16_t)(cpu_handle.get_prog_size() - 1));
+                        return true;
                 case READING_STR:
                         // keep int_idx here: not all control paths return at end
                         disassemble_print_chars(curr_int, int_idx, curr_str_idx, curr_state); // &
@@ -173,8 +211,8 @@ void pdb_handle_disassemble(const CPU_Handle &cpu_handle) {
                 default: /* impossible */
                         break;
                 }
-                instruction.clear();
         }
+        return true;
 }
 
 void pdb_handle_print(
@@ -187,12 +225,12 @@ void pdb_handle_print(
         }
 
         std::map<std::string, int16_t*> reg_addr_map = {
-                {"RA", &cpu_handle.reg_a},      {"RB", &cpu_handle.reg_b},
-                {"RC", &cpu_handle.reg_c},      {"RD", &cpu_handle.reg_d},
-                {"RE", &cpu_handle.reg_e},      {"RF", &cpu_handle.reg_f},
-                {"RG", &cpu_handle.reg_g},      {"RH", &cpu_handle.reg_h},
-                {"RH", &cpu_handle.reg_cmp_a},  {"RH", &cpu_handle.reg_cmp_b},
-                {"RSP", &cpu_handle.stack_ptr}, {"RIP", &cpu_handle.prog_ctr}
+                {"RA", &cpu_handle.registers[REG_RA]},    {"RB", &cpu_handle.registers[REG_RB]},
+                {"RC", &cpu_handle.registers[REG_RC]},    {"RD", &cpu_handle.registers[REG_RD]},
+                {"RE", &cpu_handle.registers[REG_RE]},    {"RF", &cpu_handle.registers[REG_RF]},
+                {"RG", &cpu_handle.registers[REG_RG]},    {"RH", &cpu_handle.registers[REG_RH]},
+                {"RH", &cpu_handle.registers[REG_CMP0]},  {"RH", &cpu_handle.registers[REG_CMP1]},
+                {"RSP", &cpu_handle.registers[REG_RSP]},  {"RIP", &cpu_handle.registers[REG_RIP]}
         };
 
         std::string requested = cmd_tokens.at(1);
@@ -204,17 +242,17 @@ void pdb_handle_print(
                                 break;
                         temp += requested.at(i);
                 }
-                if (temp.empty()) {
+                if (temp.empty() || temp.length() > 5) {
                         std::cout << "No valid value provided to offset\n";
                         return;
                 }
                 int16_t value = (int16_t)std::stoi(temp);
-                if (value < 0 || value >= cpu_handle.stack_ptr) {
+                if (value < 0 || value >= cpu_handle.registers[REG_RSP]) {
                         std::cout << "Cannot access stack with offset outside [0,stack_ptr - 1]\n";
                 } else {
                         std::cout << requested << " = ";
                         // CPU_Handle see dereference_value
-                        std::cout << cpu_handle.program_mem[STACK_START + cpu_handle.stack_ptr - value - 1] << "\n";
+                        std::cout << cpu_handle.read_ram(STACK_START + cpu_handle.registers[REG_RSP] - value - 1) << "\n";
                 }
         } else if (requested.at(0) == '[') {
                 // mem address: expect [%num]
@@ -224,7 +262,7 @@ void pdb_handle_print(
                                 break;
                         temp += requested.at(i);
                 }
-                if (temp.empty()) {
+                if (temp.empty() || temp.length() > 5) {
                         std::cout << "No valid value provided to address\n";
                         return;
                 }
@@ -233,7 +271,7 @@ void pdb_handle_print(
                         std::cout << "Cannot access mem value outside [0," << STACK_SIZE << "]\n";
                 } else {
                         std::cout << requested << " = ";
-                        std::cout << cpu_handle.program_mem[value] << "\n";
+                        std::cout << cpu_handle.read_ram(value) << "\n";
                 }
         } else if (reg_addr_map.find(requested) != reg_addr_map.end()) {
                 // print register value
@@ -244,6 +282,93 @@ void pdb_handle_print(
         }
 }
 
+bool pdb_handle_reverse(
+        const std::vector<std::string> &cmd_tokens,
+        CPU_Handle &cpu_handle,
+        Debug_History &history,
+        const Debug_Breakpoints &breakpoints,
+        const Disassembly &disassembly
+) {
+        bool is_continue = cmd_tokens.front() == "reverse-continue";
+        int num_steps = 1;
+        if (!is_continue && cmd_tokens.size() == 2) {
+                // allow 1+ steps, same as next
+                if (!parse_debug_number(cmd_tokens.at(1), num_steps)) {
+                        std::cout << "expected a count, as in reverse-next 3\n";
+                        return false;
+                }
+                num_steps = (num_steps >= 1) ? num_steps : 1;
+        }
+        if (!history.can_undo()) {
+                std::cout << "no earlier instruction to go back to\n";
+                return false;
+        }
+
+        int num_undone = 0;
+        while (history.can_undo() && (is_continue || num_undone < num_steps)) {
+                history.undo(cpu_handle);
+                num_undone++;
+                if (is_continue && breakpoints.should_break(cpu_handle, cpu_handle.get_prog_ctr()))
+                        break;
+        }
+        if (!history.can_undo() && (is_continue || num_undone < num_steps))
+                std::cout << "reached the oldest recorded instruction\n";
+
+        // print next instruction to run
+        std::cout << disassembly.get_line(cpu_handle.get_prog_ctr()) << "\n";
+        return true;
+}
+
+bool pdb_handle_watch(
+        const std::vector<std::string> &cmd_tokens,
+        const CPU_Handle &cpu_handle,
+        Debug_Breakpoints &breakpoints
+) {
+        bool is_unwatch = cmd_tokens.front() == "unwatch";
+        if (is_unwatch && cmd_tokens.size() == 1) {
+                breakpoints.clear_watches();
+                std::cout << "all watchpoints deleted\n";
+                return true;
+        }
+        if (cmd_tokens.size() != 2) {
+                std::cout << "argument required\n";
+                return false;
+        }
+        if (!is_unwatch && cmd_tokens.at(1) == "list") {
+                std::cout << "watchpoints:\n";
+                for (int16_t address : breakpoints.list_watches())
+                        std::cout << "[$" << address << "]\n";
+                return true;
+        }
+
+        // a stack offset is watched where it points now
+        Decoded_Operand operand;
+        if (!parse_debug_operand(cmd_tokens.at(1), operand) || operand.kind == OPERAND_REGISTER) {
+                std::cout << "expected a ram address like [$5], or a stack offset like %0\n";
+                return false;
+        }
+        int16_t address = operand.value;
+        if (operand.kind == OPERAND_STACK_OFFSET) {
+                int16_t stack_ptr = cpu_handle.read_register(REG_RSP);
+                if (operand.value >= stack_ptr) {
+                        std::cout << "Cannot access stack with offset outside [0,stack_ptr - 1]\n";
+                        return false;
+                }
+                address = (int16_t)(STACK_START + stack_ptr - operand.value - 1);
+        }
+
+        if (!is_unwatch) {
+                breakpoints.add_watch(address);
+                std::cout << "watching [$" << address << "]\n";
+        } else if (breakpoints.remove_watch(address)) {
+                std::cout << "deleted watchpoint [$" << address << "]\n";
+        } else {
+                std::cout << "no watchpoint at [$" << address << "]\n";
+                return false;
+        }
+        return true;
+}
+
 void disassemble_print_chars(
         const int16_t &curr_int,
         const int16_t &int_idx,
@@ -287,27 +412,26 @@ void disassemble_print_chars(
                 std::cout << higher;
 }
 
-void disassemble_print_instruction(
+std::string disassemble_instruction(
         const std::vector<int16_t> &instruction,
-        const int16_t &prog_ctr
+        const int16_t &prog_ctr,
+        const std::map<int16_t, std::string> &symbols
 ) {
-        std::string out_string;
         std::stringstream out_stream;
 
         // first, the mnemoinc
         int16_t opcode = instruction.at(0);
-        std::string mnem_name = get_mnem_name(opcode);
+        const Instruction_Data &curr_instruction = get_instruction(opcode);
         out_stream << "#" << std::right << std::setw(4) << prog_ctr << ": ";
-        out_stream << std::left << std::setw(7) << mnem_name;
+        out_stream << std::left << std::setw(7) << curr_instruction.mnem_name;
 
         const std::string REG_DEREFERENCE[13] = {
                 "RZ", "RA", "RB", "RC", "RD", "RE", "RF", "RG",
-                "RSP", "RIP", "CMP0", "CMP1"
+                "RH", "RSP", "RIP", "CMP0", "CMP1"
         };
 
         // second, the arguments
-        Instruction_Data curr_instruction = BLUEPRINTS.at(mnem_name);
-        size_t ins_size = BLUEPRINTS.at(mnem_name).length;
+        size_t ins_size = curr_instruction.length;
         for (size_t arg_idx = 1; arg_idx < ins_size; ++arg_idx) {
                 std::string arg_string;
                 std::stringstream arg_stream;
@@ -315,7 +439,14 @@ void disassemble_print_instruction(
                 Atom_Type arg_type = curr_instruction.blueprint.at(arg_idx);
 
                 int16_t addr_bits = (curr_arg >> 12) & 7;
-                if ((curr_arg >> 14) == 1 || curr_arg < 0) {
+                if (arg_type == LABEL) {
+                        // label, by name if known. no addressing bits,
+                        // so high addresses don't read as literals
+                        if (symbols.count(curr_arg))
+                                arg_stream << symbols.at(curr_arg);
+                        else
+                                arg_stream << "#" << curr_arg;
+                } else if ((curr_arg >> 14) == 1 || curr_arg < 0) {
                         // literal bitmask
                         if (curr_arg >= 0)
                                 curr_arg ^= (int16_t)(4 << 12);
@@ -337,11 +468,11 @@ void disassemble_print_instruction(
                         curr_arg ^= (int16_t)(3 << 12);
                         arg_stream << "#";
                         arg_stream << curr_arg;
-                } else if (arg_type == REGISTER && 0 <= curr_arg && curr_arg < 14) {
-                        // register idx
+                } else if (curr_arg < 13) {
+                        // register idx, as a register or a source
                         arg_stream << REG_DEREFERENCE[curr_arg];
                 } else {
-                        // label
+                        // bad register idx
                         arg_stream << "#";
                         arg_stream << curr_arg;
                 }
@@ -349,7 +480,5 @@ void disassemble_print_instruction(
                 out_stream << std::right << std::setw(8) << arg_string;
         }
 
-        // print instruction buffer
-        out_string = out_stream.str();
-        std::cout << out_string << "\n";
+        return out_stream.str();
 }
@@ -2,30 +2,52 @@
 #define PAL_DEBUGGER_H 1
 
 #include <cstdint>
+#include <map>
 #include <string>
 #include <vector>
 
 #include "cpu_handle.h"
+#include "debug_breakpoints.h"
+#include "debug_history.h"
+#include "disassembly.h"
 
 // series of functions for the Pal Debugger
 
+/**
+ * @brief symbols of a program with no labels known, like a binary
+ */
+const std::map<int16_t, std::string> NO_SYMBOLS = {};
+
 /**
  * @brief handle break command for PAL Debugger
- * @details helper function of CPU_Handle::run_program_debug
+ * @details "break <address>", optionally followed by a condition, as in
+ * "break 120 if RA > 50". Returns false if no breakpoint could be set.
+ * helper function of CPU_Handle::run_program_debug
  */
-void pdb_handle_break(
+bool pdb_handle_break(
         const std::vector<std::string> &cmd_tokens,
-        std::vector<int16_t> &breakpoints,
-        const std::vector<int16_t> &mnemonic_addrs
+        Debug_Breakpoints &breakpoints
+);
+
+/**
+ * @brief handle checkpoint command for PAL Debugger
+ * @details saves the program's state to the given file, see
+ * CPU_Handle::save_checkpoint. Returns false if it wasn't written.
+ * helper function of CPU_Handle::run_program_debug
+ */
+bool pdb_handle_checkpoint(
+        const std::vector<std::string> &cmd_tokens,
+        const CPU_Handle &cpu_handle
 );
 
 /**
  * @brief handle delete command for PAL Debugger
- * @details helper function of CPU_Handle::run_program_debug
+ * @details returns false if there's no breakpoint at the address given.
+ * helper function of CPU_Handle::run_program_debug
  */
-void pdb_handle_delete(
+bool pdb_handle_delete(
         const std::vector<std::string> &cmd_tokens,
-        std::vector<int16_t> &breakpoints
+        Debug_Breakpoints &breakpoints
 );
 
 /**
@@ -37,9 +59,16 @@ void pdb_handle_help();
 /**
  * @brief print disassembled program, along with addresses
  * @details debugging only function: mostly used for branching instruction
- * debugging. Reason this is not a member method is to keep modules seperate
+ * debugging. Reason this is not a member method is to keep modules seperate.
+ * "disassemble <first> <last>" prints only the instructions in between,
+ * and "disassemble <first>" those from first on, both from disassembly.
+ * Returns false if the addresses aren't numbers
  */
-void pdb_handle_disassemble(const CPU_Handle &cpu_handle);
+bool pdb_handle_disassemble(
+        const std::vector<std::string> &cmd_tokens,
+        const CPU_Handle &cpu_handle,
+        const Disassembly &disassembly
+);
 
 /**
  * @brief handle print command for PAL Debugger
@@ -50,6 +79,33 @@ void pdb_handle_print(
         CPU_Handle &cpu_handle
 );
 
+/**
+ * @brief handle reverse-next and reverse-continue commands for PAL Debugger
+ * @details undoes steps of history, one, n, or until a breakpoint. Stops
+ * early at the oldest step history still has. Returns false, having
+ * undone nothing, if the count isn't a number or there's nothing to undo.
+ * helper function of CPU_Handle::run_program_debug
+ */
+bool pdb_handle_reverse(
+        const std::vector<std::string> &cmd_tokens,
+        CPU_Handle &cpu_handle,
+        Debug_History &history,
+        const Debug_Breakpoints &breakpoints,
+        const Disassembly &disassembly
+);
+
+/**
+ * @brief handle watch and unwatch commands for PAL Debugger
+ * @details watch takes a ram address or stack offset, resolved to the
+ * address it points at now. Returns false if nothing was watched or
+ * unwatched. helper function of CPU_Handle::run_program_debug
+ */
+bool pdb_handle_watch(
+        const std::vector<std::string> &cmd_tokens,
+        const CPU_Handle &cpu_handle,
+        Debug_Breakpoints &breakpoints
+);
+
 /**
  * @brief prints string from string data
  * @detail helper function of pdb_handle_disassemble. arguments come from
@@ -63,12 +119,15 @@ void disassemble_print_chars(
 );
 
 /**
- * @brief prints next instruction, in a similar format to pdb_handle_disassemble
- * @details helper function of CPU_Handle::run_program in debug mode
+ * @brief an instruction as pdb_handle_disassemble prints it, without the newline
+ * @details label arguments found in symbols are shown by name, the rest
+ * by address. helper function of Disassembly, also used by the --profile
+ * report and --read-trace
  */
-void disassemble_print_instruction(
+std::string disassemble_instruction(
         const std::vector<int16_t> &instruction,
-        const int16_t &prog_ctr
+        const int16_t &prog_ctr,
+        const std::map<int16_t, std::string> &symbols
 );
 
 #endif
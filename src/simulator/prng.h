@@ -0,0 +1,69 @@
+#ifndef PRNG_H
+#define PRNG_H 1
+
+#include <cstdint>
+
+/**
+ * @brief xoshiro256** generator, one per CPU_Handle, for RAND
+ * @details seeded through splitmix64, so any seed works, 0 included.
+ * Copying it copies where the sequence is at
+ */
+struct Prng {
+        uint64_t state[4];
+
+        void seed(const uint64_t seed_value);
+        uint64_t next();
+        int16_t next_in_range(const int16_t low, const int16_t high);
+};
+
+/**
+ * @fn void Prng::seed(const uint64_t seed_value)
+ * @brief restarts the sequence, the same one for the same seed_value
+ */
+
+/**
+ * @fn uint64_t Prng::next()
+ * @brief the next 64 random bits
+ */
+
+/**
+ * @fn int16_t Prng::next_in_range(const int16_t low, const int16_t high)
+ * @brief uniform between low and high, both included
+ * @details draws that would favour the low end of the range are thrown
+ * out, so every value is equally likely
+ */
+
+inline void Prng::seed(const uint64_t seed_value) {
+        uint64_t mixer = seed_value;
+        for (uint64_t &word : state) {
+                mixer += 0x9e3779b97f4a7c15;
+                uint64_t bits = mixer;
+                bits = (bits ^ (bits >> 30)) * 0xbf58476d1ce4e5b9;
+                bits = (bits ^ (bits >> 27)) * 0x94d049bb133111eb;
+                word = bits ^ (bits >> 31);
+        }
+}
+
+inline uint64_t Prng::next() {
+        const uint64_t result = ((state[1] * 5) << 7 | (state[1] * 5) >> 57) * 9;
+        const uint64_t shifted = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= shifted;
+        state[3] = (state[3] << 45) | (state[3] >> 19);
+        return result;
+}
+
+inline int16_t Prng::next_in_range(const int16_t low, const int16_t high) {
+        const uint64_t span = (uint64_t)(high - low) + 1;
+        // largest multiple of span, so the modulo below isn't biased
+        const uint64_t limit = UINT64_MAX - UINT64_MAX % span;
+        uint64_t bits = next();
+        while (bits >= limit)
+                bits = next();
+        return (int16_t)(low + (int64_t)(bits % span));
+}
+
+#endif
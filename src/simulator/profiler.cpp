@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../instruction_types.h"
+#include "cpu_handle.h"
+#include "pal_debugger.h"
+#include "profiler.h"
+
+// --profile: CPU_Handle::run_program_profiled, and the report it feeds
+
+/**
+ * @brief straight line run of instructions that always run together
+ */
+struct Profile_Block {
+        int16_t first;     ///< address of the first instruction
+        int16_t last;      ///< address of the last instruction
+        size_t length;     ///< instructions in the block
+        uint64_t entries;  ///< times the block ran
+};
+
+/**
+ * @brief loop found from a back edge
+ */
+struct Profile_Loop {
+        int16_t head;          ///< address the back edge jumps to
+        int16_t back_edge;     ///< address of the jump back
+        uint64_t iterations;   ///< times the back edge was taken
+        uint64_t instructions; ///< instructions run inside, nested loops included
+};
+
+Run_Result CPU_Handle::run_program_profiled(Profile &profile) {
+        // carries on counting if the same program ran profiled before
+        if (profile.executions.size() != (size_t)prog_size) {
+                profile.executions.assign(prog_size, 0);
+                profile.taken.assign(prog_size, 0);
+        }
+        uint64_t *executions = profile.executions.data();
+        uint64_t *taken = profile.taken.data();
+        int16_t &prog_ctr = registers[REG_RIP];
+        try {
+                if (prog_ctr == 0)
+                        prog_ctr = get_program_data(4);
+                while (true) {
+                        if (prog_ctr < 0 || prog_ctr >= prog_size) {
+                                handle_runtime_error(UNKNOWN_OPCODE);
+                        }
+                        const int16_t address = prog_ctr;
+                        const Decoded_Instruction &ins = decoded_program[address];
+                        executions[address]++;
+                        // one instruction at a time, so not the fused handler
+                        ins.base_handler(*this, ins);
+                        if (prog_ctr != ins.next_pc)
+                                taken[address]++;
+                        if (ins.opcode == OP_EXIT)
+                                break;
+                }
+        } catch (const Runtime_Fault &fault) {
+                return get_run_result(fault.error_code);
+        }
+        return get_run_result(NO_RUNTIME_ERROR);
+}
+
+/**
+ * @brief disassembles the instruction at address
+ * @details helper function of write_profile_report
+ */
+static std::string profile_line(const CPU_Handle &cpu_handle, const int16_t address) {
+        const int16_t opcode = cpu_handle.get_program_data(address);
+        const size_t ins_len = get_instruction(opcode).length;
+        std::vector<int16_t> instruction = {};
+        for (size_t i = 0; i < ins_len; ++i)
+                instruction.push_back(cpu_handle.get_program_data((int16_t)(address + i)));
+        return disassemble_instruction(instruction, address, NO_SYMBOLS);
+}
+
+/**
+ * @brief whether the instruction can go anywhere but next_pc
+ * @details helper function of find_blocks
+ */
+static bool ends_block(const Decoded_Instruction &ins) {
+        return (ins.opcode >= OP_JMP && ins.opcode <= OP_RET) || ins.opcode == OP_EXIT;
+}
+
+/**
+ * @brief splits every instruction that ran into basic blocks
+ * @details a block carries on through next_pc for as long as the next
+ * instruction ran exactly as often, so it can't have been jumped into.
+ * helper function of write_profile_report
+ */
+static std::vector<Profile_Block> find_blocks(const CPU_Handle &cpu_handle, const Profile &profile) {
+        std::vector<Profile_Block> blocks;
+        const int16_t prog_size = cpu_handle.get_prog_size();
+        // a block starts wherever the instruction before it doesn't lead in
+        std::vector<bool> is_continued(prog_size, false);
+        for (int16_t address = 0; address < prog_size; ++address) {
+                const Decoded_Instruction &ins = cpu_handle.decoded_instruction(address);
+                if (profile.executions[address] == 0 || ends_block(ins))
+                        continue;
+                if (ins.next_pc < prog_size
+                        && profile.executions[ins.next_pc] == profile.executions[address])
+                        is_continued[ins.next_pc] = true;
+        }
+        for (int16_t address = 0; address < prog_size; ++address) {
+                if (profile.executions[address] == 0 || is_continued[address])
+                        continue;
+                Profile_Block block = {address, address, 1, profile.executions[address]};
+                int16_t curr = address;
+                while (true) {
+                        const Decoded_Instruction &ins = cpu_handle.decoded_instruction(curr);
+                        if (ends_block(ins) || ins.next_pc >= prog_size || !is_continued[ins.next_pc])
+                                break;
+                        curr = ins.next_pc;
+                        block.last = curr;
+                        block.length++;
+                }
+                blocks.push_back(block);
+        }
+        return blocks;
+}
+
+/**
+ * @brief finds a loop for every back edge that was taken
+ * @details helper function of write_profile_report
+ */
+static std::vector<Profile_Loop> find_loops(const CPU_Handle &cpu_handle, const Profile &profile) {
+        std::vector<Profile_Loop> loops;
+        const int16_t prog_size = cpu_handle.get_prog_size();
+        for (int16_t address = 0; address < prog_size; ++address) {
+                const Decoded_Instruction &ins = cpu_handle.decoded_instruction(address);
+                bool is_jump = ins.opcode >= OP_JMP && ins.opcode <= OP_JLS;
+                if (!is_jump || profile.taken[address] == 0 || ins.args[0].kind != OPERAND_LABEL)
+                        continue;
+                const int16_t head = ins.args[0].value;
+                if (head > address || head < 0)
+                        continue;
+                Profile_Loop loop = {head, address, profile.taken[address], 0};
+                for (int16_t inside = head; inside <= address; ++inside)
+                        loop.instructions += profile.executions[inside];
+                loops.push_back(loop);
+        }
+        return loops;
+}
+
+/**
+ * @brief share of total, as a percentage with one decimal
+ * @details helper function of write_profile_report
+ */
+static std::string profile_share(const uint64_t part, const uint64_t total) {
+        std::stringstream aux_stream;
+        double share = (total == 0) ? 0.0 : 100.0 * (double)part / (double)total;
+        aux_stream << std::fixed << std::setprecision(1) << std::setw(5) << share << "%";
+        return aux_stream.str();
+}
+
+bool write_profile_report(
+        const std::string &file_path,
+        const CPU_Handle &cpu_handle,
+        const Profile &profile
+) {
+        std::ofstream report(file_path);
+        if (report.fail())
+                return false;
+
+        uint64_t total = 0;
+        std::vector<int16_t> addresses;
+        for (size_t address = 0; address < profile.executions.size(); ++address) {
+                total += profile.executions[address];
+                if (profile.executions[address] != 0)
+                        addresses.push_back((int16_t)address);
+        }
+        report << "--- Profile: " << total << " instructions run ---\n";
+
+        std::stable_sort(addresses.begin(), addresses.end(), [&profile](int16_t a, int16_t b) {
+                return profile.executions[a] > profile.executions[b];
+        });
+        report << "\n--- Hottest Instructions ---\n";
+        for (size_t i = 0; i < addresses.size() && i < PROFILE_REPORT_SIZE; ++i) {
+                const int16_t address = addresses[i];
+                report << std::right << std::setw(12) << profile.executions[address] << " ";
+                report << profile_share(profile.executions[address], total) << "  ";
+                report << profile_line(cpu_handle, address);
+                if (profile.taken[address] != 0)
+                        report << "  (taken " << profile.taken[address] << ")";
+                report << "\n";
+        }
+
+        std::vector<Profile_Block> blocks = find_blocks(cpu_handle, profile);
+        std::stable_sort(blocks.begin(), blocks.end(), [](const Profile_Block &a, const Profile_Block &b) {
+                return a.entries * a.length > b.entries * b.length;
+        });
+        report << "\n--- Hottest Blocks ---\n";
+        for (size_t i = 0; i < blocks.size() && i < PROFILE_REPORT_SIZE; ++i) {
+                const Profile_Block &block = blocks[i];
+                report << std::right << std::setw(12) << block.entries * block.length << " ";
+                report << profile_share(block.entries * block.length, total) << "  ";
+                report << "#" << block.first << " to #" << block.last << ", ran ";
+                report << block.entries << " times\n";
+                int16_t address = block.first;
+                for (size_t j = 0; j < block.length; ++j) {
+                        report << std::setw(21) << "" << profile_line(cpu_handle, address) << "\n";
+                        address = cpu_handle.decoded_instruction(address).next_pc;
+                }
+        }
+
+        std::vector<Profile_Loop> loops = find_loops(cpu_handle, profile);
+        std::stable_sort(loops.begin(), loops.end(), [](const Profile_Loop &a, const Profile_Loop &b) {
+                return a.instructions > b.instructions;
+        });
+        report << "\n--- Hottest Loops ---\n";
+        for (size_t i = 0; i < loops.size() && i < PROFILE_REPORT_SIZE; ++i) {
+                const Profile_Loop &loop = loops[i];
+                report << std::right << std::setw(12) << loop.instructions << " ";
+                report << profile_share(loop.instructions, total) << "  ";
+                report << "#" << loop.head << " to #" << loop.back_edge << ", ";
+                report << loop.iterations << " iterations\n";
+                report << std::setw(21) << "" << profile_line(cpu_handle, loop.back_edge) << "\n";
+        }
+
+        report.close();
+        return !report.fail();
+}
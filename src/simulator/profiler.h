@@ -0,0 +1,39 @@
+#ifndef PROFILER_H
+#define PROFILER_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cpu_handle.h"
+
+/**
+ * @brief what CPU_Handle::run_program_profiled counted
+ * @details both are indexed by program address, and only nonzero at
+ * addresses an instruction starts at
+ */
+struct Profile {
+        std::vector<uint64_t> executions; ///< times the instruction ran
+        std::vector<uint64_t> taken;      ///< times it went anywhere but next_pc
+};
+
+/**
+ * @brief how many of the hottest instructions, blocks and loops a report lists
+ */
+const size_t PROFILE_REPORT_SIZE = 10;
+
+/**
+ * @brief writes the --profile report of a finished run to file_path
+ * @details lists the instructions, basic blocks and loops that ran the most
+ * instructions, disassembled like the debugger's list command. Loops are
+ * found from back edges, jumps to an address at or before their own.
+ * Returns false if the file can't be written
+ */
+bool write_profile_report(
+        const std::string &file_path,
+        const CPU_Handle &cpu_handle,
+        const Profile &profile
+);
+
+#endif
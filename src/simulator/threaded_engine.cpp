@@ -0,0 +1,370 @@
+#include <cstdint>
+#include <vector>
+
+#include "../instruction_types.h"
+#include "cpu_handle.h"
+#include "decoder.h"
+#include "instructions.h"
+
+// direct threaded version of CPU_Handle::run_program
+// every instruction jumps straight into the label of the next one, instead
+// of returning to one shared dispatch. the hot opcodes have their handler
+// bodies copied into their labels, for the operand kinds they're almost
+// always used with, so running one of them is its body plus one goto.
+// everything else still calls its handler from the label.
+// labels as values is a gcc/clang extension, so other compilers use the
+// usual loop
+
+#if defined(__GNUC__) || defined(__clang__)
+
+// bounds check prog_ctr, unless the program was verified, then jump to
+// the handler of the next instruction
+#define DISPATCH()                                                     \
+        do {                                                           \
+                if (CHECKED && (uint16_t)prog_ctr >= (uint16_t)prog_size) \
+                        goto bad_address;                              \
+                ins = &decoded_program[prog_ctr];                      \
+                goto *threaded_code[prog_ctr];                         \
+        } while (0)
+
+// body shared by every handler that doesn't end the program
+#define THREADED_OP(label, handler)                                    \
+        label:                                                         \
+                handler(*this, *ins);                                  \
+                DISPATCH();
+
+// copies of the handler bodies in instructions.cpp, with the operand kinds
+// known. inline_op only picks them for general purpose destinations, which
+// update_register always takes, so its checks are left out
+#define REG(operand) registers[(operand).value]
+#define REG_SRC REG(ins->args[1])
+#define LIT_SRC ins->args[1].value
+
+#define MOV_BODY(src)                                                  \
+        REG(ins->args[0]) = clamp(src);                                \
+        prog_ctr = ins->next_pc;
+
+#define INC_BODY()                                                     \
+        {                                                              \
+                int16_t value = REG(ins->args[0]) + 1;                 \
+                if (value == LIT_MAX_VALUE + 1)                        \
+                        value = LIT_MIN_VALUE;                         \
+                REG(ins->args[0]) = clamp(value);                      \
+                prog_ctr = ins->next_pc;                               \
+        }
+
+#define DEC_BODY()                                                     \
+        {                                                              \
+                int16_t value = REG(ins->args[0]) - 1;                 \
+                if (value == LIT_MIN_VALUE - 1)                        \
+                        value = LIT_MAX_VALUE;                         \
+                REG(ins->args[0]) = clamp(value);                      \
+                prog_ctr = ins->next_pc;                               \
+        }
+
+#define ARITHMETIC_BODY(op, src)                                       \
+        {                                                              \
+                int16_t value = REG(ins->args[0]) op (src);            \
+                REG(ins->args[0]) = clamp(value);                      \
+                prog_ctr = ins->next_pc;                               \
+        }
+
+// both operands are read before either compare register is written, as
+// either of them could be one
+#define CMP_BODY(src)                                                  \
+        {                                                              \
+                const int16_t src_1 = clamp(REG(ins->args[0]));        \
+                const int16_t src_2 = clamp(src);                      \
+                registers[REG_CMP0] = src_1;                           \
+                registers[REG_CMP1] = src_2;                           \
+                prog_ctr = ins->next_pc;                               \
+        }
+
+#define JUMP_OP(label, cond)                                           \
+        label:                                                         \
+                if (registers[REG_CMP0] cond registers[REG_CMP1])      \
+                        prog_ctr = ins->args[0].value;                 \
+                else                                                   \
+                        prog_ctr = ins->next_pc;                       \
+                DISPATCH();
+
+// steps to the next instruction of a fused sequence. fuse_program only
+// fuses instructions that are all inside the program
+#define NEXT_IN_SEQUENCE() ins = &decoded_program[prog_ctr]
+
+// a fused sequence ends on its conditional jump, which dispatches itself
+#define END_SEQUENCE(fusion)                                           \
+        fusion_counts[fusion]++;                                       \
+        NEXT_IN_SEQUENCE();                                            \
+        goto *threaded_code[prog_ctr];
+
+/**
+ * @brief the opcodes and operand kinds run_threaded has inlined labels for
+ */
+enum Inline_Op : uint8_t {
+        INLINE_NONE = 0,
+        INLINE_MOV_REG,
+        INLINE_MOV_LIT,
+        INLINE_INC,
+        INLINE_DEC,
+        INLINE_ADD_REG,
+        INLINE_ADD_LIT,
+        INLINE_SUB_REG,
+        INLINE_SUB_LIT,
+        INLINE_CMP_REG,
+        INLINE_CMP_LIT,
+        NUM_INLINE_OPS,
+};
+
+/**
+ * @brief picks the inlined label that runs ins, if there is one
+ * @details INLINE_NONE leaves ins to its handler. Destinations have to be
+ * one of RA through RH, and sources a register or a literal
+ */
+static Inline_Op inline_op(const Decoded_Instruction &ins) {
+        const Decoded_Operand &first = ins.args[0];
+        const Decoded_Operand &second = ins.args[1];
+        const bool general_dest = first.kind == OPERAND_REGISTER
+                && first.value >= REG_RA && first.value <= REG_RH;
+        const bool reg_src = second.kind == OPERAND_REGISTER;
+        const bool lit_src = second.kind == OPERAND_LITERAL;
+        switch (ins.opcode) {
+        case OP_MOV:
+                if (general_dest && (reg_src || lit_src))
+                        return reg_src ? INLINE_MOV_REG : INLINE_MOV_LIT;
+                break;
+        case OP_INC:
+                if (general_dest)
+                        return INLINE_INC;
+                break;
+        case OP_DEC:
+                if (general_dest)
+                        return INLINE_DEC;
+                break;
+        case OP_ADD:
+                if (general_dest && (reg_src || lit_src))
+                        return reg_src ? INLINE_ADD_REG : INLINE_ADD_LIT;
+                break;
+        case OP_SUB:
+                if (general_dest && (reg_src || lit_src))
+                        return reg_src ? INLINE_SUB_REG : INLINE_SUB_LIT;
+                break;
+        case OP_CMP:
+                // CMP only reads its first operand
+                if (first.kind == OPERAND_REGISTER && (reg_src || lit_src))
+                        return reg_src ? INLINE_CMP_REG : INLINE_CMP_LIT;
+                break;
+        default:
+                break;
+        }
+        return INLINE_NONE;
+}
+
+Run_Result CPU_Handle::run_program_threaded() {
+        // only run_program counts instructions
+        if (has_limits())
+                return run_program();
+        try {
+                if (verified)
+                        run_threaded<false>();
+                else
+                        run_threaded<true>();
+        } catch (const Runtime_Fault &fault) {
+                return get_run_result(fault.error_code);
+        }
+        return get_run_result(NO_RUNTIME_ERROR);
+}
+
+template <bool CHECKED>
+void CPU_Handle::run_threaded() {
+        static void *const OPCODE_LABELS[NUM_OPCODES + 1] = {
+                &&do_nop,   &&do_mov,    &&do_inc,    &&do_dec,
+                &&do_add,   &&do_sub,    &&do_mul,    &&do_div,
+                &&do_mod,   &&do_and,    &&do_or,     &&do_not,
+                &&do_xor,   &&do_lsh,    &&do_rsh,    &&do_cmp,
+                &&do_jmp,   &&do_jeq,    &&do_jne,    &&do_jge,
+                &&do_jgr,   &&do_jle,    &&do_jls,    &&do_call,
+                &&do_ret,   &&do_push,   &&do_pop,    &&do_write,
+                &&do_read,  &&do_print,  &&do_sprint, &&do_cprint,
+                &&do_input, &&do_sinput, &&do_rand,   &&do_exit,
+                &&do_invalid,
+        };
+
+        static void *const INLINE_LABELS[NUM_INLINE_OPS] = {
+                nullptr,
+                &&do_mov_reg, &&do_mov_lit,
+                &&do_inc_reg, &&do_dec_reg,
+                &&do_add_reg, &&do_add_lit,
+                &&do_sub_reg, &&do_sub_lit,
+                &&do_cmp_reg, &&do_cmp_lit,
+        };
+
+        // resolve each address to its label once, up front
+        // fused sequences made of inlined instructions get a label that runs
+        // them all, other fused sequences go through their handler from
+        // fuse_program, and the rest of the opcodes with operands through
+        // the one from specialise_program
+        std::vector<void*> threaded_code(prog_size);
+        for (int16_t address = 0; address < prog_size; ++address) {
+                const Decoded_Instruction &curr = decoded_program[address];
+                const Inline_Op op = inline_op(curr);
+                if (curr.fusion == FUSION_CMP_JUMP && op == INLINE_CMP_REG) {
+                        threaded_code[address] = &&do_cmp_reg_jump;
+                } else if (curr.fusion == FUSION_CMP_JUMP && op == INLINE_CMP_LIT) {
+                        threaded_code[address] = &&do_cmp_lit_jump;
+                } else if (curr.fusion == FUSION_STEP_CMP_JUMP && op != INLINE_NONE) {
+                        const Inline_Op cmp = inline_op(decoded_program[curr.next_pc]);
+                        if (cmp == INLINE_CMP_REG)
+                                threaded_code[address] = op == INLINE_INC
+                                        ? &&do_inc_cmp_reg_jump : &&do_dec_cmp_reg_jump;
+                        else if (cmp == INLINE_CMP_LIT)
+                                threaded_code[address] = op == INLINE_INC
+                                        ? &&do_inc_cmp_lit_jump : &&do_dec_cmp_lit_jump;
+                        else
+                                threaded_code[address] = &&do_fused;
+                } else if (curr.fusion != FUSION_NONE) {
+                        threaded_code[address] = &&do_fused;
+                } else if (op != INLINE_NONE) {
+                        threaded_code[address] = INLINE_LABELS[op];
+                } else {
+                        threaded_code[address] = OPCODE_LABELS[curr.opcode];
+                }
+        }
+
+        int16_t &prog_ctr = registers[REG_RIP];
+        const Decoded_Instruction *ins = nullptr;
+        if (prog_ctr == 0)
+                prog_ctr = get_program_data(4);
+        DISPATCH();
+
+do_mov_reg:
+        MOV_BODY(REG_SRC)
+        DISPATCH();
+do_mov_lit:
+        MOV_BODY(LIT_SRC)
+        DISPATCH();
+do_inc_reg:
+        INC_BODY()
+        DISPATCH();
+do_dec_reg:
+        DEC_BODY()
+        DISPATCH();
+do_add_reg:
+        ARITHMETIC_BODY(+, REG_SRC)
+        DISPATCH();
+do_add_lit:
+        ARITHMETIC_BODY(+, LIT_SRC)
+        DISPATCH();
+do_sub_reg:
+        ARITHMETIC_BODY(-, REG_SRC)
+        DISPATCH();
+do_sub_lit:
+        ARITHMETIC_BODY(-, LIT_SRC)
+        DISPATCH();
+do_cmp_reg:
+        CMP_BODY(REG_SRC)
+        DISPATCH();
+do_cmp_lit:
+        CMP_BODY(LIT_SRC)
+        DISPATCH();
+
+do_cmp_reg_jump:
+        CMP_BODY(REG_SRC)
+        END_SEQUENCE(FUSION_CMP_JUMP)
+do_cmp_lit_jump:
+        CMP_BODY(LIT_SRC)
+        END_SEQUENCE(FUSION_CMP_JUMP)
+do_inc_cmp_reg_jump:
+        INC_BODY()
+        NEXT_IN_SEQUENCE();
+        CMP_BODY(REG_SRC)
+        END_SEQUENCE(FUSION_STEP_CMP_JUMP)
+do_inc_cmp_lit_jump:
+        INC_BODY()
+        NEXT_IN_SEQUENCE();
+        CMP_BODY(LIT_SRC)
+        END_SEQUENCE(FUSION_STEP_CMP_JUMP)
+do_dec_cmp_reg_jump:
+        DEC_BODY()
+        NEXT_IN_SEQUENCE();
+        CMP_BODY(REG_SRC)
+        END_SEQUENCE(FUSION_STEP_CMP_JUMP)
+do_dec_cmp_lit_jump:
+        DEC_BODY()
+        NEXT_IN_SEQUENCE();
+        CMP_BODY(LIT_SRC)
+        END_SEQUENCE(FUSION_STEP_CMP_JUMP)
+
+do_jmp:
+        prog_ctr = ins->args[0].value;
+        DISPATCH();
+        JUMP_OP(do_jeq, ==)
+        JUMP_OP(do_jne, !=)
+        JUMP_OP(do_jge, >=)
+        JUMP_OP(do_jgr, >)
+        JUMP_OP(do_jle, <=)
+        JUMP_OP(do_jls, <)
+
+        THREADED_OP(do_nop,    ins_nop)
+        THREADED_OP(do_mov,    ins->base_handler)
+        THREADED_OP(do_inc,    ins->base_handler)
+        THREADED_OP(do_dec,    ins->base_handler)
+        THREADED_OP(do_add,    ins->base_handler)
+        THREADED_OP(do_sub,    ins->base_handler)
+        THREADED_OP(do_mul,    ins->base_handler)
+        THREADED_OP(do_div,    ins->base_handler)
+        THREADED_OP(do_mod,    ins->base_handler)
+        THREADED_OP(do_and,    ins->base_handler)
+        THREADED_OP(do_or,     ins->base_handler)
+        THREADED_OP(do_not,    ins->base_handler)
+        THREADED_OP(do_xor,    ins->base_handler)
+        THREADED_OP(do_lsh,    ins->base_handler)
+        THREADED_OP(do_rsh,    ins->base_handler)
+        THREADED_OP(do_cmp,    ins->base_handler)
+        THREADED_OP(do_call,   ins_call)
+        THREADED_OP(do_ret,    ins_ret)
+        THREADED_OP(do_push,   ins->base_handler)
+        THREADED_OP(do_pop,    ins_pop)
+        THREADED_OP(do_write,  ins->base_handler)
+        THREADED_OP(do_read,   ins->base_handler)
+        THREADED_OP(do_print,  ins->base_handler)
+        THREADED_OP(do_sprint, ins->base_handler)
+        THREADED_OP(do_cprint, ins->base_handler)
+        THREADED_OP(do_input,  ins_input)
+        THREADED_OP(do_sinput, ins_sinput)
+        THREADED_OP(do_rand,   ins_rand)
+        THREADED_OP(do_fused,  ins->handler)
+
+do_exit:
+        ins_exit(*this, *ins);
+        return;
+
+do_invalid:
+        ins_invalid(*this, *ins);
+        return;
+
+bad_address:
+        handle_runtime_error(UNKNOWN_OPCODE);
+}
+
+#undef END_SEQUENCE
+#undef NEXT_IN_SEQUENCE
+#undef JUMP_OP
+#undef CMP_BODY
+#undef ARITHMETIC_BODY
+#undef DEC_BODY
+#undef INC_BODY
+#undef MOV_BODY
+#undef LIT_SRC
+#undef REG_SRC
+#undef REG
+#undef THREADED_OP
+#undef DISPATCH
+
+#else
+
+Run_Result CPU_Handle::run_program_threaded() {
+        return run_program();
+}
+
+#endif
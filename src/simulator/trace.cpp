@@ -0,0 +1,324 @@
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../instruction_types.h"
+#include "cpu_handle.h"
+#include "decoder.h"
+#include "pal_debugger.h"
+#include "trace.h"
+
+// --trace: CPU_Handle::run_program_traced, Trace_Writer, and the
+// --read-trace reader. See Trace_Writer for the layout
+
+static const int16_t TRACE_MAGIC[4] = {'P', 'T', 'R', 'C'};
+static const int16_t TRACE_VERSION = 1;
+
+/**
+ * @brief most bytes a record takes before its memory writes, and per memory write
+ * @details a varint of up to 32 bits takes 5 bytes
+ */
+static const size_t TRACE_MAX_HEAD = 1 + 5 + NUM_REGISTERS * (1 + 5);
+static const size_t TRACE_MAX_WRITE = 1 + 5 + 5;
+
+Run_Result CPU_Handle::run_program_traced(Trace_Writer &trace) {
+        int16_t &prog_ctr = registers[REG_RIP];
+        std::vector<Memory_Write> memory_writes;
+        int16_t old_registers[NUM_REGISTERS];
+        try {
+                if (prog_ctr == 0)
+                        prog_ctr = get_program_data(4);
+                if (!trace.is_started())
+                        trace.put_header(*this);
+                write_log = &memory_writes;
+                while (true) {
+                        if (prog_ctr < 0 || prog_ctr >= prog_size) {
+                                handle_runtime_error(UNKNOWN_OPCODE);
+                        }
+                        const int16_t address = prog_ctr;
+                        const Decoded_Instruction &ins = decoded_program[address];
+                        std::memcpy(old_registers, registers, sizeof(registers));
+                        memory_writes.clear();
+                        try {
+                                ins.base_handler(*this, ins);
+                        } catch (const Runtime_Fault &) {
+                                // what it wrote before faulting is still written
+                                trace.put_record(ins, address, old_registers, registers, memory_writes);
+                                throw;
+                        }
+                        trace.put_record(ins, address, old_registers, registers, memory_writes);
+                        if (ins.opcode == OP_EXIT)
+                                break;
+                }
+        } catch (const Runtime_Fault &fault) {
+                write_log = nullptr;
+                return get_run_result(fault.error_code);
+        }
+        write_log = nullptr;
+        return get_run_result(NO_RUNTIME_ERROR);
+}
+
+Trace_Writer::Trace_Writer(std::ostream &given_stream) {
+        stream = &given_stream;
+        buffer.resize(TRACE_BUFFER_SIZE);
+        buffer_used = 0;
+        started = false;
+        expected_pc = 0;
+        last_address[SPACE_RAM] = 0;
+        last_address[SPACE_CALL_STACK] = 0;
+}
+
+bool Trace_Writer::is_started() const {
+        return started;
+}
+
+void Trace_Writer::make_room(const size_t num_bytes) {
+        if (buffer_used + num_bytes > buffer.size())
+                flush();
+}
+
+void Trace_Writer::put_byte(const uint8_t byte) {
+        buffer[buffer_used++] = (char)byte;
+}
+
+void Trace_Writer::put_varint(const int32_t value) {
+        uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+        while (zigzag >= 0x80) {
+                put_byte((uint8_t)(zigzag | 0x80));
+                zigzag >>= 7;
+        }
+        put_byte((uint8_t)zigzag);
+}
+
+void Trace_Writer::put_word(const int16_t word) {
+        make_room(2);
+        put_byte((uint8_t)(word & 255));
+        put_byte((uint8_t)((word >> 8) & 255));
+}
+
+void Trace_Writer::put_header(const CPU_Handle &cpu_handle) {
+        for (int16_t word : TRACE_MAGIC)
+                put_word(word);
+        put_word(TRACE_VERSION);
+        const int16_t prog_size = cpu_handle.get_prog_size();
+        put_word(prog_size);
+        for (int16_t i = 0; i < prog_size; ++i)
+                put_word(cpu_handle.get_program_data(i));
+        for (int i = 0; i < NUM_REGISTERS; ++i)
+                put_word(cpu_handle.read_register(i));
+        started = true;
+        expected_pc = cpu_handle.get_prog_ctr();
+}
+
+void Trace_Writer::put_record(
+        const Decoded_Instruction &ins,
+        const int16_t address,
+        const int16_t *old_registers,
+        const int16_t *new_registers,
+        const std::vector<Memory_Write> &memory_writes
+) {
+        // tags of every register it changed, RIP aside
+        uint8_t changed[NUM_REGISTERS];
+        size_t num_changed = 0;
+        for (int i = 0; i < NUM_REGISTERS; ++i) {
+                if (i != REG_RIP && old_registers[i] != new_registers[i])
+                        changed[num_changed++] = (uint8_t)i;
+        }
+        const size_t num_writes = num_changed + memory_writes.size();
+
+        make_room(TRACE_MAX_HEAD);
+        uint8_t head = (uint8_t)ins.opcode;
+        if (address != expected_pc)
+                head |= 0x40;
+        if (num_writes != 0)
+                head |= 0x80;
+        put_byte(head);
+        if (address != expected_pc)
+                put_varint((int32_t)address - expected_pc);
+
+        size_t writes_left = num_writes;
+        for (size_t i = 0; i < num_changed; ++i) {
+                const int reg = changed[i];
+                put_byte(changed[i] | ((--writes_left != 0) ? 0x80 : 0));
+                put_varint((int32_t)new_registers[reg] - old_registers[reg]);
+        }
+        for (const Memory_Write &write : memory_writes) {
+                make_room(TRACE_MAX_WRITE);
+                uint8_t tag = (write.space == SPACE_RAM) ? TRACE_TAG_RAM : TRACE_TAG_CALL_STACK;
+                put_byte(tag | ((--writes_left != 0) ? 0x80 : 0));
+                put_varint((int32_t)write.address - last_address[write.space]);
+                put_varint(write.value);
+                last_address[write.space] = write.address;
+        }
+        expected_pc = ins.next_pc;
+}
+
+bool Trace_Writer::flush() {
+        stream->write(buffer.data(), (std::streamsize)buffer_used);
+        buffer_used = 0;
+        stream->flush();
+        return !stream->fail();
+}
+
+bool parse_trace_filter(const std::string &text, Trace_Filter &filter) {
+        filter = Trace_Filter{-1, -1, -1};
+        if (text.empty())
+                return true;
+        std::string upper = text;
+        for (char &letter : upper)
+                letter = (char)toupper(letter);
+        if (get_opcode(upper) != -1) {
+                filter.opcode = get_opcode(upper);
+                return true;
+        }
+        if (REGISTER_TABLE.count(upper)) {
+                filter.reg_idx = REGISTER_TABLE.at(upper);
+                return true;
+        }
+        // an address, with or without the # the disassembly shows
+        std::string digits = (text[0] == '#') ? text.substr(1) : text;
+        bool is_address = !digits.empty() && digits.length() <= 5;
+        for (char digit : digits)
+                is_address = is_address && isdigit(digit);
+        if (!is_address || std::stoi(digits) > INT16_MAX)
+                return false;
+        filter.address = (int16_t)std::stoi(digits);
+        return true;
+}
+
+/**
+ * @brief reads a byte of the trace, false at the end of the file
+ * @details helper function of print_trace
+ */
+static bool read_byte(std::istream &trace_file, uint8_t &byte) {
+        int next = trace_file.get();
+        if (next == EOF)
+                return false;
+        byte = (uint8_t)next;
+        return true;
+}
+
+/**
+ * @brief reads a little endian word of the header
+ * @details helper function of print_trace
+ */
+static bool read_word(std::istream &trace_file, int16_t &word) {
+        uint8_t lower = 0;
+        uint8_t upper = 0;
+        if (!read_byte(trace_file, lower) || !read_byte(trace_file, upper))
+                return false;
+        word = (int16_t)((upper << 8) | lower);
+        return true;
+}
+
+/**
+ * @brief reads a zigzag varint, written by Trace_Writer::put_varint
+ * @details helper function of print_trace
+ */
+static bool read_varint(std::istream &trace_file, int32_t &value) {
+        uint32_t zigzag = 0;
+        uint8_t byte = 0x80;
+        for (int shift = 0; (byte & 0x80) && shift < 35; shift += 7) {
+                if (!read_byte(trace_file, byte))
+                        return false;
+                zigzag |= (uint32_t)(byte & 0x7f) << shift;
+        }
+        if (byte & 0x80)
+                return false;
+        value = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+        return true;
+}
+
+bool print_trace(const std::string &file_path, const Trace_Filter &filter, std::ostream &out) {
+        std::ifstream trace_file(file_path, std::ios::binary);
+        if (trace_file.fail())
+                return false;
+
+        int16_t word = 0;
+        for (int16_t magic_word : TRACE_MAGIC) {
+                if (!read_word(trace_file, word) || word != magic_word)
+                        return false;
+        }
+        int16_t prog_size = 0;
+        if (!read_word(trace_file, word) || word != TRACE_VERSION
+                || !read_word(trace_file, prog_size) || prog_size < 6)
+                return false;
+        // padded, so the disassembly of a cut off instruction reads zeros
+        std::vector<int16_t> program(prog_size + MAX_INSTRUCTION_LENGTH, 0);
+        for (int16_t i = 0; i < prog_size; ++i) {
+                if (!read_word(trace_file, program[i]))
+                        return false;
+        }
+        int16_t registers[NUM_REGISTERS];
+        for (int16_t &reg : registers) {
+                if (!read_word(trace_file, reg))
+                        return false;
+        }
+
+        const std::string REGISTER_NAMES[NUM_REGISTERS] = {
+                "RZ", "RA", "RB", "RC", "RD", "RE", "RF", "RG",
+                "RH", "RSP", "RIP", "CMP0", "CMP1"
+        };
+        int16_t expected_pc = registers[REG_RIP];
+        int32_t last_address[2] = {0, 0};
+        uint64_t step = 0;
+        uint8_t head = 0;
+        while (read_byte(trace_file, head)) {
+                int16_t opcode = head & 0x3f;
+                int16_t address = expected_pc;
+                int32_t delta = 0;
+                if (head & 0x40) {
+                        if (!read_varint(trace_file, delta))
+                                return false;
+                        address = (int16_t)(expected_pc + delta);
+                }
+                if (address < 0 || address >= prog_size)
+                        return false;
+
+                std::stringstream writes_stream;
+                bool matches = filter.reg_idx == -1;
+                uint8_t tag = (head & 0x80) ? 0x80 : 0;
+                while (tag & 0x80) {
+                        if (!read_byte(trace_file, tag) || !read_varint(trace_file, delta))
+                                return false;
+                        const uint8_t target = tag & 0x7f;
+                        if (target < NUM_REGISTERS) {
+                                registers[target] = (int16_t)(registers[target] + delta);
+                                writes_stream << "  " << REGISTER_NAMES[target] << "=" << registers[target];
+                                matches = matches || target == filter.reg_idx;
+                        } else if (target == TRACE_TAG_RAM || target == TRACE_TAG_CALL_STACK) {
+                                const int space = target - TRACE_TAG_RAM;
+                                int32_t value = 0;
+                                if (!read_varint(trace_file, value))
+                                        return false;
+                                last_address[space] += delta;
+                                writes_stream << "  " << ((space == SPACE_RAM) ? "ram[" : "call[");
+                                writes_stream << last_address[space] << "]=" << value;
+                        } else {
+                                return false;
+                        }
+                }
+                matches = matches && (filter.opcode == -1 || filter.opcode == opcode);
+                matches = matches && (filter.address == -1 || filter.address == address);
+                if (matches) {
+                        out << std::right << std::setw(12) << step << "  ";
+                        if (opcode >= NUM_OPCODES) {
+                                out << "#" << std::right << std::setw(4) << address << ": ???";
+                        } else {
+                                std::vector<int16_t> instruction(program.begin() + address,
+                                        program.begin() + address + get_instruction(opcode).length);
+                                out << disassemble_instruction(instruction, address, NO_SYMBOLS);
+                        }
+                        out << writes_stream.str() << "\n";
+                }
+                expected_pc = decode_instruction(program.data(), prog_size, address).next_pc;
+                step++;
+        }
+        return true;
+}
@@ -0,0 +1,143 @@
+#ifndef TRACE_H
+#define TRACE_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../instruction_types.h"
+#include "cpu_handle.h"
+
+/**
+ * @brief bytes Trace_Writer buffers before writing them out
+ */
+const size_t TRACE_BUFFER_SIZE = 1 << 16;
+
+/**
+ * @brief writes the --trace file of a run, a record per instruction
+ * @details the file starts with a header: magic "PTRC" and the layout
+ * version as little endian words, then prog_size, the program itself, and
+ * every register, so the reader can disassemble and follow along without
+ * the source. Then one record per instruction run:
+ *     a byte with the opcode in the low 6 bits, 0x40 set if the address
+ *     isn't the one the last instruction should have gone to, and 0x80
+ *     set if the instruction wrote anything
+ *     if 0x40, the address, as a varint delta from the expected one
+ *     if 0x80, one entry per write, each a tag byte with 0x80 set on all
+ *     but the last. Tags up to NUM_REGISTERS are registers, followed by
+ *     the varint delta from the register's old value. TRACE_TAG_RAM and
+ *     TRACE_TAG_CALL_STACK are memory, followed by the varint delta from
+ *     the last address written in that space, then the varint value
+ * varints are zigzag LEB128, so small deltas either way take one byte.
+ * RIP is never a write, it's the next record's address
+ */
+class Trace_Writer {
+        std::ostream *stream;
+        std::vector<char> buffer; /** filled up to buffer_used, then written out */
+        size_t buffer_used;
+        bool started; /** whether the header is written */
+        int16_t expected_pc; /** where the last instruction would go without jumping */
+        int16_t last_address[2]; /** last address written, per Memory_Space */
+
+        void make_room(const size_t num_bytes);
+        void put_byte(const uint8_t byte);
+        void put_varint(const int32_t value);
+        void put_word(const int16_t word);
+public:
+        explicit Trace_Writer(std::ostream &given_stream);
+        bool is_started() const;
+        void put_header(const CPU_Handle &cpu_handle);
+        void put_record(
+                const Decoded_Instruction &ins,
+                const int16_t address,
+                const int16_t *old_registers,
+                const int16_t *new_registers,
+                const std::vector<Memory_Write> &memory_writes
+        );
+        bool flush();
+};
+
+/**
+ * @brief tags of a trace record's memory writes, after the register tags
+ */
+const uint8_t TRACE_TAG_RAM = NUM_REGISTERS;
+const uint8_t TRACE_TAG_CALL_STACK = NUM_REGISTERS + 1;
+
+/**
+ * @brief which records --read-trace prints
+ * @details given to --trace-filter as a mnemonic, a register or a program
+ * address. A mnemonic matches its instructions, a register matches the
+ * instructions that wrote it, and an address matches the instruction
+ * there. Empty matches everything
+ */
+struct Trace_Filter {
+        int16_t opcode;   ///< -1 unless a mnemonic was given
+        int16_t reg_idx;  ///< -1 unless a register was given
+        int16_t address;  ///< -1 unless an address was given
+};
+
+/**
+ * @brief parses what --trace-filter was given
+ * @details an empty text gives the filter that matches everything. Returns
+ * false if text isn't a mnemonic, register or address
+ */
+bool parse_trace_filter(const std::string &text, Trace_Filter &filter);
+
+/**
+ * @brief prints every record of a --trace file that filter matches, to out
+ * @details one line per record: its step number, the instruction
+ * disassembled like the debugger's list command, then what it wrote.
+ * Returns false if the file can't be read, or isn't a trace
+ */
+bool print_trace(const std::string &file_path, const Trace_Filter &filter, std::ostream &out);
+
+/**
+ * @fn Trace_Writer::Trace_Writer(std::ostream &given_stream)
+ * @brief writes to given_stream, which has to outlive the writer
+ */
+
+/**
+ * @fn void Trace_Writer::put_header(const CPU_Handle &cpu_handle)
+ * @brief writes the header, with the program and registers of cpu_handle
+ * @details helper function of CPU_Handle::run_program_traced
+ */
+
+/**
+ * @fn void Trace_Writer::put_record(const Decoded_Instruction &ins, const int16_t address, const int16_t *old_registers, const int16_t *new_registers, const std::vector<Memory_Write> &memory_writes)
+ * @brief writes the record of the instruction that just ran at address
+ * @details registers are diffed, old against new, to find the ones it
+ * wrote. helper function of CPU_Handle::run_program_traced
+ */
+
+/**
+ * @fn bool Trace_Writer::flush()
+ * @brief writes out whatever is buffered
+ * @details returns false if the stream has failed, so the trace is
+ * incomplete
+ */
+
+/**
+ * @fn void Trace_Writer::make_room(const size_t num_bytes)
+ * @brief writes the buffer out, unless num_bytes more still fit
+ * @details checked once per record and per memory write, so put_byte
+ * doesn't have to
+ */
+
+/**
+ * @fn void Trace_Writer::put_byte(const uint8_t byte)
+ * @brief buffers one byte, which make_room has to have made room for
+ */
+
+/**
+ * @fn void Trace_Writer::put_varint(const int32_t value)
+ * @brief buffers value zigzag encoded, 7 bits a byte
+ */
+
+/**
+ * @fn void Trace_Writer::put_word(const int16_t word)
+ * @brief buffers a little endian word, for the header
+ */
+
+#endif
@@ -0,0 +1,110 @@
+#include <cstdint>
+#include <vector>
+
+#include "../common_values.h"
+#include "../instruction_types.h"
+#include "decoder.h"
+#include "verifier.h"
+
+bool is_valid_operand(const Decoded_Operand &operand) {
+        switch (operand.kind) {
+        case OPERAND_BAD_REGISTER:
+                return false;
+        case OPERAND_RAM_ADDR:
+                // same range as dereference_value
+                return operand.value >= 0 && operand.value < STACK_START;
+        default:
+                return true;
+        }
+}
+
+/**
+ * @brief marks the SPRINTs that can read their string without bounds checks
+ * @details helper function of verify_program
+ */
+static void prove_strings(
+        const int16_t *program_data,
+        const int16_t prog_size,
+        std::vector<Decoded_Instruction> &decoded_program
+) {
+        // end of the string that starts at each address, -1 if unterminated
+        std::vector<int16_t> string_end(prog_size, -1);
+        int16_t next_terminator = -1;
+        for (int16_t address = prog_size - 1; address >= 0; --address) {
+                if (program_data[address] == 0)
+                        next_terminator = address;
+                string_end[address] = next_terminator;
+        }
+
+        for (Decoded_Instruction &ins : decoded_program) {
+                const Decoded_Operand &str = ins.args[0];
+                ins.proven = ins.opcode == OP_SPRINT
+                        && str.kind == OPERAND_STR_ADDR
+                        && str.value < prog_size
+                        && string_end[str.value] != -1;
+        }
+}
+
+bool verify_program(
+        const int16_t *program_data,
+        const int16_t prog_size,
+        std::vector<Decoded_Instruction> &decoded_program
+) {
+        prove_strings(program_data, prog_size, decoded_program);
+        // header, main address and separator
+        if (prog_size < 6)
+                return false;
+
+        // instruction boundaries, same walk as the debugger
+        std::vector<bool> is_boundary(prog_size, false);
+        int16_t temp_idx = 5; // SA, NT, IA, GO, main
+        while (temp_idx < prog_size && program_data[temp_idx - 1] != (int16_t)0xffff)
+                temp_idx++;
+        while (temp_idx < prog_size) {
+                is_boundary[temp_idx] = true;
+                temp_idx = decoded_program[temp_idx].next_pc;
+        }
+
+        // every address prog_ctr can hold, starting from main
+        std::vector<bool> reached(prog_size, false);
+        std::vector<int16_t> to_visit = {program_data[4]};
+        while (!to_visit.empty()) {
+                int16_t address = to_visit.back();
+                to_visit.pop_back();
+                if (address < 0 || address >= prog_size || !is_boundary[address])
+                        return false;
+                if (reached[address])
+                        continue;
+                reached[address] = true;
+
+                const Decoded_Instruction &ins = decoded_program[address];
+                if (ins.opcode == INVALID_OPCODE)
+                        return false;
+                if (!is_valid_operand(ins.args[0]) || !is_valid_operand(ins.args[1]))
+                        return false;
+
+                switch (ins.opcode) {
+                case OP_EXIT:
+                case OP_RET:
+                        // RET can only go back to the next_pc of a CALL
+                        break;
+                case OP_JMP:
+                        to_visit.push_back(ins.args[0].value);
+                        break;
+                case OP_JEQ:
+                case OP_JNE:
+                case OP_JGE:
+                case OP_JGR:
+                case OP_JLE:
+                case OP_JLS:
+                case OP_CALL:
+                        to_visit.push_back(ins.args[0].value);
+                        to_visit.push_back(ins.next_pc);
+                        break;
+                default:
+                        to_visit.push_back(ins.next_pc);
+                        break;
+                }
+        }
+        return true;
+}
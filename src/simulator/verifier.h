@@ -0,0 +1,33 @@
+#ifndef VERIFIER_H
+#define VERIFIER_H 1
+
+#include <cstdint>
+#include <vector>
+
+#include "decoder.h"
+
+/**
+ * @brief proves what it can about a decoded program before it runs
+ * @details returns true if every address reachable from main is the start
+ * of a valid instruction inside the program, as found by walking the
+ * instruction stream after the string table. Jump, CALL and return
+ * targets are followed, so prog_ctr can't leave the program, and reachable
+ * instructions have no unknown registers or RAM addresses outside the RAM.
+ * Independently, marks every SPRINT whose string is terminated inside the
+ * program as proven, see Decoded_Instruction::proven. Checks that depend
+ * on the stack pointer or a register value are left to the handlers.
+ * helper function of CPU_Handle::load_program
+ */
+bool verify_program(
+        const int16_t *program_data,
+        const int16_t prog_size,
+        std::vector<Decoded_Instruction> &decoded_program
+);
+
+/**
+ * @brief whether operand can be read without a runtime error
+ * @details helper function of verify_program
+ */
+bool is_valid_operand(const Decoded_Operand &operand);
+
+#endif
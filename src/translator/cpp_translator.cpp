@@ -0,0 +1,576 @@
+#include <cstdint>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../common_values.h"
+#include "../instruction_types.h"
+#include "../simulator/cpu_handle.h"
+#include "../simulator/decoder.h"
+#include "cpp_translator.h"
+
+// everything the translated program needs besides its instructions
+// each function matches the simulator function in its comment
+static const char *const RUNTIME_PRELUDE = R"PAL(
+enum Runtime_Error_Enum {
+        STACK_OVERFLOW = 0,
+        STACK_UNDERFLOW,
+        STACK_WRITE_ERROR,
+        CALL_STACK_OVERFLOW,
+        CALL_STACK_UNDERFLOW,
+        IMMUTABLE_MUTATION,
+        INVALID_STACK_OFFSET,
+        UNKNOWN_REGISTER,
+        OOB_ADDRESS,
+        ASCII_ERROR,
+        INPUT_ERROR,
+        UNKNOWN_OPCODE,
+        REPLAY_ERROR,
+};
+
+static int16_t reg[13]; // RZ through CMP1, same idxs as REGISTER_TABLE
+static int16_t call_stack[CALL_STACK_SIZE];
+static int16_t call_stack_ptr;
+static int16_t program_mem[RAM_SIZE];
+
+// handle_runtime_error
+[[noreturn]] static void runtime_error(const Runtime_Error_Enum error_code) {
+        std::cerr << "\x1b[34mRuntime Error:\x1b[0m ";
+        std::cerr << RUNTIME_ERROR_MESSAGES[error_code] << "\n";
+        std::exit(1);
+}
+
+// clamp
+static int16_t clamp(const int16_t value) {
+        if (value > LIT_MAX_VALUE)
+                return LIT_MAX_VALUE;
+        else if (value < LIT_MIN_VALUE)
+                return LIT_MIN_VALUE;
+        return value;
+}
+
+// CPU_Handle::dereference_value, for stack offsets
+static int16_t stack_offset(const int16_t offset) {
+        if (offset > reg[9] || reg[9] <= 0)
+                runtime_error(INVALID_STACK_OFFSET);
+        return program_mem[STACK_START + reg[9] - offset - 1];
+}
+
+// CPU_Handle::dereference_value, for RAM addresses
+static int16_t ram_value(const int16_t address) {
+        if (address < 0 || address >= STACK_START) {
+                std::cout << "ram hotfix\n";
+                runtime_error(INVALID_STACK_OFFSET);
+        }
+        return program_mem[address];
+}
+
+// CPU_Handle::dereference_value, for unknown registers
+static int16_t bad_register() {
+        runtime_error(UNKNOWN_REGISTER);
+}
+
+// CPU_Handle::get_program_data
+static int16_t program_data(const int16_t idx) {
+        if (idx < 0 || idx > PROG_SIZE)
+                runtime_error(UNKNOWN_OPCODE);
+        return PROGRAM_DATA[idx];
+}
+
+// update_register
+static void update_register(const int16_t dest, const int16_t value) {
+        if (dest < 0 || dest > 9)
+                runtime_error(IMMUTABLE_MUTATION);
+        if (dest == 9 && (clamp(value) < 0 || clamp(value) >= STACK_SIZE))
+                runtime_error(STACK_WRITE_ERROR);
+        if (dest != 0)
+                reg[dest] = clamp(value);
+}
+
+// ins_mul, after dereferencing
+static int16_t multiply(const int16_t src_1, const int16_t src_2) {
+        bool expected_positive = (src_1 >= 0) == (src_2 >= 0);
+        int32_t raw_value = src_1 * src_2;
+        if (raw_value < 0 && expected_positive)
+                raw_value *= -1;
+        else if (raw_value > 0 && !expected_positive)
+                raw_value *= -1;
+        if (raw_value > LIT_MAX_VALUE)
+                raw_value = LIT_MAX_VALUE;
+        else if (raw_value < LIT_MIN_VALUE)
+                raw_value = LIT_MIN_VALUE;
+        return (int16_t)raw_value;
+}
+
+// ins_push, after dereferencing
+static void push(const int16_t value) {
+        program_mem[STACK_START + reg[9]] = clamp(value);
+        reg[9]++;
+}
+
+// ins_sprint
+static void sprint(int16_t temp_str_idx) {
+        std::string output;
+        while (program_data(temp_str_idx) != (int16_t)0) {
+                int16_t curr = program_data(temp_str_idx);
+                char lower = (char)(curr & 255);
+                char higher = (char)(curr >> 8);
+                output += lower;
+                if (higher != 0)
+                        output += higher;
+                temp_str_idx++;
+        }
+        // check if sprint string is an ANSI escape code
+        static const std::map<std::string, std::string> ansi_code_map = {
+                {"\\x1b[0m",  "\x1b[0m"},
+                {"\\x1b[30m", "\x1b[30m"}, {"\\x1b[31m", "\x1b[31m"},
+                {"\\x1b[32m", "\x1b[32m"}, {"\\x1b[33m", "\x1b[33m"},
+                {"\\x1b[34m", "\x1b[34m"}, {"\\x1b[35m", "\x1b[35m"},
+                {"\\x1b[36m", "\x1b[36m"}, {"\\x1b[37m", "\x1b[37m"},
+                {"\\x1b[40m", "\x1b[40m"}, {"\\x1b[41m", "\x1b[41m"},
+                {"\\x1b[42m", "\x1b[42m"}, {"\\x1b[43m", "\x1b[43m"},
+                {"\\x1b[44m", "\x1b[44m"}, {"\\x1b[45m", "\x1b[45m"},
+                {"\\x1b[46m", "\x1b[46m"}, {"\\x1b[47m", "\x1b[47m"},
+        };
+        if (ansi_code_map.find(output) != ansi_code_map.end())
+                std::cout << ansi_code_map.at(output);
+        else
+                std::cout << output;
+}
+
+// ins_input
+static void input() {
+        if (reg[9] == STACK_SIZE)
+                runtime_error(STACK_OVERFLOW);
+        int16_t value;
+        std::string user_input;
+        std::getline(std::cin, user_input);
+        if (user_input.length() == 0)
+                user_input = "\n";
+        bool is_ascii_input = (user_input.length() == 1) && isascii(user_input.at(0));
+        if (!isdigit(user_input.at(0)) && is_ascii_input) {
+                value = (int16_t)((char)user_input.at(0));
+        } else {
+                std::stringstream aux_stream;
+                aux_stream << user_input;
+                aux_stream >> value;
+                if (aux_stream.fail())
+                        runtime_error(INPUT_ERROR);
+        }
+        push(value);
+}
+
+// ins_sinput
+static void sinput() {
+        std::string user_input;
+        std::getline(std::cin, user_input);
+        if (user_input.length() == 0)
+                user_input = "\n";
+        for (char i : user_input) {
+                if (reg[9] == STACK_SIZE)
+                        runtime_error(STACK_OVERFLOW);
+                program_mem[STACK_START + reg[9]] = (int16_t)i;
+                reg[9]++;
+        }
+        if (reg[9] == STACK_SIZE)
+                runtime_error(STACK_OVERFLOW);
+        program_mem[STACK_START + reg[9]] = (int16_t)0;
+        reg[9]++;
+}
+
+// Prng, the generator CPU_Handle draws RAND results from
+static uint64_t rand_state[4];
+
+// Prng::seed
+static void rand_seed(const uint64_t seed_value) {
+        uint64_t mixer = seed_value;
+        for (uint64_t &word : rand_state) {
+                mixer += 0x9e3779b97f4a7c15;
+                uint64_t bits = mixer;
+                bits = (bits ^ (bits >> 30)) * 0xbf58476d1ce4e5b9;
+                bits = (bits ^ (bits >> 27)) * 0x94d049bb133111eb;
+                word = bits ^ (bits >> 31);
+        }
+}
+
+// Prng::next
+static uint64_t rand_next() {
+        uint64_t *state = rand_state;
+        const uint64_t result = ((state[1] * 5) << 7 | (state[1] * 5) >> 57) * 9;
+        const uint64_t shifted = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= shifted;
+        state[3] = (state[3] << 45) | (state[3] >> 19);
+        return result;
+}
+
+// Prng::next_in_range
+static int16_t rand_in_range(const int16_t low, const int16_t high) {
+        const uint64_t span = (uint64_t)(high - low) + 1;
+        const uint64_t limit = UINT64_MAX - UINT64_MAX % span;
+        uint64_t bits = rand_next();
+        while (bits >= limit)
+                bits = rand_next();
+        return (int16_t)(low + (int64_t)(bits % span));
+}
+
+// ins_rand, seeded once like CPU_Handle: with --seed, RAND_SEED is defined
+static void rand_push() {
+        static bool is_seeded = false;
+        if (!is_seeded) {
+#ifdef RAND_SEED
+                rand_seed(RAND_SEED);
+#else
+                std::random_device rd;
+                rand_seed(((uint64_t)rd() << 32) | (uint64_t)rd());
+#endif
+                is_seeded = true;
+        }
+        if (reg[9] == STACK_SIZE)
+                runtime_error(STACK_OVERFLOW);
+        program_mem[STACK_START + reg[9]] = rand_in_range(-100, 100);
+        reg[9]++;
+}
+)PAL";
+
+// jump conditions, indexed by opcode, starting at OP_JEQ
+static const char *const JUMP_CONDITIONS[6] = {
+        "==", "!=", ">=", ">", "<=", "<",
+};
+
+// C operators of the two source arithmetic instructions, by opcode
+static const char *binary_operator(const int16_t opcode) {
+        switch (opcode) {
+        case OP_ADD: return "+";
+        case OP_SUB: return "-";
+        case OP_AND: return "&";
+        case OP_OR:  return "|";
+        case OP_XOR: return "^";
+        default:     return nullptr;
+        }
+}
+
+/**
+ * @brief gets the C++ expression that reads operand
+ * @details same result as dereference_value when run at address
+ */
+static std::string operand_expr(const Decoded_Operand &operand, const int16_t address) {
+        std::string value = std::to_string(operand.value);
+        switch (operand.kind) {
+        case OPERAND_LITERAL:
+        case OPERAND_STR_ADDR:
+        case OPERAND_LABEL:
+                return "(int16_t)(" + value + ")";
+        case OPERAND_REGISTER:
+                if (operand.value == 0)
+                        return "(int16_t)0";
+                if (operand.value == 10) // RIP
+                        return "(int16_t)" + std::to_string(address);
+                return "reg[" + value + "]";
+        case OPERAND_STACK_OFFSET:
+                return "stack_offset(" + value + ")";
+        case OPERAND_RAM_ADDR:
+                return "ram_value(" + value + ")";
+        default:
+                return "bad_register()";
+        }
+}
+
+/**
+ * @brief gets the idx update_register is called with, same as dest_index
+ */
+static int16_t dest_index(const Decoded_Operand &operand) {
+        if (operand.kind == OPERAND_REGISTER || operand.kind == OPERAND_BAD_REGISTER)
+                return operand.value;
+        return -1;
+}
+
+/**
+ * @brief gets the statement that continues at target
+ */
+static std::string goto_stmt(const int16_t target, const std::set<int16_t> &block_addrs) {
+        if (block_addrs.count(target) == 0)
+                return "runtime_error(UNKNOWN_OPCODE);";
+        return "goto L_" + std::to_string(target) + ";";
+}
+
+/**
+ * @brief writes the statements of one instruction
+ * @details helper function of translate_program
+ */
+static void translate_instruction(
+        std::stringstream &out,
+        const Decoded_Instruction &ins,
+        const int16_t address,
+        const std::set<int16_t> &block_addrs
+) {
+        std::string src_1 = operand_expr(ins.args[0], address);
+        std::string src_2 = operand_expr(ins.args[1], address);
+        std::string dest = std::to_string(dest_index(ins.args[0]));
+        const std::string indent = "        ";
+
+        switch (ins.opcode) {
+        case OP_NOP:
+                break;
+        case OP_MOV:
+                out << indent << "update_register(" << dest << ", " << src_2 << ");\n";
+                break;
+        case OP_INC:
+        case OP_DEC: {
+                bool is_inc = ins.opcode == OP_INC;
+                out << indent << "{\n";
+                out << indent << "        int16_t value = " << src_1 << (is_inc ? " + 1;\n" : " - 1;\n");
+                if (is_inc)
+                        out << indent << "        if (value == LIT_MAX_VALUE + 1) value = LIT_MIN_VALUE;\n";
+                else
+                        out << indent << "        if (value == LIT_MIN_VALUE - 1) value = LIT_MAX_VALUE;\n";
+                out << indent << "        update_register(" << dest << ", value);\n";
+                out << indent << "}\n";
+                break;
+        }
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_MOD:
+        case OP_AND:
+        case OP_OR:
+        case OP_XOR:
+        case OP_LSH:
+        case OP_RSH:
+                out << indent << "{\n";
+                out << indent << "        int16_t src_1 = " << src_1 << ";\n";
+                out << indent << "        int16_t src_2 = " << src_2 << ";\n";
+                switch (ins.opcode) {
+                case OP_MUL:
+                        out << indent << "        int16_t value = multiply(src_1, src_2);\n";
+                        break;
+                case OP_DIV:
+                case OP_MOD:
+                        out << indent << "        if (src_2 == 0) {\n";
+                        if (ins.opcode == OP_DIV)
+                                out << indent << "                std::cout << \"Warning: Division by Zero. Result will be 0\\n\";\n";
+                        else
+                                out << indent << "                std::cout << \"Warning: Mod by Zero. Result will be 0\\n\";\n";
+                        out << indent << "                src_1 = 0;\n";
+                        out << indent << "                src_2 = 1;\n";
+                        out << indent << "        }\n";
+                        out << indent << "        int16_t value = src_1 " << (ins.opcode == OP_DIV ? "/" : "%") << " src_2;\n";
+                        break;
+                case OP_LSH:
+                case OP_RSH:
+                        out << indent << "        if (src_2 < 0)\n";
+                        out << indent << "                std::cout << \"Warning: Negative Bitshift. Result will be src 1\\n\";\n";
+                        if (ins.opcode == OP_LSH)
+                                out << indent << "        int16_t value = src_1 << (src_2 < 0 ? 0 : src_2);\n";
+                        else
+                                out << indent << "        int16_t value = src_1 >> (src_2 > 0 ? src_2 : 0);\n";
+                        break;
+                default:
+                        out << indent << "        int16_t value = src_1 " << binary_operator(ins.opcode) << " src_2;\n";
+                        break;
+                }
+                out << indent << "        update_register(" << dest << ", value);\n";
+                out << indent << "}\n";
+                break;
+        case OP_NOT:
+                out << indent << "{\n";
+                out << indent << "        int16_t src_1 = " << src_2 << ";\n";
+                out << indent << "        int16_t value = ~src_1;\n";
+                out << indent << "        update_register(" << dest << ", value);\n";
+                out << indent << "}\n";
+                break;
+        case OP_CMP:
+                out << indent << "{\n";
+                out << indent << "        int16_t src_1 = " << src_1 << ";\n";
+                out << indent << "        int16_t src_2 = " << src_2 << ";\n";
+                out << indent << "        reg[11] = clamp(src_1);\n";
+                out << indent << "        reg[12] = clamp(src_2);\n";
+                out << indent << "}\n";
+                break;
+        case OP_JMP:
+                out << indent << goto_stmt(ins.args[0].value, block_addrs) << "\n";
+                break;
+        case OP_JEQ:
+        case OP_JNE:
+        case OP_JGE:
+        case OP_JGR:
+        case OP_JLE:
+        case OP_JLS:
+                out << indent << "if (reg[11] " << JUMP_CONDITIONS[ins.opcode - OP_JEQ] << " reg[12])\n";
+                out << indent << "        " << goto_stmt(ins.args[0].value, block_addrs) << "\n";
+                break;
+        case OP_CALL:
+                out << indent << "if (call_stack_ptr >= CALL_STACK_SIZE)\n";
+                out << indent << "        runtime_error(CALL_STACK_UNDERFLOW);\n";
+                out << indent << "call_stack[call_stack_ptr++] = " << ins.next_pc << ";\n";
+                out << indent << goto_stmt(ins.args[0].value, block_addrs) << "\n";
+                break;
+        case OP_RET:
+                out << indent << "if (call_stack_ptr <= 0)\n";
+                out << indent << "        runtime_error(CALL_STACK_UNDERFLOW);\n";
+                out << indent << "return_addr = call_stack[--call_stack_ptr];\n";
+                out << indent << "goto return_switch;\n";
+                break;
+        case OP_PUSH:
+                out << indent << "if (reg[9] == STACK_SIZE)\n";
+                out << indent << "        runtime_error(STACK_OVERFLOW);\n";
+                out << indent << "push(" << src_1 << ");\n";
+                break;
+        case OP_POP:
+                out << indent << "if (reg[9] <= 0)\n";
+                out << indent << "        runtime_error(STACK_UNDERFLOW);\n";
+                out << indent << "reg[9]--;\n";
+                out << indent << "update_register(" << dest << ", program_mem[STACK_START + reg[9]]);\n";
+                break;
+        case OP_WRITE:
+                out << indent << "{\n";
+                out << indent << "        int16_t value = clamp(" << src_1 << ");\n";
+                out << indent << "        int16_t address = " << src_2 << ";\n";
+                out << indent << "        if (address < 0 || address >= STACK_START)\n";
+                out << indent << "                runtime_error(OOB_ADDRESS);\n";
+                out << indent << "        program_mem[address] = value;\n";
+                out << indent << "}\n";
+                break;
+        case OP_READ:
+                out << indent << "{\n";
+                out << indent << "        int16_t address = " << src_2 << ";\n";
+                out << indent << "        if (address < 0 || address >= STACK_START)\n";
+                out << indent << "                runtime_error(OOB_ADDRESS);\n";
+                out << indent << "        update_register(" << dest << ", program_mem[address]);\n";
+                out << indent << "}\n";
+                break;
+        case OP_PRINT:
+                out << indent << "std::cout << (int16_t)" << src_1 << ";\n";
+                break;
+        case OP_SPRINT:
+                out << indent << "sprint(" << src_1 << ");\n";
+                break;
+        case OP_CPRINT:
+                out << indent << "{\n";
+                out << indent << "        int16_t value = " << src_1 << ";\n";
+                out << indent << "        if (value < 0 || value > 127)\n";
+                out << indent << "                runtime_error(ASCII_ERROR);\n";
+                out << indent << "        std::cout << (char)value;\n";
+                out << indent << "}\n";
+                break;
+        case OP_INPUT:
+                out << indent << "input();\n";
+                break;
+        case OP_SINPUT:
+                out << indent << "sinput();\n";
+                break;
+        case OP_RAND:
+                out << indent << "rand_push();\n";
+                break;
+        case OP_EXIT:
+                out << indent << "return 0;\n";
+                break;
+        default:
+                out << indent << "runtime_error(UNKNOWN_OPCODE);\n";
+                break;
+        }
+}
+
+std::vector<int16_t> get_instruction_addrs(const std::vector<int16_t> &program) {
+        int16_t prog_size = (int16_t)program.size();
+        std::vector<int16_t> instruction_addrs = {};
+        std::vector<Decoded_Instruction> decoded_program = decode_program(program.data(), prog_size);
+
+        // same walk as the debugger: skip the header, main address and
+        // strings, up to the 0xffff separator
+        int16_t temp_idx = 5; // SA, NT, IA, GO, main
+        while (temp_idx < prog_size && program[temp_idx - 1] != (int16_t)0xffff)
+                temp_idx++;
+        while (temp_idx < prog_size) {
+                instruction_addrs.push_back(temp_idx);
+                temp_idx = decoded_program[temp_idx].next_pc;
+        }
+        return instruction_addrs;
+}
+
+std::string translate_program(const std::vector<int16_t> &program, const bool seeded, const uint64_t seed) {
+        int16_t prog_size = (int16_t)program.size();
+        std::vector<Decoded_Instruction> decoded_program = decode_program(program.data(), prog_size);
+        std::vector<int16_t> instruction_addrs = get_instruction_addrs(program);
+        std::set<int16_t> block_addrs(instruction_addrs.begin(), instruction_addrs.end());
+        std::stringstream out;
+
+        out << "// translated from an assembled PAL program by pal_assembler --emit-cpp\n";
+        out << "// build with: g++ -O2 -std=c++17 <this file>\n\n";
+        out << "#include <cctype>\n";
+        out << "#include <cstdint>\n";
+        out << "#include <cstdlib>\n";
+        out << "#include <iostream>\n";
+        out << "#include <map>\n";
+        out << "#include <random>\n";
+        out << "#include <sstream>\n";
+        out << "#include <string>\n\n";
+        out << "#pragma GCC diagnostic ignored \"-Wunused-label\"\n";
+        out << "#pragma GCC diagnostic ignored \"-Wunused-function\"\n";
+        out << "#pragma GCC diagnostic ignored \"-Wunused-variable\"\n\n";
+        out << "#define RAM_SIZE        " << RAM_SIZE << "\n";
+        out << "#define STACK_START     " << STACK_START << "\n";
+        out << "#define STACK_SIZE      " << STACK_SIZE << "\n";
+        out << "#define CALL_STACK_SIZE " << CALL_STACK_SIZE << "\n";
+        out << "#define LIT_MIN_VALUE   " << LIT_MIN_VALUE << "\n";
+        out << "#define LIT_MAX_VALUE   " << LIT_MAX_VALUE << "\n";
+        if (seeded)
+                out << "#define RAND_SEED       " << seed << "ULL\n";
+        out << "\n";
+
+        out << "static const char *const RUNTIME_ERROR_MESSAGES[13] = {\n";
+        for (const std::string &message : RUNTIME_ERROR_MESSAGES)
+                out << "        \"" << message << "\",\n";
+        out << "};\n\n";
+
+        // magic header, main address, strings and instructions, as assembled
+        // the extra 0 stands in for the word past the end that
+        // get_program_data lets SPRINT read
+        out << "static const int16_t PROG_SIZE = " << prog_size << ";\n";
+        out << "static const int16_t PROGRAM_DATA[" << prog_size + 1 << "] = {";
+        for (int16_t i = 0; i < prog_size; ++i) {
+                if (i % 12 == 0)
+                        out << "\n       ";
+                out << " " << program[i] << ",";
+        }
+        out << "\n        0,\n};\n";
+        out << RUNTIME_PRELUDE << "\n";
+
+        out << "int main() {\n";
+        out << "        int16_t return_addr = 0;\n";
+        if (prog_size > 4)
+                out << "        " << goto_stmt(program[4], block_addrs) << "\n\n";
+        else
+                out << "        runtime_error(UNKNOWN_OPCODE);\n\n";
+
+        for (int16_t address : instruction_addrs) {
+                const Decoded_Instruction &ins = decoded_program[address];
+                out << "L_" << address << ": // ";
+                if (ins.opcode == INVALID_OPCODE)
+                        out << "invalid opcode " << program[address];
+                else
+                        out << get_mnem_name(ins.opcode);
+                out << "\n";
+                translate_instruction(out, ins, address, block_addrs);
+        }
+        // falling off the end of the program
+        out << "        runtime_error(UNKNOWN_OPCODE);\n\n";
+
+        // RET can only land right after a CALL
+        out << "return_switch:\n";
+        out << "        switch (return_addr) {\n";
+        for (int16_t address : instruction_addrs) {
+                const Decoded_Instruction &ins = decoded_program[address];
+                if (ins.opcode == OP_CALL && block_addrs.count(ins.next_pc))
+                        out << "        case " << ins.next_pc << ": goto L_" << ins.next_pc << ";\n";
+        }
+        out << "        default: runtime_error(UNKNOWN_OPCODE);\n";
+        out << "        }\n";
+        out << "}\n";
+        return out.str();
+}
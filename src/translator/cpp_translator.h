@@ -0,0 +1,27 @@
+#ifndef CPP_TRANSLATOR_H
+#define CPP_TRANSLATOR_H 1
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief translates an assembled program into a standalone C++ source file
+ * @details the whole program, header and string table included, is copied
+ * into the output, so SPRINT reads strings from the same layout as the
+ * simulator. Every instruction address gets its own label, and RET goes
+ * through a switch over the addresses that follow a CALL. Runtime errors,
+ * warnings and I/O come out the same as with run_program. RAND draws from
+ * a copy of Prng, seeded with seed if seeded, so it gives the same
+ * results as run_program with the same --seed
+ */
+std::string translate_program(const std::vector<int16_t> &program, const bool seeded, const uint64_t seed);
+
+/**
+ * @brief gets the addresses that start an instruction
+ * @details walks the instruction stream after the string table, one
+ * instruction at a time. helper function of translate_program
+ */
+std::vector<int16_t> get_instruction_addrs(const std::vector<int16_t> &program);
+
+#endif
@@ -8,6 +8,70 @@ set -o nounset
 cd "$(dirname ${0})" || exit
 
 executable="../pal_assembler -S"
+assembler="../pal_assembler"
+
+# scratch files of the checks below, removed on exit
+work_dir=$(mktemp -d)
+trap 'rm -rf "${work_dir}"' EXIT
+
+# every example, and the input it reads
+example_files=(
+    add_5.pseudo
+    alphabet.pseudo
+    color_example.pseudo
+    leap_year.pseudo
+    loop_example.pseudo
+    mult_table.pseudo
+    ram_addressing.pseudo
+    random.pseudo
+    smallest_program.pseudo
+    string_input.pseudo
+)
+example_inputs=(
+    "37\n"
+    ""
+    ""
+    "2000\n"
+    "5\n7\n#\n"
+    ""
+    ""
+    ""
+    ""
+    "hello world\n"
+)
+
+# runs program file ${1} with input ${2}, and the rest as flags
+# prints everything it printed, then its exit code
+run_program() {
+    local file="${1}"
+    local input="${2}"
+    shift 2
+    printf "%b" "${input}" | timeout 5 ${assembler} "${file}" "${@}" 2>&1
+    printf "exit code: %s\n" "${?}"
+}
+
+# fills ${work_dir}/generated with mass generated programs, once
+generate_programs() {
+    if [[ -d "${work_dir}/generated" ]]; then
+        return
+    fi
+    mkdir "${work_dir}/generated"
+    for i in $(seq 1 20); do
+        python3 generic_program_generation.py > "${work_dir}/generated/generic_${i}.pseudo"
+    done
+    for i in $(seq 1 5); do
+        python3 arithmetic_test_generation.py > "${work_dir}/generated/arithmetic_${i}.pseudo"
+    done
+}
+
+# prints a mismatch between two runs of file ${1}, or nothing
+# ${2} and ${3} are the files each run printed to
+compare_runs() {
+    if ! diff -q "${2}" "${3}" > /dev/null; then
+        printf "\x1b[31mMismatch:\x1b[0m %s\n" "${1}"
+        diff "${2}" "${3}" | head -n 10
+    fi
+}
 
 print_check() {
     printf "\x1b[32mPrint Check:\x1b[0m\n"
@@ -212,6 +276,233 @@ arithmetic_check() {
     printf "\n"
 }
 
+engine_check() {
+    printf "\x1b[32mEngine Check:\x1b[0m\n"
+    printf "\x1b[32mExpect: no mismatches between -e loop and -e threaded or -e jit\x1b[0m\n"
+    generate_programs
+    local engines=(threaded jit)
+    for i in "${!example_files[@]}"; do
+        local file="../examples/${example_files[${i}]}"
+        run_program "${file}" "${example_inputs[${i}]}" -e loop --seed 1 > "${work_dir}/loop.out"
+        for engine in "${engines[@]}"; do
+            run_program "${file}" "${example_inputs[${i}]}" -e "${engine}" --seed 1 > "${work_dir}/engine.out"
+            compare_runs "${file} (-e ${engine})" "${work_dir}/loop.out" "${work_dir}/engine.out"
+        done
+    done
+    for file in "${work_dir}"/generated/*.pseudo; do
+        run_program "${file}" "12\n" -e loop --seed 1 > "${work_dir}/loop.out"
+        # gibberish can loop forever
+        if grep -q "^exit code: 124$" "${work_dir}/loop.out"; then
+            continue
+        fi
+        for engine in "${engines[@]}"; do
+            run_program "${file}" "12\n" -e "${engine}" --seed 1 > "${work_dir}/engine.out"
+            compare_runs "$(basename "${file}") (-e ${engine})" "${work_dir}/loop.out" "${work_dir}/engine.out"
+        done
+    done
+    printf "\n"
+}
+
+emit_cpp_check() {
+    printf "\x1b[32mEmit C++ Check:\x1b[0m\n"
+    printf "\x1b[32mExpect: no mismatches between -e loop and the built --emit-cpp output\x1b[0m\n"
+    if ! command -v g++ > /dev/null; then
+        printf "g++ not found, skipped\n\n"
+        return
+    fi
+    generate_programs
+    local files=()
+    local inputs=()
+    for i in "${!example_files[@]}"; do
+        files+=("../examples/${example_files[${i}]}")
+        inputs+=("${example_inputs[${i}]}")
+    done
+    for file in "${work_dir}"/generated/*.pseudo; do
+        files+=("${file}")
+        inputs+=("12\n")
+    done
+    for i in "${!files[@]}"; do
+        local file="${files[${i}]}"
+        run_program "${file}" "${inputs[${i}]}" -e loop --seed 1 > "${work_dir}/loop.out"
+        if grep -q "^exit code: 124$" "${work_dir}/loop.out"; then
+            continue
+        fi
+        if ! ${assembler} "${file}" --seed 1 --emit-cpp "${work_dir}/emitted.cpp" > /dev/null 2>&1 \
+            || ! g++ -O2 -o "${work_dir}/emitted" "${work_dir}/emitted.cpp"; then
+            printf "\x1b[31mMismatch:\x1b[0m %s (--emit-cpp didn't build)\n" "$(basename "${file}")"
+            continue
+        fi
+        printf "%b" "${inputs[${i}]}" | timeout 5 "${work_dir}/emitted" > "${work_dir}/emitted.out" 2>&1
+        printf "exit code: %s\n" "${?}" >> "${work_dir}/emitted.out"
+        compare_runs "$(basename "${file}") (--emit-cpp)" "${work_dir}/loop.out" "${work_dir}/emitted.out"
+    done
+    printf "\n"
+}
+
+record_replay_check() {
+    printf "\x1b[32mRecord-Replay Check:\x1b[0m\n"
+    printf "\x1b[32mExpect: no mismatches between a --record run and its --replay\x1b[0m\n"
+    for i in "${!example_files[@]}"; do
+        local file="../examples/${example_files[${i}]}"
+        run_program "${file}" "${example_inputs[${i}]}" --record "${work_dir}/run.log" > "${work_dir}/record.out"
+        # no input, so everything read has to come from the log
+        run_program "${file}" "" --replay "${work_dir}/run.log" > "${work_dir}/replay.out"
+        compare_runs "${file} (--replay)" "${work_dir}/record.out" "${work_dir}/replay.out"
+    done
+    printf "\n"
+}
+
+checkpoint_check() {
+    printf "\x1b[32mCheckpoint Check:\x1b[0m\n"
+    printf "\x1b[32mExpect: no mismatches between a run restored halfway and an uninterrupted one\x1b[0m\n"
+    # only prints at the end, so the restored run prints everything
+    program="\
+        main:
+            MOV RA, \$0
+            MOV RB, \$0
+        again:
+            XOR RB, RA
+            INC RA
+            CMP RA, \$5000
+            JLS again
+            PRINT RA
+            CPRINT \$32
+            PRINT RB
+            CPRINT \$10
+            EXIT
+    "
+    printf "%s\n" "${program}" > "${work_dir}/checkpoint.pseudo"
+    run_program "${work_dir}/checkpoint.pseudo" "" > "${work_dir}/uninterrupted.out"
+    # about 20000 instructions, so the last checkpoint is at 14000
+    run_program "${work_dir}/checkpoint.pseudo" "" --checkpoint "${work_dir}/saved.chk" \
+        --checkpoint-every 7000 > "${work_dir}/checkpointed.out"
+    compare_runs "checkpoint.pseudo (--checkpoint)" "${work_dir}/uninterrupted.out" "${work_dir}/checkpointed.out"
+    for engine in loop threaded jit; do
+        timeout 5 ${assembler} --restore "${work_dir}/saved.chk" -e "${engine}" < /dev/null > "${work_dir}/restored.out" 2>&1
+        printf "exit code: %s\n" "${?}" >> "${work_dir}/restored.out"
+        compare_runs "checkpoint.pseudo (--restore, -e ${engine})" "${work_dir}/uninterrupted.out" "${work_dir}/restored.out"
+    done
+    printf "\n"
+}
+
+limit_check() {
+    printf "\x1b[32mLimit Check:\x1b[0m\n"
+    printf "\x1b[32mExpect: no mismatches between --profile counts and --max-instructions\x1b[0m\n"
+    # RET is one instruction, and RET+POP two, only when it lands on the POP
+    local programs=(
+        "main:
+            MOV RA, \$0
+        again:
+            CALL f
+            INC RA
+            CMP RA, \$100
+            JLS again
+            CPRINT \$10
+            EXIT
+        f:
+            RET"
+        "main:
+            MOV RA, \$0
+        again:
+            PUSH RA
+            CALL f
+            POP RB
+            INC RA
+            CMP RA, \$100
+            JLS again
+            CPRINT \$10
+            EXIT
+        f:
+            RET"
+    )
+    local counts=(503 703)
+    for i in "${!programs[@]}"; do
+        local name="call_ret_${i}.pseudo"
+        local file="${work_dir}/${name}"
+        printf "%s\n" "${programs[${i}]}" > "${file}"
+        ${assembler} "${file}" --profile "${work_dir}/limit.prof" > /dev/null 2>&1
+        if ! grep -q "Profile: ${counts[${i}]} instructions run" "${work_dir}/limit.prof"; then
+            printf "\x1b[31mMismatch:\x1b[0m %s (--profile, expected %s)\n" "${name}" "${counts[${i}]}"
+            head -n 1 "${work_dir}/limit.prof"
+        fi
+        for engine in loop threaded jit; do
+            # exactly enough runs to EXIT, a few less stops before it
+            if ! run_program "${file}" "" -e "${engine}" --max-instructions "${counts[${i}]}" \
+                | grep -q "^exit code: 0$"; then
+                printf "\x1b[31mMismatch:\x1b[0m %s (-e %s, stopped at its own count)\n" "${name}" "${engine}"
+            fi
+            local limit=$((counts[i] - 3))
+            local stopped_after=$(run_program "${file}" "" -e "${engine}" --max-instructions "${limit}" \
+                | sed -n 's/.* after \([0-9]*\) instructions.*/\1/p')
+            if [[ -z "${stopped_after}" || "${stopped_after}" -lt "${limit}" || "${stopped_after}" -gt "${counts[${i}]}" ]]; then
+                printf "\x1b[31mMismatch:\x1b[0m %s (-e %s, limit %s stopped after %s)\n" \
+                    "${name}" "${engine}" "${limit}" "${stopped_after:-none}"
+            fi
+        done
+    done
+    printf "\n"
+}
+
+debug_script_check() {
+    printf "\x1b[32mDebug Script Check:\x1b[0m\n"
+    printf "\x1b[32mExpect: an error for every malformed line, and an end record last\x1b[0m\n"
+    printf "%s\n" \
+        "next abc" "delete abc" "break" "break 99999999" "watch RA" "disassemble x" \
+        "reverse-next abc" "reverse-next" "print %99999999999" "bogus" \
+        "watch [\$2]" "next 4" "reverse-next 3" "continue" "continue" > "${work_dir}/script.txt"
+    run_program ../examples/ram_addressing.pseudo "" --debug-script "${work_dir}/script.txt" \
+        --debug-output "${work_dir}/report.json" > "${work_dir}/debug.out"
+    if ! grep -q "^exit code: 0$" "${work_dir}/debug.out"; then
+        printf "\x1b[31mMismatch:\x1b[0m debugger %s\n" "$(tail -n 1 "${work_dir}/debug.out")"
+    fi
+    local num_errors=$(grep -c '"event":"error"' "${work_dir}/report.json")
+    if [[ "${num_errors}" -ne 10 ]]; then
+        printf "\x1b[31mMismatch:\x1b[0m %s errors reported, expected 10\n" "${num_errors}"
+    fi
+    # the redone write to [$2] stops the first continue again
+    if ! grep -q '"line":14,"command":"continue","event":"stop","reason":"watchpoint"' "${work_dir}/report.json"; then
+        printf "\x1b[31mMismatch:\x1b[0m continue didn't stop at the watchpoint\n"
+    fi
+    if ! tail -n 1 "${work_dir}/report.json" | grep -q '"event":"end"'; then
+        printf "\x1b[31mMismatch:\x1b[0m report doesn't end with an end record\n"
+        tail -n 1 "${work_dir}/report.json"
+    fi
+    printf "\n"
+}
+
+batch_check() {
+    printf "\x1b[32mBatch Check:\x1b[0m\n"
+    printf "\x1b[32mExpect: the good programs run, around the one that faults\x1b[0m\n"
+    cp ../examples/alphabet.pseudo "${work_dir}/good_1.pseudo"
+    cp ../examples/alphabet.pseudo "${work_dir}/good_2.pseudo"
+    program="\
+        main:
+            MOV RSP, \$16000
+            PUSH \$1
+            EXIT
+    "
+    printf "%s\n" "${program}" > "${work_dir}/bad_stack_ptr.pseudo"
+    printf "%s\n" "${work_dir}/good_1.pseudo" "${work_dir}/bad_stack_ptr.pseudo" "${work_dir}/good_2.pseudo" \
+        > "${work_dir}/manifest"
+    timeout 10 ${assembler} --batch "${work_dir}/manifest" > "${work_dir}/batch.out" 2>&1
+    local exit_code="${?}"
+    if [[ "${exit_code}" -ne 0 ]]; then
+        printf "\x1b[31mMismatch:\x1b[0m --batch exit code: %s\n" "${exit_code}"
+    fi
+    if [[ "$(grep -c "good_[12].pseudo: ok$" "${work_dir}/batch.out")" -ne 2 ]]; then
+        printf "\x1b[31mMismatch:\x1b[0m good programs didn't both finish\n"
+        cat "${work_dir}/batch.out"
+    fi
+    if ! grep -q "bad_stack_ptr.pseudo: Runtime Error: attempted to write a bad stack ptr value" "${work_dir}/batch.out"; then
+        printf "\x1b[31mMismatch:\x1b[0m MOV RSP, \$16000 wasn't a runtime error\n"
+        cat "${work_dir}/batch.out"
+    fi
+    run_program ../examples/alphabet.pseudo "" | sed '$d' > "${work_dir}/alphabet.out"
+    compare_runs "good_1.pseudo (--batch)" "${work_dir}/alphabet.out" "${work_dir}/good_1.pseudo.out"
+    compare_runs "good_2.pseudo (--batch)" "${work_dir}/alphabet.out" "${work_dir}/good_2.pseudo.out"
+    printf "\n"
+}
+
 tests=(
     print_check
     read_write_check
@@ -219,6 +510,13 @@ tests=(
     ascii_check
     loop_check_2
     arithmetic_check
+    engine_check
+    emit_cpp_check
+    record_replay_check
+    checkpoint_check
+    limit_check
+    debug_script_check
+    batch_check
 )
 
 if [[ "${#}" -ne 1 ]]; then
@@ -228,12 +526,9 @@ fi
 
 if [[ ! "${1}" =~ ^[0-9]+$ ]]; then
     if [[ "${1}" == "all" ]]; then
-        ${tests[0]}
-        ${tests[1]}
-        ${tests[2]}
-        ${tests[3]}
-        ${tests[4]}
-        ${tests[5]}
+        for test in "${tests[@]}"; do
+            ${test}
+        done
     else
         printf "non-digit argument is not \"all\"\n"
     fi